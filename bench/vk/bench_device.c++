@@ -0,0 +1,71 @@
+#include "bench_device.h"
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+vk::device& bench_device() {
+  static vk::instance instance;
+  static std::unique_ptr<vk::device> device;
+  if (nullptr == device) {
+    auto wanted = std::getenv("VK_BENCH_DEVICE");
+    for (auto &physical_device: instance.physical_devices()) {
+      if (nullptr != wanted &&
+          nullptr == std::strstr(physical_device.properties().deviceName, wanted))
+        continue;
+      device = std::make_unique<vk::device>(physical_device);
+      break;
+    }
+    assert(nullptr != device && "No device to benchmark.");
+  }
+
+  return *device;
+}
+
+uint32_t bench_queue_family() {
+  return bench_device().queue_family_index(vk::queue_role::graphics);
+}
+
+const vk::physical_device::memory_type& bench_memory_type(uint32_t bits) {
+  const vk::physical_device::memory_type *found = nullptr;
+  for (auto &memory_type: bench_device().physical_device().memory_types()) {
+    if (0 == (bits & (1u << memory_type.index)))
+      continue;
+    if (nullptr == found || (memory_type.is_device_local() && !found->is_device_local()))
+      found = &memory_type;
+  }
+  assert(nullptr != found && "No memory type to benchmark with.");
+  return *found;
+}
+
+const std::vector<uint32_t>& bench_shader_code() {
+  static std::vector<uint32_t> code;
+  if (code.empty()) {
+    std::ifstream in{VECTOR_ADD_SPV, std::ios::binary | std::ios::ate};
+    assert(in && "Failed to open vector_add.spv.");
+    code.resize(in.tellg() / sizeof(uint32_t));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(code.data()), code.size() * sizeof(uint32_t));
+  }
+  return code;
+}
+
+vk::shader_module& bench_shader() {
+  static std::unique_ptr<vk::shader_module> shader;
+  if (nullptr == shader) {
+    auto &code = bench_shader_code();
+    shader = std::make_unique<vk::shader_module>(bench_device(), code.data(),
+                                                 code.size() * sizeof(uint32_t));
+  }
+  return *shader;
+}
+
+vk::descriptor_set_layout& bench_set_layout() {
+  static std::unique_ptr<vk::descriptor_set_layout> layout;
+  if (nullptr == layout) {
+    vk::descriptor_set_layout_binding bindings[] = {{0}, {1}, {2}};
+    layout = std::make_unique<vk::descriptor_set_layout>(bench_device(), bindings, 3);
+  }
+  return *layout;
+}
@@ -0,0 +1,16 @@
+#include <vk/vk.h>
+
+// A single device shared by every benchmark, created on first use so that
+// instance and device creation stay out of the measurements. Set
+// VK_BENCH_DEVICE to part of a device name, e.g. llvmpipe, to pick one.
+vk::device& bench_device();
+uint32_t bench_queue_family();
+
+// The first memory type in bits, preferring device local ones.
+const vk::physical_device::memory_type& bench_memory_type(uint32_t bits);
+
+// samples/vector_add.spv: one compute entry point, main, reading storage
+// buffers 0 and 1 and writing 2, with launch_params pushed at offset 0.
+const std::vector<uint32_t>& bench_shader_code();
+vk::shader_module& bench_shader();
+vk::descriptor_set_layout& bench_set_layout();
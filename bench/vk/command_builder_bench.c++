@@ -0,0 +1,172 @@
+#include <vk/vk.h>
+#include <benchmark/benchmark.h>
+#include "bench_device.h"
+
+namespace {
+
+const uint32_t COMMANDS_PER_BUFFER = 256;
+
+vk::event& shared_event() {
+  static vk::event event{bench_device()};
+  return event;
+}
+
+// Records through a copy of the wrapper, which is what every recording call
+// cost when command_builder took wrappers by value.
+void record_with_wrapper_copies(benchmark::State &state) {
+  auto &device = bench_device();
+  vk::command_pool pool{device, device.queue_family_index(vk::queue_role::graphics)};
+  auto buffer = pool.allocate();
+  auto &event = shared_event();
+
+  for (auto _: state) {
+    buffer.record([&](vk::command_builder &builder) {
+      for (auto i = 0u; i < COMMANDS_PER_BUFFER; ++i)
+        builder.set_event(vk::event{event}, vk::pipeline_stage::bottom_of_pipe);
+    });
+  }
+
+  state.SetItemsProcessed(state.iterations() * COMMANDS_PER_BUFFER);
+}
+
+void record_with_refs(benchmark::State &state) {
+  auto &device = bench_device();
+  vk::command_pool pool{device, device.queue_family_index(vk::queue_role::graphics)};
+  auto buffer = pool.allocate();
+  vk::event_ref event = shared_event();
+
+  for (auto _: state) {
+    buffer.record([&](vk::command_builder &builder) {
+      for (auto i = 0u; i < COMMANDS_PER_BUFFER; ++i)
+        builder.set_event(event, vk::pipeline_stage::bottom_of_pipe);
+    });
+  }
+
+  state.SetItemsProcessed(state.iterations() * COMMANDS_PER_BUFFER);
+}
+
+// A bound vector_add pipeline and its resources, for calls that need
+// compute state to be valid.
+struct compute_state {
+  compute_state()
+  : range{vk::shader_stage_mask::compute, 0, sizeof(vk::launch_params)},
+    layout{bench_device(), &bench_set_layout(), 1, &range, 1},
+    pipeline{bench_device(), layout, bench_shader(), "main"},
+    pool{bench_device(), 1},
+    set{pool.allocate(bench_set_layout())},
+    buffer{bench_device(), 4096},
+    memory{bench_device(), bench_memory_type(buffer.memory_type_bits()), 4096},
+    timestamps{bench_device(), vk::query_type::timestamp, COMMANDS_PER_BUFFER} {
+    buffer.bind(memory, 0, 4096);
+    vk::descriptor_binding bindings[] = {{0, buffer}, {1, buffer}, {2, buffer}};
+    set.update(bindings, 3);
+  }
+
+  vk::push_constant_range range;
+  vk::pipeline_layout layout;
+  vk::compute_pipeline pipeline;
+  vk::descriptor_pool pool;
+  vk::descriptor_set set;
+  vk::buffer buffer;
+  vk::device_memory memory;
+  vk::query_pool timestamps;
+};
+
+compute_state& shared_compute_state() {
+  static compute_state state;
+  return state;
+}
+
+// Records COMMANDS_PER_BUFFER calls per iteration after binding the compute
+// state, so items are single calls.
+template<typename F>
+void record_calls(benchmark::State &state, F call) {
+  auto &device = bench_device();
+  auto &compute = shared_compute_state();
+  vk::command_pool pool{device, device.queue_family_index(vk::queue_role::graphics)};
+  auto buffer = pool.allocate();
+
+  for (auto _: state) {
+    buffer.record([&](vk::command_builder &builder) {
+      buffer.bind_pipeline(compute.pipeline);
+      buffer.bind_descriptor_sets(compute.layout, &compute.set, 1);
+      for (auto i = 0u; i < COMMANDS_PER_BUFFER; ++i)
+        call(builder, buffer, compute, i);
+    });
+  }
+
+  state.SetItemsProcessed(state.iterations() * COMMANDS_PER_BUFFER);
+}
+
+void record_dispatch(benchmark::State &state) {
+  record_calls(state, [](vk::command_builder &builder, vk::command_buffer&,
+                         compute_state&, uint32_t) {
+    builder.dispatch(1);
+  });
+}
+
+void record_push_constants(benchmark::State &state) {
+  record_calls(state, [](vk::command_builder &builder, vk::command_buffer&,
+                         compute_state &compute, uint32_t i) {
+    builder.push_constants(compute.layout, vk::shader_stage_mask::compute, 0,
+                           vk::launch_params{{i, i, i}, {i, i, i}});
+  });
+}
+
+void record_bind_descriptor_sets(benchmark::State &state) {
+  record_calls(state, [](vk::command_builder&, vk::command_buffer &buffer,
+                         compute_state &compute, uint32_t) {
+    buffer.bind_descriptor_sets(compute.layout, &compute.set, 1);
+  });
+}
+
+void record_pipeline_barrier(benchmark::State &state) {
+  vk::memory_barrier barrier{vk::access_mask::shader_write,
+                             vk::access_mask::shader_read};
+  record_calls(state, [&](vk::command_builder &builder, vk::command_buffer&,
+                          compute_state&, uint32_t) {
+    builder.pipeline_barrier(vk::pipeline_stage::compute_shader,
+                             vk::pipeline_stage::compute_shader,
+                             &barrier, 1, nullptr, 0, nullptr, 0);
+  });
+}
+
+void record_fill_buffer(benchmark::State &state) {
+  record_calls(state, [](vk::command_builder &builder, vk::command_buffer&,
+                         compute_state &compute, uint32_t i) {
+    builder.fill_buffer(compute.buffer, 0, i, 256);
+  });
+}
+
+void record_update_buffer(benchmark::State &state) {
+  uint32_t data[16] = {};
+  record_calls(state, [&](vk::command_builder &builder, vk::command_buffer&,
+                          compute_state &compute, uint32_t) {
+    builder.update_buffer(compute.buffer, 0, data, sizeof(data));
+  });
+}
+
+void record_write_timestamp(benchmark::State &state) {
+  record_calls(state, [](vk::command_builder &builder, vk::command_buffer&,
+                         compute_state &compute, uint32_t i) {
+    if (0 == i)
+      builder.reset_query_pool(compute.timestamps, 0, COMMANDS_PER_BUFFER);
+    builder.write_timestamp(vk::pipeline_stage::bottom_of_pipe,
+                            compute.timestamps, i);
+  });
+}
+
+}
+
+// Several threads recording against one resource is where refcount traffic
+// hurts most, as every copy bounces the control block between cores.
+BENCHMARK(record_with_wrapper_copies)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(record_with_refs)->ThreadRange(1, 8)->UseRealTime();
+
+BENCHMARK(record_dispatch);
+BENCHMARK(record_push_constants);
+BENCHMARK(record_bind_descriptor_sets);
+BENCHMARK(record_pipeline_barrier);
+BENCHMARK(record_fill_buffer);
+BENCHMARK(record_update_buffer);
+BENCHMARK(record_write_timestamp);
@@ -0,0 +1,111 @@
+#include <vk/vk.h>
+#include <benchmark/benchmark.h>
+#include "bench_device.h"
+
+namespace {
+
+const uint32_t SETS_PER_FRAME = 1024;
+
+struct bound_buffers {
+  bound_buffers()
+  : buffers{{bench_device(), 4096}, {bench_device(), 4096}, {bench_device(), 4096}},
+    memory{bench_device(), bench_memory_type(buffers[0].memory_type_bits()),
+           3 * 64 * 1024} {
+    for (auto i = 0u; i < 3; ++i)
+      buffers[i].bind(memory, i * 64 * 1024, 4096);
+  }
+
+  std::vector<vk::buffer> buffers;
+  vk::device_memory memory;
+};
+
+bound_buffers& shared_buffers() {
+  static bound_buffers buffers;
+  return buffers;
+}
+
+// Allocations from a linear per-frame allocator, reset once a frame's worth
+// of sets has been handed out.
+void allocate_descriptor_set(benchmark::State &state) {
+  auto &layout = bench_set_layout();
+  vk::descriptor_allocator allocator{bench_device(), &layout, 1, SETS_PER_FRAME, 1};
+
+  auto allocated = 0u;
+  for (auto _: state) {
+    if (SETS_PER_FRAME == allocated) {
+      allocator.begin_frame(0);
+      allocated = 0;
+    }
+    benchmark::DoNotOptimize(allocator.allocate(layout));
+    ++allocated;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+std::vector<vk::descriptor_set> allocate_sets(vk::descriptor_pool &pool,
+                                              uint32_t count) {
+  std::vector<vk::descriptor_set> sets;
+  for (auto i = 0u; i < count; ++i)
+    sets.push_back(pool.allocate(bench_set_layout()));
+  return sets;
+}
+
+// One vkUpdateDescriptorSets per set.
+void update_descriptor_set(benchmark::State &state) {
+  vk::descriptor_pool pool{bench_device(), 64};
+  auto sets = allocate_sets(pool, 64);
+  auto &buffers = shared_buffers().buffers;
+  std::vector<vk::descriptor_binding> bindings;
+  for (auto i = 0u; i < 3; ++i)
+    bindings.emplace_back(i, buffers[i]);
+
+  for (auto _: state) {
+    for (auto &set: sets)
+      set.update(bindings.data(), bindings.size());
+  }
+  state.SetItemsProcessed(state.iterations() * sets.size());
+}
+
+// Every set's writes in one vkUpdateDescriptorSets.
+void write_descriptor_sets_batched(benchmark::State &state) {
+  vk::descriptor_pool pool{bench_device(), 64};
+  auto sets = allocate_sets(pool, 64);
+  auto &buffers = shared_buffers().buffers;
+  vk::descriptor_writer writer{bench_device()};
+
+  for (auto _: state) {
+    for (auto &set: sets) {
+      for (auto i = 0u; i < 3; ++i)
+        writer.write_buffer(set, i, vk::descriptor_type::storage_buffer, buffers[i]);
+    }
+    writer.flush();
+  }
+  state.SetItemsProcessed(state.iterations() * sets.size());
+}
+
+void update_descriptor_set_with_template(benchmark::State &state) {
+  vk::descriptor_pool pool{bench_device(), 64};
+  auto sets = allocate_sets(pool, 64);
+  auto &buffers = shared_buffers().buffers;
+
+  vk::descriptor_update_entry entry{0, 0, 3, vk::descriptor_type::storage_buffer,
+                                    0, sizeof(vk::descriptor_buffer_info)};
+  vk::descriptor_update_template update_template{bench_device(), bench_set_layout(),
+                                                 &entry, 1};
+  vk::descriptor_buffer_info infos[3];
+  for (auto i = 0u; i < 3; ++i)
+    infos[i] = {buffers[i], 0, VK_WHOLE_SIZE};
+
+  for (auto _: state) {
+    for (auto &set: sets)
+      set.update(update_template, infos);
+  }
+  state.SetItemsProcessed(state.iterations() * sets.size());
+}
+
+}
+
+BENCHMARK(allocate_descriptor_set);
+BENCHMARK(update_descriptor_set);
+BENCHMARK(write_descriptor_sets_batched);
+BENCHMARK(update_descriptor_set_with_template);
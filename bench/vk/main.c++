@@ -0,0 +1,22 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include "bench_device.h"
+
+// Run with --benchmark_out=<file> --benchmark_out_format=json for results a
+// regression check can diff, e.g. with Google Benchmark's tools/compare.py.
+int main(int argc, char **argv) {
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+
+  // Results from different drivers aren't comparable, so every report says
+  // which one it came from.
+  auto &properties = bench_device().physical_device().properties();
+  benchmark::AddCustomContext("vk_device", properties.deviceName);
+  benchmark::AddCustomContext("vk_driver_version",
+                              std::to_string(properties.driverVersion));
+
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
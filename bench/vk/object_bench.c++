@@ -0,0 +1,191 @@
+#include <vk/vk.h>
+#include <benchmark/benchmark.h>
+#include "bench_device.h"
+
+namespace {
+
+// Creates and destroys one object per iteration.
+template<typename F>
+void create_destroy(benchmark::State &state, F create) {
+  for (auto _: state) {
+    auto object = create();
+    benchmark::DoNotOptimize(object);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+vk::image& bound_image() {
+  static std::unique_ptr<vk::image> image;
+  static std::unique_ptr<vk::device_memory> memory;
+  if (nullptr == image) {
+    auto &device = bench_device();
+    image = std::make_unique<vk::image>(device, vk::texel_format::r8g8b8a8_unorm,
+                                        vk::extent<3>{256, 256, 1}, 1, 1,
+                                        vk::image_usage::sampled |
+                                        vk::image_usage::colour_attachment);
+    auto &memory_type = bench_memory_type(image->memory_type_bits());
+    memory = std::make_unique<vk::device_memory>(device, memory_type,
+                                                 image->minimum_allocation_size());
+    image->bind(*memory, 0, image->minimum_allocation_size());
+  }
+  return *image;
+}
+
+vk::subresource_range colour_range() {
+  vk::subresource_range range;
+  range.aspect_mask = vk::image_aspect::colour;
+  range.base_mip_level = 0;
+  range.mip_count = 1;
+  range.base_array_layer = 0;
+  range.layer_count = 1;
+  return range;
+}
+
+vk::render_pass make_render_pass() {
+  vk::attachment_reference colour{0, vk::image_layout::colour_attachment};
+  vk::subpass_description subpass{nullptr, 0, &colour, 1, nullptr, nullptr, nullptr, 0};
+  vk::attachment_description attachment{
+    vk::texel_format::r8g8b8a8_unorm,
+    vk::attachment_description::load_operation::dont_care,
+    vk::attachment_description::store_operation::store,
+    vk::attachment_description::load_operation::dont_care,
+    vk::attachment_description::store_operation::dont_care,
+    vk::image_layout::undefined,
+    vk::image_layout::colour_attachment};
+  return vk::render_pass{bench_device(), &attachment, 1, &subpass, 1, nullptr, 0};
+}
+
+void create_buffer(benchmark::State &state) {
+  create_destroy(state, [] { return vk::buffer{bench_device(), 4096}; });
+}
+
+void create_image(benchmark::State &state) {
+  create_destroy(state, [] {
+    return vk::image{bench_device(), vk::texel_format::r8g8b8a8_unorm,
+                     vk::extent<3>{256, 256, 1}, 1, 1};
+  });
+}
+
+void create_image_view(benchmark::State &state) {
+  auto &image = bound_image();
+  create_destroy(state, [&] {
+    return vk::image_view{image, vk::image_view::type::image_2d,
+                          vk::texel_format::r8g8b8a8_unorm,
+                          vk::component_mapping{}, colour_range()};
+  });
+}
+
+void create_device_memory(benchmark::State &state) {
+  auto &memory_type = bench_memory_type(~0u);
+  create_destroy(state, [&] {
+    return vk::device_memory{bench_device(), memory_type, 64 * 1024};
+  });
+}
+
+void create_sampler(benchmark::State &state) {
+  create_destroy(state, [] { return vk::sampler{bench_device()}; });
+}
+
+void create_event(benchmark::State &state) {
+  create_destroy(state, [] { return vk::event{bench_device()}; });
+}
+
+void create_fence(benchmark::State &state) {
+  create_destroy(state, [] { return vk::fence{bench_device(), false}; });
+}
+
+void create_semaphore(benchmark::State &state) {
+  create_destroy(state, [] { return vk::semaphore{bench_device()}; });
+}
+
+void create_query_pool(benchmark::State &state) {
+  create_destroy(state, [] {
+    return vk::query_pool{bench_device(), vk::query_type::timestamp, 64};
+  });
+}
+
+void create_command_pool(benchmark::State &state) {
+  create_destroy(state, [] {
+    return vk::command_pool{bench_device(), bench_queue_family()};
+  });
+}
+
+void allocate_command_buffer(benchmark::State &state) {
+  vk::command_pool pool{bench_device(), bench_queue_family()};
+  create_destroy(state, [&] { return pool.allocate(); });
+}
+
+void create_shader_module(benchmark::State &state) {
+  auto &code = bench_shader_code();
+  create_destroy(state, [&] {
+    return vk::shader_module{bench_device(), code.data(),
+                             code.size() * sizeof(uint32_t)};
+  });
+}
+
+void create_descriptor_set_layout(benchmark::State &state) {
+  vk::descriptor_set_layout_binding bindings[] = {{0}, {1}, {2}};
+  create_destroy(state, [&] {
+    return vk::descriptor_set_layout{bench_device(), bindings, 3};
+  });
+}
+
+void create_descriptor_pool(benchmark::State &state) {
+  create_destroy(state, [] { return vk::descriptor_pool{bench_device(), 64}; });
+}
+
+void create_descriptor_update_template(benchmark::State &state) {
+  vk::descriptor_update_entry entries[] = {
+    {0, 0, 3, vk::descriptor_type::storage_buffer, 0,
+     sizeof(vk::descriptor_buffer_info)}};
+  create_destroy(state, [&] {
+    return vk::descriptor_update_template{bench_device(), bench_set_layout(),
+                                          entries, 1};
+  });
+}
+
+void create_pipeline_layout(benchmark::State &state) {
+  create_destroy(state, [] {
+    return vk::pipeline_layout{bench_device(), &bench_set_layout(), 1};
+  });
+}
+
+void create_pipeline_cache(benchmark::State &state) {
+  create_destroy(state, [] { return vk::pipeline_cache{bench_device()}; });
+}
+
+void create_render_pass(benchmark::State &state) {
+  create_destroy(state, [] { return make_render_pass(); });
+}
+
+void create_framebuffer(benchmark::State &state) {
+  auto pass = make_render_pass();
+  vk::image_view view{bound_image(), vk::image_view::type::image_2d,
+                      vk::texel_format::r8g8b8a8_unorm,
+                      vk::component_mapping{}, colour_range()};
+  create_destroy(state, [&] {
+    return vk::framebuffer{bench_device(), pass, &view, 1, 256, 256, 1};
+  });
+}
+
+}
+
+BENCHMARK(create_buffer);
+BENCHMARK(create_image);
+BENCHMARK(create_image_view);
+BENCHMARK(create_device_memory);
+BENCHMARK(create_sampler);
+BENCHMARK(create_event);
+BENCHMARK(create_fence);
+BENCHMARK(create_semaphore);
+BENCHMARK(create_query_pool);
+BENCHMARK(create_command_pool);
+BENCHMARK(allocate_command_buffer);
+BENCHMARK(create_shader_module);
+BENCHMARK(create_descriptor_set_layout);
+BENCHMARK(create_descriptor_pool);
+BENCHMARK(create_descriptor_update_template);
+BENCHMARK(create_pipeline_layout);
+BENCHMARK(create_pipeline_cache);
+BENCHMARK(create_render_pass);
+BENCHMARK(create_framebuffer);
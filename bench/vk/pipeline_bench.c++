@@ -0,0 +1,41 @@
+#include <vk/vk.h>
+#include <benchmark/benchmark.h>
+#include "bench_device.h"
+
+namespace {
+
+vk::pipeline_layout& shared_layout() {
+  static vk::push_constant_range range{vk::shader_stage_mask::compute, 0,
+                                       sizeof(vk::launch_params)};
+  static vk::pipeline_layout layout{bench_device(), &bench_set_layout(), 1, &range, 1};
+  return layout;
+}
+
+void create_compute_pipeline(benchmark::State &state) {
+  auto &layout = shared_layout();
+  auto &shader = bench_shader();
+  for (auto _: state) {
+    vk::compute_pipeline pipeline{bench_device(), layout, shader, "main"};
+    benchmark::DoNotOptimize(pipeline);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// The cache is warmed before timing, so every creation is a hit.
+void create_compute_pipeline_cached(benchmark::State &state) {
+  auto &layout = shared_layout();
+  auto &shader = bench_shader();
+  vk::pipeline_cache cache{bench_device()};
+  vk::compute_pipeline warm{bench_device(), layout, shader, "main", cache};
+
+  for (auto _: state) {
+    vk::compute_pipeline pipeline{bench_device(), layout, shader, "main", cache};
+    benchmark::DoNotOptimize(pipeline);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}
+
+BENCHMARK(create_compute_pipeline);
+BENCHMARK(create_compute_pipeline_cached);
@@ -0,0 +1,211 @@
+#include <vk/vk.h>
+#include <benchmark/benchmark.h>
+#include "allocation_counter.h"
+#include "bench_device.h"
+
+namespace {
+
+// One submit of state.range(0) empty command buffers, then a wait for its
+// fence: the floor on latency for any work handed to the queue.
+void submit_fence_round_trip(benchmark::State &state) {
+  auto &device = bench_device();
+  auto queue = device.get_queue(vk::queue_role::graphics);
+  vk::command_pool pool{device, queue.family()};
+  auto buffers = pool.allocate(state.range(0));
+  for (auto &buffer: buffers)
+    buffer.record([](vk::command_builder&) {});
+
+  vk::fence done{device, false};
+  vk::submission submission;
+  submission.execute(buffers.data(), buffers.size());
+
+  for (auto _: state) {
+    queue.submit(submission, done);
+    done.wait(UINT64_MAX);
+    done.reset();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// As submit_fence_round_trip, tracking completion on a queue timeline
+// instead of a fence that needs resetting.
+void submit_timeline_round_trip(benchmark::State &state) {
+  auto &device = bench_device();
+  if (!device.supports_timeline_semaphores()) {
+    state.SkipWithError("VK_KHR_timeline_semaphore is not supported.");
+    return;
+  }
+
+  auto queue = device.get_queue(vk::queue_role::graphics);
+  vk::command_pool pool{device, queue.family()};
+  auto buffers = pool.allocate(state.range(0));
+  for (auto &buffer: buffers)
+    buffer.record([](vk::command_builder&) {});
+
+  vk::queue_timeline timeline{device, queue};
+  vk::submission submission;
+  submission.execute(buffers.data(), buffers.size());
+
+  for (auto _: state)
+    timeline.wait(timeline.submit(submission), UINT64_MAX);
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Submits chained by semaphores between batches, all in one call.
+void submit_chained_batches(benchmark::State &state) {
+  auto &device = bench_device();
+  auto queue = device.get_queue(vk::queue_role::graphics);
+  vk::command_pool pool{device, queue.family()};
+  auto buffer = pool.allocate();
+  buffer.record([](vk::command_builder&) {});
+
+  std::vector<vk::semaphore> semaphores;
+  for (auto i = 1; i < state.range(0); ++i)
+    semaphores.emplace_back(device);
+
+  vk::submission submission;
+  submission.execute(buffer);
+  for (auto &semaphore: semaphores) {
+    submission.signal(semaphore)
+              .next_batch()
+              .wait(semaphore, vk::pipeline_stage::top_of_pipe)
+              .execute(buffer);
+  }
+
+  vk::fence done{device, false};
+  for (auto _: state) {
+    queue.submit(submission, done);
+    done.wait(UINT64_MAX);
+    done.reset();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Streams 16MB into a device local buffer per iteration, in uploads of
+// state.range(0) bytes, through a 64MB ring.
+void staging_upload(benchmark::State &state) {
+  auto &device = bench_device();
+  auto queue = device.get_queue(vk::queue_role::graphics);
+  const vk::physical_device::memory_type *host_type = nullptr;
+  for (auto &memory_type: device.physical_device().memory_types()) {
+    if (memory_type.is_host_visible() && memory_type.is_host_coherent()) {
+      host_type = &memory_type;
+      break;
+    }
+  }
+
+  const size_t total = 16 * 1024 * 1024;
+  vk::buffer destination{device, total, vk::buffer_usage::transfer_destination |
+                                        vk::buffer_usage::storage};
+  auto &memory_type = bench_memory_type(destination.memory_type_bits());
+  vk::device_memory memory{device, memory_type, destination.minimum_allocation_size()};
+  destination.bind(memory, 0, destination.minimum_allocation_size());
+
+  vk::staging_uploader uploader{device, *host_type, 4 * total};
+  vk::command_pool pool{device, queue.family()};
+  auto buffer = pool.allocate();
+  std::vector<char> data(state.range(0), 1);
+  vk::submission submission;
+  submission.execute(buffer);
+
+  for (auto _: state) {
+    for (size_t offset = 0; offset < total; offset += data.size())
+      uploader.upload(destination, offset, data.data(), data.size());
+
+    std::unique_ptr<vk::fence> done;
+    buffer.record([&](vk::command_builder &builder) {
+      done = std::make_unique<vk::fence>(
+          uploader.record(builder, vk::pipeline_stage::compute_shader,
+                          vk::access_mask::shader_read));
+    });
+    queue.submit(submission, *done);
+    done->wait(UINT64_MAX);
+  }
+  state.SetBytesProcessed(state.iterations() * total);
+}
+
+// A frame through every per-frame wrapper call that used to allocate:
+// fence waits and resets, a descriptor set update, descriptor set binds,
+// an image clear, secondary execution and a submit. Reports the heap
+// allocations per frame, which should be zero.
+void recorded_frame(benchmark::State &state) {
+  auto &device = bench_device();
+  auto queue = device.get_queue(vk::queue_role::graphics);
+  vk::command_pool pool{device, queue.family()};
+  auto primary = pool.allocate();
+  auto secondary = pool.allocate(vk::command_buffer_level::secondary);
+  vk::fence fences[2] = {vk::fence{device, true}, vk::fence{device, true}};
+  vk::submission signal_only;
+
+  auto &set_layout = bench_set_layout();
+  vk::pipeline_layout layout{device, &set_layout, 1};
+  vk::descriptor_pool descriptor_pool{device, 1};
+  auto set = descriptor_pool.allocate(set_layout);
+
+  vk::memory_allocator allocator{device};
+  std::vector<vk::buffer> storage;
+  for (auto i = 0; i < 3; ++i) {
+    storage.emplace_back(device, 256);
+    auto &buffer = storage.back();
+    buffer.bind(allocator.allocate(bench_memory_type(buffer.memory_type_bits()), buffer));
+  }
+  vk::image target{device, vk::texel_format::r8g8b8a8_unorm, vk::extent<3>{64, 64, 1},
+                   1, 1, vk::image_usage::transfer_destination};
+  target.bind(allocator.allocate(bench_memory_type(target.memory_type_bits()), target));
+
+  vk::subresource_range range{vk::image_aspect::colour, 0, 1, 0, 1};
+  vk::image_memory_barrier to_general{vk::access_mask::none,
+                                      vk::access_mask::transfer_write,
+                                      vk::image_layout::undefined,
+                                      vk::image_layout::general,
+                                      VK_QUEUE_FAMILY_IGNORED,
+                                      VK_QUEUE_FAMILY_IGNORED, target, range};
+  vk::clear_colour_value colour{{0.0f, 0.0f, 0.0f, 1.0f}};
+
+  size_t allocations = 0;
+  for (auto _: state) {
+    allocation_scope scope;
+    vk::fence::wait_all(fences, 2, UINT64_MAX);
+    vk::fence::reset(fences, 2);
+
+    vk::descriptor_binding writes[] = {{0, storage[0]}, {1, storage[1]},
+                                       {2, storage[2]}};
+    set.update(writes, 3);
+
+    secondary.begin();
+    secondary.end();
+    primary.record([&](vk::command_builder &builder) {
+      primary.bind_descriptor_sets(layout, &set, 1);
+      builder.pipeline_barrier(vk::pipeline_stage::top_of_pipe,
+                               vk::pipeline_stage::transfer, nullptr, 0,
+                               nullptr, 0, &to_general, 1);
+      builder.clear_colour_image(target, vk::image_layout::general, colour,
+                                 &range, 1);
+      builder.execute_commands(&secondary, 1);
+    });
+    queue.submit(&primary, 1);
+    queue.submit(signal_only, fences[0]);
+    queue.submit(signal_only, fences[1]);
+    allocations += scope.allocations();
+  }
+  vk::fence::wait_all(fences, 2, UINT64_MAX);
+  state.counters["allocations"] =
+      benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(state.iterations());
+}
+
+void fence_status(benchmark::State &state) {
+  vk::fence fence{bench_device(), true};
+  for (auto _: state)
+    benchmark::DoNotOptimize(fence.status());
+  state.SetItemsProcessed(state.iterations());
+}
+
+}
+
+BENCHMARK(submit_fence_round_trip)->Arg(1)->Arg(8)->UseRealTime();
+BENCHMARK(submit_timeline_round_trip)->Arg(1)->Arg(8)->UseRealTime();
+BENCHMARK(submit_chained_batches)->Arg(2)->Arg(8)->UseRealTime();
+BENCHMARK(staging_upload)->Arg(4096)->Arg(64 * 1024)->UseRealTime();
+BENCHMARK(recorded_frame)->UseRealTime();
+BENCHMARK(fence_status);
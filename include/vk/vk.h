@@ -2,7 +2,12 @@
 #define VK_VK_H
 
 #include <vulkan/vulkan.h>
+#include <functional>
+#include <future>
+#include <iosfwd>
 #include <memory>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 namespace vk {
@@ -14,34 +19,57 @@ class queue;
 class shader_module;
 class buffer;
 class semaphore;
+class timeline_semaphore;
+class queue_timeline;
 class command_buffer;
 class command_builder;
+struct device_dispatch;
 class fence;
 class device_memory;
+class memory_allocator;
+class memory_allocation;
 class image;
 class event;
 class query_pool;
+class gpu_profiler;
+class gpu_zone;
+class trace_session;
 class buffer_view;
 class image_view;
 class pipeline_cache;
+class pipeline_cache_store;
+class pipeline_state_cache;
 class pipeline_layout;
 class render_pass;
 class pipeline;
 class descriptor_set_layout;
 class sampler;
 class descriptor_pool;
+class descriptor_allocator;
 class descriptor_set;
+class descriptor_update_template;
+class descriptor_writer;
 class framebuffer;
 class command_pool;
+class command_recycler;
+class thread_pool;
+class parallel_recorder;
+class pipeline_compiler;
 class surface;
 class swapchain;
 class swapchain_image;
+class submission;
+class frame_pacer;
 class display;
 class display_mode;
 
 class memory_barrier;
 class buffer_memory_barrier;
 class image_memory_barrier;
+class resource_tracker;
+class render_graph;
+class compute_kernel;
+class compute_launcher;
 
 enum class image_layout {
   undefined                = VK_IMAGE_LAYOUT_UNDEFINED,
@@ -332,6 +360,43 @@ inline pipeline_stage operator|(pipeline_stage lhs, pipeline_stage rhs) {
   return static_cast<pipeline_stage>(static_cast<T>(lhs) | static_cast<T>(rhs));
 }
 
+// Explicitly binary compatible with VkAccessFlagBits
+enum class access_mask: uint32_t {
+  none                           = 0,
+  indirect_command_read          = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+  index_read                     = VK_ACCESS_INDEX_READ_BIT,
+  vertex_attribute_read          = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+  uniform_read                   = VK_ACCESS_UNIFORM_READ_BIT,
+  input_attachment_read          = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,
+  shader_read                    = VK_ACCESS_SHADER_READ_BIT,
+  shader_write                   = VK_ACCESS_SHADER_WRITE_BIT,
+  colour_attachment_read         = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT,
+  colour_attachment_write        = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+  depth_stencil_attachment_read  = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+  depth_stencil_attachment_write = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+  transfer_read                  = VK_ACCESS_TRANSFER_READ_BIT,
+  transfer_write                 = VK_ACCESS_TRANSFER_WRITE_BIT,
+  host_read                      = VK_ACCESS_HOST_READ_BIT,
+  host_write                     = VK_ACCESS_HOST_WRITE_BIT,
+  memory_read                    = VK_ACCESS_MEMORY_READ_BIT,
+  memory_write                   = VK_ACCESS_MEMORY_WRITE_BIT,
+};
+
+inline access_mask operator|(access_mask lhs, access_mask rhs) {
+  using T = std::underlying_type_t<access_mask>;
+  return static_cast<access_mask>(static_cast<T>(lhs) | static_cast<T>(rhs));
+}
+
+enum class command_buffer_level {
+  primary   = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+  secondary = VK_COMMAND_BUFFER_LEVEL_SECONDARY
+};
+
+enum class subpass_contents {
+  inline_commands           = VK_SUBPASS_CONTENTS_INLINE,
+  secondary_command_buffers = VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+};
+
 enum class image_aspect: uint32_t {
   colour   = VK_IMAGE_ASPECT_COLOR_BIT,
   depth    = VK_IMAGE_ASPECT_DEPTH_BIT,
@@ -344,6 +409,108 @@ inline image_aspect operator|(image_aspect lhs, image_aspect rhs) {
   return static_cast<image_aspect>(static_cast<T>(lhs) | static_cast<T>(rhs));
 }
 
+// Explicitly binary compatible with VkImageUsageFlagBits
+enum class image_usage: uint32_t {
+  transfer_source          = VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+  transfer_destination     = VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+  sampled                  = VK_IMAGE_USAGE_SAMPLED_BIT,
+  storage                  = VK_IMAGE_USAGE_STORAGE_BIT,
+  colour_attachment        = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+  depth_stencil_attachment = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+  transient_attachment     = VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+  input_attachment         = VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
+};
+
+inline image_usage operator|(image_usage lhs, image_usage rhs) {
+  using T = std::underlying_type_t<image_usage>;
+  return static_cast<image_usage>(static_cast<T>(lhs) | static_cast<T>(rhs));
+}
+
+// Explicitly binary compatible with VkBufferUsageFlagBits
+enum class buffer_usage: uint32_t {
+  transfer_source      = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+  transfer_destination = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+  uniform_texel        = VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT,
+  storage_texel        = VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT,
+  uniform              = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+  storage              = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+  index                = VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+  vertex               = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+  indirect             = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+};
+
+inline buffer_usage operator|(buffer_usage lhs, buffer_usage rhs) {
+  using T = std::underlying_type_t<buffer_usage>;
+  return static_cast<buffer_usage>(static_cast<T>(lhs) | static_cast<T>(rhs));
+}
+
+enum class filter {
+  nearest = VK_FILTER_NEAREST,
+  linear  = VK_FILTER_LINEAR,
+};
+
+// Explicitly binary compatible with VkShaderStageFlagBits
+enum class shader_stage_mask: uint32_t {
+  vertex                  = VK_SHADER_STAGE_VERTEX_BIT,
+  tessellation_control    = VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT,
+  tessellation_evaluation = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT,
+  geometry                = VK_SHADER_STAGE_GEOMETRY_BIT,
+  fragment                = VK_SHADER_STAGE_FRAGMENT_BIT,
+  compute                 = VK_SHADER_STAGE_COMPUTE_BIT,
+  all_graphics            = VK_SHADER_STAGE_ALL_GRAPHICS,
+  all                     = VK_SHADER_STAGE_ALL,
+};
+
+inline shader_stage_mask operator|(shader_stage_mask lhs, shader_stage_mask rhs) {
+  using T = std::underlying_type_t<shader_stage_mask>;
+  return static_cast<shader_stage_mask>(static_cast<T>(lhs) | static_cast<T>(rhs));
+}
+
+enum class query_type {
+  occlusion           = VK_QUERY_TYPE_OCCLUSION,
+  pipeline_statistics = VK_QUERY_TYPE_PIPELINE_STATISTICS,
+  timestamp           = VK_QUERY_TYPE_TIMESTAMP,
+};
+
+// Explicitly binary compatible with VkQueryPipelineStatisticFlagBits
+enum class pipeline_statistic: uint32_t {
+  none                                  = 0,
+  input_assembly_vertices               = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT,
+  input_assembly_primitives             = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT,
+  vertex_shader_invocations             = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT,
+  geometry_shader_invocations           = VK_QUERY_PIPELINE_STATISTIC_GEOMETRY_SHADER_INVOCATIONS_BIT,
+  geometry_shader_primitives            = VK_QUERY_PIPELINE_STATISTIC_GEOMETRY_SHADER_PRIMITIVES_BIT,
+  clipping_invocations                  = VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT,
+  clipping_primitives                   = VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT,
+  fragment_shader_invocations           = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT,
+  tessellation_control_shader_patches   = VK_QUERY_PIPELINE_STATISTIC_TESSELLATION_CONTROL_SHADER_PATCHES_BIT,
+  tessellation_evaluation_shader_invocations = VK_QUERY_PIPELINE_STATISTIC_TESSELLATION_EVALUATION_SHADER_INVOCATIONS_BIT,
+  compute_shader_invocations            = VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT,
+};
+
+inline pipeline_statistic operator|(pipeline_statistic lhs, pipeline_statistic rhs) {
+  using T = std::underlying_type_t<pipeline_statistic>;
+  return static_cast<pipeline_statistic>(static_cast<T>(lhs) | static_cast<T>(rhs));
+}
+
+// Every device supports at least this many bytes of push constants, so
+// blocks up to this size are checked at compile time. Layouts check larger
+// ranges against the device's maxPushConstantsSize.
+constexpr uint32_t min_push_constants_size = 128;
+
+struct push_constant_range {
+  shader_stage_mask stages;
+  uint32_t offset;
+  uint32_t size;
+};
+
+// Compile time checks shared by the typed push_constants() calls.
+template<typename T>
+constexpr bool is_push_constant_block() {
+  return std::is_trivially_copyable<T>::value && 0 == sizeof(T) % 4 &&
+         sizeof(T) <= min_push_constants_size;
+}
+
 struct viewport {
   float x;
   float y;
@@ -376,8 +543,13 @@ struct component_mapping {
   swizzle a;
 };
 
+// One mip level of a range of array layers, as copies address images.
 class subresource {
-  
+public:
+  image_aspect aspect_mask;
+  uint32_t mip_level;
+  uint32_t base_array_layer;
+  uint32_t layer_count;
 };
 
 class subresource_range {
@@ -389,6 +561,60 @@ public:
   uint32_t layer_count;
 };
 
+class memory_barrier {
+public:
+  access_mask src_access;
+  access_mask dst_access;
+};
+
+class buffer_memory_barrier {
+public:
+  access_mask src_access;
+  access_mask dst_access;
+  uint32_t src_family;
+  uint32_t dst_family;
+  VkBuffer buffer;
+  VkDeviceSize offset;
+  VkDeviceSize size;
+};
+
+class image_memory_barrier {
+public:
+  access_mask src_access;
+  access_mask dst_access;
+  image_layout old_layout;
+  image_layout new_layout;
+  uint32_t src_family;
+  uint32_t dst_family;
+  VkImage image;
+  subresource_range range;
+};
+
+struct buffer_copy {
+  size_t src_offset;
+  size_t dst_offset;
+  size_t size;
+};
+
+// A row length or image height of 0 means the buffer is tightly packed to
+// the image extent.
+struct buffer_image_copy {
+  size_t buffer_offset;
+  uint32_t buffer_row_length;
+  uint32_t buffer_image_height;
+  vk::subresource subresource;
+  offset<3> image_offset;
+  extent<3> image_extent;
+};
+
+// Each region is a box between two corners, scaled to fit the destination.
+struct image_blit {
+  subresource src_subresource;
+  offset<3> src_offsets[2];
+  subresource dst_subresource;
+  offset<3> dst_offsets[2];
+};
+
 union clear_colour_value {
   float    float32[4];
   int32_t  int32[4];
@@ -404,6 +630,55 @@ public:
   I end() { return this->second; }
 };
 
+// A borrowed raw handle. Recording calls take these rather than wrappers so
+// that passing a resource doesn't touch its reference count, which is shared
+// between every thread recording against it. Wrappers convert implicitly. A
+// ref must not outlive the object it was taken from.
+template<typename H>
+class handle_ref {
+public:
+  handle_ref(H handle) : handle_{handle} { }
+
+  template<typename W,
+           typename = std::enable_if_t<
+             !std::is_same<std::decay_t<W>, handle_ref>::value &&
+             std::is_convertible<W&, H>::value>>
+  handle_ref(W &&wrapper) : handle_{static_cast<H>(wrapper)} { }
+
+  operator H() const { return handle_; }
+private:
+  H handle_;
+};
+
+using buffer_ref          = handle_ref<VkBuffer>;
+using image_ref           = handle_ref<VkImage>;
+using event_ref           = handle_ref<VkEvent>;
+using query_pool_ref      = handle_ref<VkQueryPool>;
+using pipeline_ref        = handle_ref<VkPipeline>;
+using pipeline_layout_ref = handle_ref<VkPipelineLayout>;
+using pipeline_cache_ref  = handle_ref<VkPipelineCache>;
+using render_pass_ref     = handle_ref<VkRenderPass>;
+using framebuffer_ref     = handle_ref<VkFramebuffer>;
+using descriptor_set_ref  = handle_ref<VkDescriptorSet>;
+using image_view_ref      = handle_ref<VkImageView>;
+using buffer_view_ref     = handle_ref<VkBufferView>;
+using sampler_ref         = handle_ref<VkSampler>;
+
+template<typename T>
+class span {
+public:
+  span(T *data, size_t size) : data_{data}, size_{size} { }
+
+  T* data() const { return data_; }
+  size_t size() const { return size_; }
+  T* begin() const { return data_; }
+  T* end() const { return data_ + size_; }
+  T& operator[](size_t index) const { return data_[index]; }
+private:
+  T *data_;
+  size_t size_;
+};
+
 class instance {
 public:
   using physical_device_iterator = std::vector<physical_device>::const_iterator;
@@ -422,7 +697,7 @@ private:
 class queue_family {
 private:
   queue_family(physical_device &physical_device, uint32_t index, uint32_t count,
-               VkQueueFlags flags);
+               VkQueueFlags flags, uint32_t timestamp_valid_bits);
 public:
   bool is_graphics_queue() const;
   bool is_compute_queue() const;
@@ -430,6 +705,9 @@ public:
   bool is_present_queue() const;
 
   bool is_surface_supported(surface surface) const;
+  // Meaningful bits in timestamps written on the family's queues, 0 when
+  // they don't support timestamps.
+  uint32_t timestamp_valid_bits() const;
 #ifdef VK_USE_PLATFORM_XLIB_KHR
   bool is_presentation_supported(Display *display, VisualID visual) const;
 #endif
@@ -458,6 +736,7 @@ public:
   const uint32_t count;
 private:
   VkQueueFlags flags_;
+  uint32_t timestamp_valid_bits_;
   physical_device &physical_device_;
 
   friend class physical_device;
@@ -479,6 +758,9 @@ public:
   memory_type_range memory_types() const;
   queue_family_range queue_families() const;
   std::vector<surface_format> surface_formats(surface surface) const;
+  const VkPhysicalDeviceLimits& limits() const;
+  const VkPhysicalDeviceProperties& properties() const;
+  const VkPhysicalDeviceFeatures& features() const;
 private: 
   VkPhysicalDevice handle_;
 
@@ -507,6 +789,7 @@ public:
   bool is_host_coherent() const;
   bool is_host_cached() const;
   bool is_lazily_allocated() const;
+  size_t heap_size() const;
 
 private:
   const VkMemoryType type_;
@@ -515,13 +798,42 @@ private:
   friend class physical_device;
 };
 
+enum class queue_role {
+  graphics,
+  compute,
+  transfer
+};
+
+struct queue_request {
+  queue_role role;
+  uint32_t family;
+  float priority;
+};
+
 class device {
 public:
+  // Picks a graphics family plus, where the hardware has them, a dedicated
+  // async compute family and a transfer-only family.
   device(const vk::physical_device&);
 
+  // Creates one queue per request. Requests against the same family get
+  // distinct queue indices until the family runs out, then share the last.
+  // Roles that aren't requested fall back to the graphics queue.
+  device(const vk::physical_device&, const queue_request *requests,
+         size_t request_count);
+
   operator VkDevice();
   queue get_queue(uint32_t family, uint32_t index);
+  queue get_queue(queue_role role);
+  uint32_t queue_family_index(queue_role role) const;
   const vk::physical_device& physical_device() const;
+  // The optional features the device was created with: the ones the library
+  // has a use for, where the hardware supports them.
+  const VkPhysicalDeviceFeatures& enabled_features() const;
+  // Whether VK_KHR_timeline_semaphore is available, and so enabled.
+  bool supports_timeline_semaphores() const;
+  // Entry points loaded for this device, see lib/vk/dispatch.h.
+  const device_dispatch& dispatch() const;
 
   void wait_idle();
 private:
@@ -531,17 +843,79 @@ private:
 
 class queue {
 private: 
-  queue(VkQueue handle);
+  queue(VkQueue handle, uint32_t family, const device_dispatch &dispatch);
 public:
+  uint32_t family() const { return family_; }
+
   void submit(command_buffer* buffers, size_t buffer_count);
+  void submit(command_buffer buffer, semaphore wait, pipeline_stage wait_stage,
+              semaphore signal, fence fence);
+  void submit(const submission &submission);
+  void submit(const submission &submission, fence fence);
+  // Signals value once all the batches have completed.
+  void submit(const submission &submission, timeline_semaphore semaphore,
+              uint64_t value);
   void present(swapchain_image image);
+  void present(swapchain_image image, semaphore wait);
   void wait_idle();
 private:
+  void submit_batches(const submission &submission, VkFence fence,
+                      VkSemaphore timeline = VK_NULL_HANDLE,
+                      uint64_t timeline_value = 0);
+
   VkQueue handle_;
+  uint32_t family_;
+  const device_dispatch *dispatch_;
 
   friend class device;
 };
 
+// Accumulates any number of batches, each with its own wait semaphores,
+// command buffers and signal semaphores, so they can be handed to the queue
+// in a single vkQueueSubmit. Only raw handles are recorded: the semaphores
+// and command buffers must outlive the submit. clear() keeps the storage, so
+// a submission reused every frame stops allocating once it has warmed up.
+class submission {
+public:
+  submission& next_batch();
+  submission& wait(semaphore semaphore, pipeline_stage stage);
+  submission& execute(command_buffer buffer);
+  submission& execute(command_buffer *buffers, size_t buffer_count);
+  submission& signal(semaphore semaphore);
+  // Timeline waits are for the counter to reach at least value, and timeline
+  // signals set it to value, which must be greater than its current one.
+  submission& wait(timeline_semaphore semaphore, uint64_t value, pipeline_stage stage);
+  submission& signal(timeline_semaphore semaphore, uint64_t value);
+
+  void clear();
+  bool empty() const;
+  size_t batch_count() const;
+private:
+  struct batch {
+    uint32_t first_wait, wait_count;
+    uint32_t first_buffer, buffer_count;
+    uint32_t first_signal, signal_count;
+    bool timeline;
+  };
+
+  batch& current();
+  batch& add_wait(VkSemaphore semaphore, uint64_t value, pipeline_stage stage);
+  batch& add_signal(VkSemaphore semaphore, uint64_t value);
+
+  std::vector<batch> batches_;
+  std::vector<VkSemaphore> waits_;
+  std::vector<VkPipelineStageFlags> wait_stages_;
+  // Values line up with the semaphores, and are ignored for binary ones.
+  std::vector<uint64_t> wait_values_;
+  std::vector<VkCommandBuffer> buffers_;
+  std::vector<VkSemaphore> signals_;
+  std::vector<uint64_t> signal_values_;
+  mutable std::vector<VkSubmitInfo> infos_;
+  mutable std::vector<VkTimelineSemaphoreSubmitInfoKHR> timeline_infos_;
+
+  friend class queue;
+};
+
 class shader_module {
 public:
   shader_module(device device, const uint32_t* code, size_t size_in_bytes);
@@ -554,11 +928,19 @@ private:
 
 class buffer {
 public:
+  // Usable as a storage buffer only.
   buffer(device device, size_t size_in_bytes);
+  buffer(device device, size_t size_in_bytes, buffer_usage usage);
 
   operator VkBuffer();
 
+  size_t size() const;
+
   void bind(device_memory memory, size_t offset, size_t size);
+  void bind(memory_allocation allocation);
+  size_t minimum_allocation_size() const;
+  size_t minimum_allocation_alignment() const;
+  uint32_t memory_type_bits() const;
 private:
   class impl;
   std::shared_ptr<impl> impl_;
@@ -568,6 +950,7 @@ class semaphore {
 public:
   semaphore(device device);
 
+  operator VkSemaphore();
 private:
   class impl;
   std::shared_ptr<impl> impl_;
@@ -581,13 +964,29 @@ public:
   operator VkCommandBuffer();
 
   void begin();
+  // Begins a secondary buffer that continues the given subpass.
+  void begin(render_pass_ref pass, uint32_t subpass, framebuffer_ref framebuffer);
   void end();
   void reset(bool release_all);
 
-  void bind_pipeline(pipeline pipeline);
-  void bind_descriptor_sets(pipeline_layout layout, descriptor_set* sets, size_t count);
+  void bind_pipeline(pipeline_ref pipeline);
+  void bind_descriptor_sets(pipeline_layout_ref layout, descriptor_set* sets, size_t count);
+  // One offset per dynamic buffer descriptor in the sets, in binding order.
+  void bind_descriptor_sets(pipeline_layout_ref layout, descriptor_set* sets, size_t count,
+                            const uint32_t *dynamic_offsets, size_t offset_count);
   void dispatch(uint32_t x, uint32_t y = 1, uint32_t z = 1);
 
+  template<typename T>
+  void push_constants(pipeline_layout_ref layout, shader_stage_mask stages,
+                      uint32_t offset, const T &value) {
+    static_assert(is_push_constant_block<T>(),
+                  "Push constants must be trivially copyable, a multiple of "
+                  "4 bytes and fit in min_push_constants_size.");
+    push_constants(layout, stages, offset, &value, sizeof(T));
+  }
+  void push_constants(pipeline_layout_ref layout, shader_stage_mask stages,
+                      uint32_t offset, const void *data, uint32_t size);
+
   template<typename F>
   void record(F f) {
     command_builder builder{*this};
@@ -596,10 +995,13 @@ public:
     end();
   }
 private:
+  const device_dispatch& dispatch_table() const;
+
   class impl;
   std::shared_ptr<impl> impl_;
 
   friend class command_pool;
+  friend class command_builder;
 };
 
 using stage_mask = uint32_t;
@@ -609,44 +1011,182 @@ private:
   command_builder(command_buffer &buffer);
 
 public:
-  void bind_index_buffer(buffer buffer, size_t offset, index_type type);
-  void clear_colour_image(image image, image_layout layout, 
+  // Queue family ownership transfers. The release is recorded on a queue
+  // from the source family and the matching acquire, with identical
+  // arguments, on a queue from the destination family. Images may change
+  // layout as part of the transfer.
+  void acquire_ownership(buffer_ref buffer, uint32_t src_family,
+                         uint32_t dst_family, pipeline_stage dst_stage);
+  void acquire_ownership(image_ref image, const subresource_range &range,
+                         image_layout old_layout, image_layout new_layout,
+                         uint32_t src_family, uint32_t dst_family,
+                         pipeline_stage dst_stage);
+  void begin_render_pass(render_pass_ref pass, framebuffer_ref framebuffer,
+                         const rect<2> &area,
+                         const clear_colour_value *clear_values,
+                         uint32_t clear_value_count,
+                         subpass_contents contents);
+  // Precise occlusion queries need the occlusionQueryPrecise feature.
+  void begin_query(query_pool_ref pool, uint32_t index, bool precise = false);
+  // Compute bind point, as on command_buffer.
+  void bind_descriptor_sets(pipeline_layout_ref layout, const descriptor_set_ref *sets,
+                            uint32_t count);
+  // One offset per dynamic buffer descriptor in the sets, in binding order.
+  void bind_descriptor_sets(pipeline_layout_ref layout, const descriptor_set_ref *sets,
+                            uint32_t count, const uint32_t *dynamic_offsets,
+                            uint32_t offset_count);
+  void bind_index_buffer(buffer_ref buffer, size_t offset, index_type type);
+  void bind_pipeline(pipeline_ref pipeline);
+  // Formats must support blitting, and the linear filter needs linear
+  // filtering support on the source format.
+  void blit_image(image_ref src, image_layout src_layout,
+                  image_ref dst, image_layout dst_layout,
+                  const image_blit *regions, uint32_t region_count,
+                  vk::filter filter);
+  // Inside a render pass, clears a colour attachment of the current subpass
+  // within area, on the first layer.
+  void clear_colour_attachment(uint32_t attachment, const clear_colour_value &colour,
+                               const rect<2> &area);
+  void clear_colour_image(image_ref image, image_layout layout, 
                           const clear_colour_value &colour,
                           const subresource_range *ranges,
                           uint32_t range_count);
+  // Source buffers need transfer_source usage and destinations
+  // transfer_destination.
+  void copy_buffer(buffer_ref src, buffer_ref dst, const buffer_copy *regions,
+                   uint32_t region_count);
+  void copy_buffer_to_image(buffer_ref src, image_ref dst, image_layout dst_layout,
+                            const buffer_image_copy *regions,
+                            uint32_t region_count);
+  void copy_image_to_buffer(image_ref src, image_layout src_layout, buffer_ref dst,
+                            const buffer_image_copy *regions,
+                            uint32_t region_count);
   void dispatch(uint32_t x, uint32_t y = 1, uint32_t z = 1);
-  void dispatch_indirect(buffer buffer, size_t offset = 0);
+  void dispatch_indirect(buffer_ref buffer, size_t offset = 0);
   void draw(uint32_t vertex_count, uint32_t instance_count,
             uint32_t first_vertex, uint32_t first_instance);
   void draw_indexed(uint32_t index_count, uint32_t instance_count,
                     uint32_t fisrt_index, int32_t vertex_offset, uint32_t first_instance);
-  void draw_indirect(buffer buffer, size_t offset,
+  void draw_indirect(buffer_ref buffer, size_t offset,
                      uint32_t draw_count, uint32_t stride);
-  void draw_indexed_indirect(buffer buffer, size_t offset,
+  void draw_indexed_indirect(buffer_ref buffer, size_t offset,
                              uint32_t draw_count, uint32_t stride);
-  void end_query(query_pool pool, uint32_t index);
+  void end_query(query_pool_ref pool, uint32_t index);
   void end_render_pass();
   void execute_commands(command_buffer* buffers, uint32_t buffer_count);
-  void fill_buffer(buffer buffer, size_t offset, uint32_t value, ssize_t size);
-  void pipeline_barrier(const memory_barrier *barriers,
+  void fill_buffer(buffer_ref buffer, size_t offset, uint32_t value, ssize_t size);
+  void pipeline_barrier(pipeline_stage src_stages, pipeline_stage dst_stages,
+                        const memory_barrier *barriers,
                         uint32_t barrier_count,
-                        const buffer_memory_barrier * buffer_barriers,
+                        const buffer_memory_barrier *buffer_barriers,
                         uint32_t buffer_barrier_count,
                         const image_memory_barrier *image_barriers,
-                        uint32_t image_barrier_count, 
-                        image image, image_layout layout);
-  void reset_event(event event, pipeline_stage stage_mask);
-  void set_event(event event, pipeline_stage stage_mask);
+                        uint32_t image_barrier_count);
+  // A zone timed by the profiler until the returned object goes out of scope.
+  gpu_zone profile(gpu_profiler &profiler, const char *name);
+  template<typename T>
+  void push_constants(pipeline_layout_ref layout, shader_stage_mask stages,
+                      uint32_t offset, const T &value) {
+    static_assert(is_push_constant_block<T>(),
+                  "Push constants must be trivially copyable, a multiple of "
+                  "4 bytes and fit in min_push_constants_size.");
+    push_constants(layout, stages, offset, &value, sizeof(T));
+  }
+  void push_constants(pipeline_layout_ref layout, shader_stage_mask stages,
+                      uint32_t offset, const void *data, uint32_t size);
+  void release_ownership(buffer_ref buffer, uint32_t src_family,
+                         uint32_t dst_family, pipeline_stage src_stage);
+  void release_ownership(image_ref image, const subresource_range &range,
+                         image_layout old_layout, image_layout new_layout,
+                         uint32_t src_family, uint32_t dst_family,
+                         pipeline_stage src_stage);
+  void reset_event(event_ref event, pipeline_stage stage_mask);
+  // Queries have to be reset before they are begun or written, outside a
+  // render pass.
+  void reset_query_pool(query_pool_ref pool, uint32_t first, uint32_t count);
+  void set_event(event_ref event, pipeline_stage stage_mask);
   void set_line_width(float width);
   void set_depth_bias(float constant_factor, float clamp, float slope_factor);
   void set_depth_bounds(float min, float max);
-  void set_event(event event, stage_mask mask);
+  void set_event(event_ref event, stage_mask mask);
   void set_viewports(viewport *viewports, size_t viewport_count);
-  void update_buffer(buffer dst, size_t offset, const void *src, size_t size);
+  // Offset and size must be multiples of 4, and size at most 65536.
+  void update_buffer(buffer_ref dst, size_t offset, const void *src, size_t size);
+  // The second half of a split barrier. Src stages must cover the stages
+  // the events were set with.
+  void wait_events(const event_ref *events, uint32_t event_count,
+                   pipeline_stage src_stages, pipeline_stage dst_stages,
+                   const memory_barrier *barriers,
+                   uint32_t barrier_count,
+                   const buffer_memory_barrier *buffer_barriers,
+                   uint32_t buffer_barrier_count,
+                   const image_memory_barrier *image_barriers,
+                   uint32_t image_barrier_count);
+  void write_timestamp(pipeline_stage stage, query_pool_ref pool, uint32_t index);
 private:
-  command_buffer &buffer_;
+  VkCommandBuffer handle_;
+  const device_dispatch *dispatch_;
 
   friend class command_buffer;
+  friend class parallel_recorder;
+};
+
+// Barriers taken out of a resource_tracker to be recorded later, possibly
+// into another command buffer or on another thread.
+struct barrier_set {
+  pipeline_stage src_stages;
+  pipeline_stage dst_stages;
+  std::vector<memory_barrier> memory;
+  std::vector<image_memory_barrier> images;
+
+  bool empty() const { return 0 == static_cast<uint32_t>(dst_stages); }
+  void record(command_builder &builder) const;
+};
+
+// Tracks the layout and last accesses of buffers and image subresources
+// across everything recorded with it, in submission order, and works out the
+// barriers each new use needs. Reads after a read need nothing, and reads in
+// stages a previous barrier already made a write visible to need nothing
+// more. Everything pending goes out as one barrier at the next flush. Accesses
+// that don't change a layout are folded into a single global memory barrier,
+// which is cheaper for drivers than a list of buffer barriers.
+//
+// Buffers are tracked whole. Images are tracked per mip level and array
+// layer, and must be registered with track() before their first use.
+//
+// Not thread safe.
+class resource_tracker {
+public:
+  resource_tracker();
+
+  // ready_stage is the stage a semaphore wait guarding the image's first use
+  // was made at, e.g. for a swapchain image; first barriers wait on it.
+  void track(image_ref image, image_layout layout, image_aspect aspect,
+             uint32_t mip_count = 1, uint32_t layer_count = 1,
+             pipeline_stage ready_stage = pipeline_stage::top_of_pipe);
+  void forget(image_ref image);
+  void forget(buffer_ref buffer);
+
+  // Declares the next use of a resource, queueing any barrier it needs.
+  void use(buffer_ref buffer, pipeline_stage stage, access_mask access);
+  void use(image_ref image, const subresource_range &range,
+           pipeline_stage stage, access_mask access, image_layout layout);
+
+  image_layout layout(image_ref image, uint32_t mip_level = 0,
+                      uint32_t array_layer = 0) const;
+  bool pending() const;
+
+  // Records the pending barriers with one vkCmdPipelineBarrier.
+  void flush(command_builder &builder);
+  // Splits the pending barriers: sets the event now, and wait() records the
+  // barriers once the work in between has been recorded.
+  void flush(command_builder &builder, event_ref event);
+  void wait(command_builder &builder, event_ref event);
+  // Hands over the pending barriers instead of recording them.
+  barrier_set take();
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
 };
 
 enum class wait_result {
@@ -682,11 +1222,89 @@ private:
   std::shared_ptr<impl> impl_;
 };
 
+// A semaphore holding a 64 bit counter that only goes up. Submissions and the
+// host can both wait for it to reach a value and signal it to a value, and
+// unlike a fence it never has to be reset. Needs VK_KHR_timeline_semaphore,
+// see device::supports_timeline_semaphores().
+class timeline_semaphore {
+public:
+  explicit timeline_semaphore(device device, uint64_t initial_value = 0);
+
+  uint64_t current_value() const;
+  wait_result wait(uint64_t value, uint64_t timeout);
+  // Sets the counter from the host. Value must be greater than the current
+  // one and than any pending signal.
+  void signal(uint64_t value);
+
+  static wait_result wait_all(timeline_semaphore *semaphores, const uint64_t *values,
+                              uint32_t semaphore_count, uint64_t timeout) {
+    return wait(semaphores, values, semaphore_count, true, timeout);
+  }
+  static wait_result wait_any(timeline_semaphore *semaphores, const uint64_t *values,
+                              uint32_t semaphore_count, uint64_t timeout) {
+    return wait(semaphores, values, semaphore_count, false, timeout);
+  }
+
+  operator VkSemaphore();
+
+private:
+  static wait_result wait(timeline_semaphore *semaphores, const uint64_t *values,
+                          uint32_t semaphore_count, bool wait_all,
+                          uint64_t timeout);
+
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
+// Counts the work submitted to one queue on a timeline semaphore. Each
+// submit() signals the next value and returns it, so that value can be
+// polled or waited on in place of a fence per submit. Other queues depend on
+// the work with submission::wait(timeline.semaphore(), value, stage).
+//
+// Not thread safe.
+class queue_timeline {
+public:
+  queue_timeline(device device, queue queue);
+
+  uint64_t submit(const submission &submission);
+  // The value the latest submit signals.
+  uint64_t last_submitted() const;
+  // Only asks the device when the last answer it gave was behind value.
+  bool is_complete(uint64_t value) const;
+  uint64_t completed_value() const;
+  wait_result wait(uint64_t value, uint64_t timeout);
+
+  timeline_semaphore& semaphore();
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
 class device_memory {
 public:
   device_memory(device, const physical_device::memory_type&, size_t); 
 
+  // Maps the whole allocation once and keeps it mapped until destruction.
+  // The memory type must be host visible.
+  device_memory(device, const physical_device::memory_type&, size_t,
+                bool persistently_mapped);
+
   size_t get_commitment() const;
+
+  bool is_persistently_mapped() const;
+  void* mapped_data() const;
+
+  template<typename T>
+  span<T> mapped_span(size_t offset, size_t count) const {
+    auto data = static_cast<char*>(mapped_data()) + offset;
+    return span<T>{reinterpret_cast<T*>(data), count};
+  }
+
+  // Make host writes visible to the device, or device writes visible to the
+  // host. Ranges are widened to nonCoherentAtomSize, and both are no-ops on
+  // host coherent memory.
+  void flush(size_t offset, size_t size);
+  void invalidate(size_t offset, size_t size);
 public:
   operator VkDeviceMemory();
 
@@ -701,6 +1319,101 @@ private:
 bool map_memory(device_memory, size_t, size_t, void **);
 void unmap_memory(device_memory memory);
 
+class memory_allocation {
+private:
+  class impl;
+  memory_allocation(std::shared_ptr<impl> impl);
+
+public:
+  vk::device_memory memory() const;
+  size_t offset() const;
+  size_t size() const;
+
+  // Only valid for allocations from host visible memory types, whose blocks
+  // are persistently mapped.
+  void* mapped_data() const;
+
+  template<typename T>
+  span<T> mapped_span(size_t count) const {
+    return span<T>{static_cast<T*>(mapped_data()), count};
+  }
+
+  void flush();
+  void invalidate();
+
+private:
+  std::shared_ptr<impl> impl_;
+
+  friend class memory_allocator;
+};
+
+struct memory_statistics {
+  size_t block_count;
+  size_t allocation_count;
+  size_t bytes_reserved;
+  size_t bytes_allocated;
+  size_t free_range_count;
+  size_t largest_free_range;
+
+  // The fraction of free bytes that can't be handed out as a single range,
+  // zero when all free space is contiguous.
+  float fragmentation() const;
+};
+
+class memory_allocator {
+public:
+  memory_allocator(device device, size_t block_size = 64 * 1024 * 1024);
+
+  memory_allocation allocate(const physical_device::memory_type &memory_type,
+                             size_t size, size_t alignment, bool linear);
+  memory_allocation allocate(const physical_device::memory_type &memory_type,
+                             const buffer &buffer);
+  memory_allocation allocate(const physical_device::memory_type &memory_type,
+                             const image &image);
+
+  memory_statistics statistics() const;
+  memory_statistics statistics(const physical_device::memory_type &memory_type) const;
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+
+  friend class memory_allocation;
+};
+
+// Streams data into buffers, typically device local ones, through a fixed
+// size staging ring in persistently mapped host visible memory. upload()
+// copies the data into the ring straight away. record() then makes one
+// vkCmdCopyBuffer per destination, merging uploads that are contiguous in
+// both, and one barrier making the copies visible to later work. It hands
+// back a fence that the submission must signal. Ring space is reused once
+// that fence has signaled.
+//
+// Writes of at most update_threshold bytes, with offset and size multiples
+// of 4, skip the ring and are recorded with update_buffer.
+//
+// Uploads to overlapping ranges between two records land in no particular
+// order. Not thread safe.
+class staging_uploader {
+public:
+  staging_uploader(device device, const physical_device::memory_type &memory_type,
+                   size_t ring_size, size_t update_threshold = 256);
+
+  // Stages as much of the data as the ring has room for, and returns how many
+  // bytes that was. Fewer than size means the ring is full of data the GPU
+  // hasn't copied yet: record and submit, then upload the rest.
+  size_t upload(buffer_ref dst, size_t offset, const void *data, size_t size);
+
+  // Records the uploads made since the last record.
+  fence record(command_builder &builder, pipeline_stage dst_stages,
+               access_mask dst_access);
+
+  // Bytes of the ring in use, by uploads not yet recorded or still in flight.
+  size_t used() const;
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
 class image {
 protected:
   image(vk::device device, VkImage handle, bool owns_handle);
@@ -708,9 +1421,13 @@ protected:
 public:
   image(vk::device device, texel_format format, extent<3> extent,
         uint32_t mip_levels, uint32_t array_layers);
+  image(vk::device device, texel_format format, extent<3> extent,
+        uint32_t mip_levels, uint32_t array_layers, image_usage usage);
   void bind(device_memory memory, size_t offset, size_t size);
+  void bind(memory_allocation allocation);
   size_t minimum_allocation_size() const;
   size_t minimum_allocation_alignment() const;
+  uint32_t memory_type_bits() const;
 
   vk::device& device();
   const vk::device& device() const;
@@ -738,7 +1455,20 @@ private:
 
 class query_pool {
 public:
-  query_pool(device device);
+  // Statistics only apply to, and are required for, pipeline statistics
+  // pools, which also need the device's pipelineStatisticsQuery feature.
+  query_pool(device device, query_type type, uint32_t count,
+             pipeline_statistic statistics = pipeline_statistic::none);
+
+  query_type type() const;
+  uint32_t count() const;
+  // Values each query produces: one, or one per statistic.
+  uint32_t value_count() const;
+
+  // Copies the 64 bit values of count queries, value_count() per query,
+  // without waiting. Returns false if any of them aren't available yet, in
+  // which case only the available ones were written.
+  bool results(uint32_t first, uint32_t count, uint64_t *values) const;
 
   operator VkQueryPool();
 private:
@@ -746,10 +1476,90 @@ private:
   std::shared_ptr<impl> impl_;
 };
 
+// Times nested zones of GPU work with timestamp queries and, if asked to,
+// counts pipeline statistics for the outermost zones. Each of frame_count
+// frames in flight records into its own slice of the pools, and a slice's
+// results are read when it comes around again. By then the frame that used
+// it has normally been waited for, so reading never stalls; frames whose
+// results still aren't available are dropped instead.
+//
+// Zones are recorded into one command buffer at a time, and not thread safe.
+class gpu_profiler {
+public:
+  struct zone_timing {
+    std::string name;
+    uint64_t frame;
+    uint32_t depth;
+    // Nanoseconds on the queue's timestamp clock.
+    double begin;
+    double end;
+    // One value per requested statistic, lowest bit first. Empty for
+    // nested zones.
+    std::vector<uint64_t> statistics;
+  };
+
+  // Timestamps are written on queues from queue_family, which must support
+  // them. Zones past max_zones in a frame are not timed.
+  gpu_profiler(device device, uint32_t queue_family, uint32_t frame_count,
+               uint32_t max_zones,
+               pipeline_statistic statistics = pipeline_statistic::none);
+
+  // Collects the results of the frame that last used the next slice and
+  // resets it. Record before the frame's zones, outside a render pass.
+  void begin_frame(command_builder &builder);
+  // Zones with statistics can't cross a render pass boundary.
+  void begin_zone(command_builder &builder, const char *name);
+  void end_zone(command_builder &builder);
+
+  // Zones of the frames collected so far, in frame order.
+  const std::vector<zone_timing>& zones() const;
+  uint64_t dropped_frames() const;
+  void clear();
+
+  // The collected zones as Chrome trace-event JSON, for chrome://tracing or
+  // Perfetto.
+  void write_trace(std::ostream &out) const;
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
+class gpu_zone {
+public:
+  gpu_zone(gpu_profiler &profiler, command_builder &builder, const char *name);
+  gpu_zone(gpu_zone &&other);
+  gpu_zone(const gpu_zone&) = delete;
+  gpu_zone& operator=(const gpu_zone&) = delete;
+  ~gpu_zone();
+private:
+  gpu_profiler *profiler_;
+  command_builder *builder_;
+};
+
+// While alive, times the library's submits, waits, presents, acquires,
+// allocations, pipeline creation and descriptor updates on the CPU, and
+// streams them to path as Chrome trace-event JSON from a background thread.
+// Each calling thread writes into its own lock free ring, and events that
+// find their ring full are dropped. With no session running the hooks cost a
+// relaxed load, and builds without ENABLE_TRACING compile them out.
+//
+// One session at a time.
+class trace_session {
+public:
+  explicit trace_session(const char *path);
+
+  // Events lost to full rings so far.
+  uint64_t dropped() const;
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
 class buffer_view {
 public:
   buffer_view(device device, buffer buffer, texel_format format, size_t offset, size_t range);
 
+  operator VkBufferView();
 private:
   class impl;
   std::shared_ptr<impl> impl_;
@@ -777,6 +1587,7 @@ private:
 
 class pipeline_cache {
 public:
+  explicit pipeline_cache(device device);
   pipeline_cache(device device, const void *data, size_t size_in_bytes);
 
   operator VkPipelineCache();
@@ -789,10 +1600,31 @@ private:
   std::shared_ptr<impl> impl_;
 };
 
+// A pipeline cache kept in a file between runs. The file is only used when
+// its header matches this device and driver, otherwise the cache starts out
+// empty. Threads compiling into caches of their own fold them back in with
+// merge(), and save() replaces the file atomically.
+class pipeline_cache_store {
+public:
+  pipeline_cache_store(device device, const char *path);
+
+  pipeline_cache cache();
+  // Whether the contents of the file were accepted.
+  bool loaded() const;
+  void merge(pipeline_cache *caches, size_t cache_count);
+  bool save();
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
 class pipeline_layout {
 public:
   pipeline_layout(device device, descriptor_set_layout* layouts, 
                   size_t layout_count);
+  pipeline_layout(device device, descriptor_set_layout* layouts,
+                  size_t layout_count, const push_constant_range *ranges,
+                  size_t range_count);
   operator VkPipelineLayout();
 private:
   class impl;
@@ -874,10 +1706,54 @@ protected:
   std::shared_ptr<impl> impl_;
 };
 
+// Values for a shader's specialization constants. Constants are kept sorted
+// by ID with their values packed in that order, so the same constants
+// compare and hash equal however they were set. Values must be 32 or 64 bit
+// scalars, so booleans go in as VkBool32.
+class specialization {
+public:
+  template<typename T>
+  specialization& set(uint32_t constant_id, const T &value) {
+    static_assert((std::is_arithmetic<T>::value || std::is_enum<T>::value) &&
+                  (4 == sizeof(T) || 8 == sizeof(T)),
+                  "Specialization constants must be 32 or 64 bit scalars.");
+    set(constant_id, &value, sizeof(T));
+    return *this;
+  }
+
+  // Takes the listed members of a struct as constants 0, 1, 2 and so on,
+  // e.g. specialization::from(tuning, &tuning::local_size, &tuning::unroll).
+  template<typename S, typename... M>
+  static specialization from(const S &values, M S::*... members) {
+    specialization constants;
+    uint32_t constant_id = 0;
+    int expand[] = {0, (constants.set(constant_id++, values.*members), 0)...};
+    (void)expand;
+    return constants;
+  }
+
+  bool empty() const { return entries_.empty(); }
+  // Points into this object, so only valid while it is unchanged.
+  VkSpecializationInfo info() const;
+  size_t hash() const;
+  bool operator==(const specialization &other) const;
+  bool operator!=(const specialization &other) const;
+private:
+  void set(uint32_t constant_id, const void *value, size_t size);
+
+  std::vector<VkSpecializationMapEntry> entries_;
+  std::vector<uint8_t> data_;
+};
+
 class compute_pipeline: public pipeline {
 public:
   compute_pipeline(device device, pipeline_layout layout,
-                   shader_module module, const char* entry_point);
+                   shader_module module, const char* entry_point,
+                   pipeline_cache_ref cache = VK_NULL_HANDLE);
+  compute_pipeline(device device, pipeline_layout layout,
+                   shader_module module, const char* entry_point,
+                   const specialization &constants,
+                   pipeline_cache_ref cache = VK_NULL_HANDLE);
 };
 
 class pipeline_shader {
@@ -891,14 +1767,18 @@ public:
   };
   pipeline_shader(shader_stage stage, shader_module module,
                   const char *entry_point);
+  pipeline_shader(shader_stage stage, shader_module module,
+                  const char *entry_point, specialization constants);
 
   shader_stage stage() const;
   shader_module module() const;
   const char *name() const;
+  const specialization& constants() const;
 private:
   shader_stage stage_;
   shader_module module_;
   const char *name_;
+  specialization constants_;
 };
 
 class vertex_input_binding {
@@ -981,19 +1861,99 @@ public:
                     const viewport_state &viewport_state,
                     const rasterization_state &raster_state,
                     pipeline_layout layout, 
-                    render_pass render_pass);
+                    render_pass render_pass,
+                    pipeline_cache_ref cache = VK_NULL_HANDLE);
+};
+
+// Everything graphics_pipeline consumes, flattened so that equivalent state
+// compares and hashes equal. Stages are ordered by stage, so the order they
+// were listed in doesn't matter. Modules, layouts and render passes compare
+// by handle.
+class pipeline_state_key {
+public:
+  pipeline_state_key(const pipeline_shader *stages, uint32_t stage_count,
+                     const vertex_input_state &vertex_state,
+                     const input_assembly_state &assembly_state,
+                     const viewport_state &viewport_state,
+                     const rasterization_state &raster_state,
+                     pipeline_layout_ref layout, render_pass_ref render_pass);
+
+  size_t hash() const { return hash_; }
+  bool operator==(const pipeline_state_key &other) const;
+  bool operator!=(const pipeline_state_key &other) const;
+private:
+  std::vector<uint64_t> words_;
+  size_t hash_;
+};
+
+// Hands out one graphics_pipeline per distinct pipeline_state_key, so
+// repeated requests for the same state don't recompile. Safe to use from
+// several threads; a thread asking for state that is still compiling waits
+// for that compile instead of starting its own. Keys compare shader modules,
+// layouts and render passes by handle, so each entry keeps the ones it was
+// built from alive until clear().
+class pipeline_state_cache {
+public:
+  explicit pipeline_state_cache(device device);
+  pipeline_state_cache(device device, pipeline_cache cache);
+
+  graphics_pipeline get(const pipeline_shader *stages, uint32_t stage_count,
+                        const vertex_input_state &vertex_state,
+                        const input_assembly_state &assembly_state,
+                        const viewport_state &viewport_state,
+                        const rasterization_state &raster_state,
+                        pipeline_layout layout, vk::render_pass render_pass);
+
+  void clear();
+  size_t size() const;
+  uint64_t hits() const;
+  uint64_t misses() const;
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
+enum class descriptor_type: uint32_t {
+  sampler                = VK_DESCRIPTOR_TYPE_SAMPLER,
+  combined_image_sampler = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+  sampled_image          = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+  storage_image          = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+  uniform_texel_buffer   = VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER,
+  storage_texel_buffer   = VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,
+  uniform_buffer         = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+  storage_buffer         = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+  uniform_buffer_dynamic = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+  storage_buffer_dynamic = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+  input_attachment       = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+};
+
+// Explicitly binary compatible with VkDescriptorPoolSize
+struct descriptor_pool_size {
+  descriptor_type type;
+  uint32_t count;
 };
 
 class descriptor_set_layout_binding {
 public:
+  // A single storage buffer visible to every stage.
   descriptor_set_layout_binding(uint32_t index)
-  : binding_index_{index} { }
+  : descriptor_set_layout_binding(index, descriptor_type::storage_buffer) { }
+
+  descriptor_set_layout_binding(uint32_t index, descriptor_type type,
+                                uint32_t count = 1,
+                                shader_stage_mask stages = shader_stage_mask::all)
+  : binding_index_{index}, type_{type}, count_{count}, stages_{stages} { }
 
   uint32_t get_index() const { return binding_index_; }
+  descriptor_type type() const { return type_; }
+  uint32_t count() const { return count_; }
+  shader_stage_mask stages() const { return stages_; }
 
 private:
   uint32_t binding_index_;
-
+  descriptor_type type_;
+  uint32_t count_;
+  shader_stage_mask stages_;
 };
 
 class descriptor_set_layout {
@@ -1002,6 +1962,8 @@ public:
                         size_t binding_count);
 
   operator VkDescriptorSetLayout();
+  // Descriptors of each type one set with this layout takes from a pool.
+  const std::vector<descriptor_pool_size>& descriptor_counts() const;
 private:
   class impl;
   std::shared_ptr<impl> impl_;
@@ -1011,6 +1973,7 @@ class sampler {
 public:
   sampler(device device);
 
+  operator VkSampler();
 private:
   class impl;
   std::shared_ptr<impl> impl_;
@@ -1019,6 +1982,10 @@ private:
 class descriptor_pool {
 public:
   descriptor_pool(device device, uint32_t max_sets);
+  // Without free_sets, sets are only released all at once by reset().
+  descriptor_pool(device device, uint32_t max_sets,
+                  const descriptor_pool_size *sizes, size_t size_count,
+                  bool free_sets);
 
   operator VkDescriptorPool();
   descriptor_set allocate(descriptor_set_layout layout);
@@ -1027,6 +1994,113 @@ public:
 private:
   class impl;
   std::shared_ptr<impl> impl_;
+
+  friend class descriptor_set;
+  friend class descriptor_allocator;
+};
+
+// Hands out descriptor sets from a chain of pools, adding a pool whenever
+// the ones it has run out. Pools are sized so that sets_per_pool sets of any
+// mix of the given layouts fit in one.
+//
+// With a frame count, each frame slot gets its own chain and sets are never
+// freed individually. Once the fence guarding a slot has signaled,
+// begin_frame() resets the slot's pools in one go and allocation starts
+// again from the first. Without one, sets go back to their pool when the
+// last copy is destroyed.
+//
+// Not thread safe; give each recording thread its own allocator.
+class descriptor_allocator {
+public:
+  descriptor_allocator(device device, const descriptor_set_layout *layouts,
+                       size_t layout_count, uint32_t sets_per_pool);
+  descriptor_allocator(device device, const descriptor_set_layout *layouts,
+                       size_t layout_count, uint32_t sets_per_pool,
+                       uint32_t frame_count);
+
+  void begin_frame(uint32_t frame);
+  descriptor_set allocate(descriptor_set_layout layout);
+  // Pools created so far, across every frame slot.
+  size_t pool_count() const;
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
+// Explicitly binary compatible with VkDescriptorBufferInfo
+struct descriptor_buffer_info {
+  VkBuffer buffer;
+  VkDeviceSize offset;
+  VkDeviceSize range;
+};
+
+// Explicitly binary compatible with VkDescriptorImageInfo
+struct descriptor_image_info {
+  VkSampler sampler;
+  VkImageView image_view;
+  image_layout layout;
+};
+
+// Explicitly binary compatible with VkDescriptorUpdateTemplateEntry. Offset
+// and stride locate the descriptors' infos in the data passed to an update:
+// descriptor_buffer_info, descriptor_image_info or a VkBufferView depending
+// on the type.
+struct descriptor_update_entry {
+  uint32_t binding;
+  uint32_t array_element;
+  uint32_t count;
+  descriptor_type type;
+  size_t offset;
+  size_t stride;
+};
+
+// Writes every descriptor of a set from one packed struct, so the driver
+// reads it directly instead of walking a list of writes.
+class descriptor_update_template {
+public:
+  descriptor_update_template(device device, descriptor_set_layout layout,
+                             const descriptor_update_entry *entries,
+                             size_t entry_count);
+
+  operator VkDescriptorUpdateTemplateKHR();
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
+// Collects descriptor writes for any number of sets and applies them with a
+// single vkUpdateDescriptorSets. Storage is kept between flushes, so a writer
+// reused every frame stops allocating once it has seen the largest batch.
+class descriptor_writer {
+public:
+  explicit descriptor_writer(device device);
+
+  void write_buffer(descriptor_set_ref set, uint32_t binding, descriptor_type type,
+                    buffer_ref buffer, VkDeviceSize offset = 0,
+                    VkDeviceSize range = VK_WHOLE_SIZE, uint32_t array_element = 0);
+  // The sampler is ignored for image types that don't take one.
+  void write_image(descriptor_set_ref set, uint32_t binding, descriptor_type type,
+                   image_view_ref view, image_layout layout,
+                   sampler_ref sampler = VK_NULL_HANDLE, uint32_t array_element = 0);
+  void write_sampler(descriptor_set_ref set, uint32_t binding, sampler_ref sampler,
+                     uint32_t array_element = 0);
+  void write_texel_buffer(descriptor_set_ref set, uint32_t binding, descriptor_type type,
+                          buffer_view_ref view, uint32_t array_element = 0);
+
+  size_t size() const;
+  void flush();
+private:
+  void push_write(VkDescriptorSet set, uint32_t binding, descriptor_type type,
+                  uint32_t array_element, size_t info_index);
+
+  device device_;
+  std::vector<VkWriteDescriptorSet> writes_;
+  // Infos live in their own arrays, which may move as they grow. Writes
+  // hold an index into the matching array until flush() points them at it.
+  std::vector<size_t> info_indices_;
+  std::vector<VkDescriptorBufferInfo> buffer_infos_;
+  std::vector<VkDescriptorImageInfo> image_infos_;
+  std::vector<VkBufferView> texel_buffer_views_;
 };
 
 class descriptor_binding {
@@ -1045,11 +2119,20 @@ public:
   operator VkDescriptorSet();
 
   void update(descriptor_binding* bindings, size_t binding_count);
+  void update(descriptor_update_template &update_template, const void *data);
+
+  template<typename T>
+  void update(descriptor_update_template &update_template, const T &data) {
+    static_assert(std::is_standard_layout<T>::value,
+                  "Template data is read at fixed byte offsets.");
+    update(update_template, static_cast<const void*>(&data));
+  }
 private:
   class impl;
   std::shared_ptr<impl> impl_;
 
   friend class descriptor_pool;
+  friend class descriptor_allocator;
 };
 
 class framebuffer {
@@ -1058,6 +2141,7 @@ public:
               image_view *attachments, size_t attachment_count,
               uint32_t width, uint32_t height, uint32_t layers);
 
+  operator VkFramebuffer();
 private:
   class impl;
   std::shared_ptr<impl> impl_;
@@ -1066,10 +2150,15 @@ private:
 class command_pool {
 public:
   command_pool(device device, uint32_t queue_family);
+  // Without resettable_buffers, buffers can only be reset with the whole
+  // pool, and must not be begun again until then.
+  command_pool(device device, uint32_t queue_family, bool resettable_buffers);
 
   operator VkCommandPool();
 
-  command_buffer allocate();
+  command_buffer allocate(command_buffer_level level = command_buffer_level::primary);
+  std::vector<command_buffer> allocate(uint32_t count,
+                                       command_buffer_level level = command_buffer_level::primary);
 
   void reset(bool release_resources);
 private:
@@ -1077,6 +2166,257 @@ private:
   std::shared_ptr<impl> impl_;
 };
 
+// Hands out command buffers from one command pool per recording
+// thread per frame slot, growing each pool in batches. A thread only ever
+// touches its own pools, so allocation takes no locks. Once the fence
+// guarding a frame slot has signaled, begin_frame() resets that slot's pools
+// in one go rather than freeing buffers individually. begin_frame() must not
+// run concurrently with allocate().
+class command_recycler {
+public:
+  command_recycler(device device, uint32_t queue_family, uint32_t frame_count,
+                   uint32_t thread_count, uint32_t batch_size = 16,
+                   command_buffer_level level = command_buffer_level::primary);
+
+  void begin_frame(uint32_t frame);
+  command_buffer allocate(uint32_t thread);
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
+// A fixed set of worker threads with a deque each. Workers take jobs from the
+// front of their own deque and steal from the back of others' when they run
+// dry, so uneven jobs still keep every core busy.
+class thread_pool {
+public:
+  explicit thread_pool(uint32_t thread_count);
+
+  uint32_t size() const;
+
+  // Runs job(index, worker) for every index in [0, count) and returns once
+  // they have all finished. worker identifies the thread, in [0, size()).
+  // Jobs must not call parallel_for on their own pool, as the waiting worker
+  // could be the one holding the jobs it waits for.
+  void parallel_for(uint32_t count,
+                    const std::function<void(uint32_t, uint32_t)> &job);
+  // Queues the same jobs without waiting. on_complete runs on the worker
+  // that finishes the last index. The pool drains queued jobs before it
+  // shuts down.
+  void async_for(uint32_t count, std::function<void(uint32_t, uint32_t)> job,
+                 std::function<void()> on_complete);
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
+// Splits recording of a subpass across a thread pool. Each batch is recorded
+// into a secondary command buffer inheriting the render pass, subpass and
+// framebuffer, then the primary executes them in batch order. Secondary
+// buffers come from a per-worker command_recycler, so begin_frame() must be
+// called once the fence for the frame slot has signaled.
+class parallel_recorder {
+public:
+  parallel_recorder(device device, uint32_t queue_family, thread_pool pool,
+                    uint32_t frame_count);
+
+  void begin_frame(uint32_t frame);
+
+  // The primary must be inside the render pass, begun with
+  // subpass_contents::secondary_command_buffers.
+  void record(command_builder &primary, render_pass pass, uint32_t subpass,
+              framebuffer framebuffer, uint32_t batch_count,
+              const std::function<void(command_builder&, uint32_t)> &record_batch);
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
+// A frame's passes and the buffers and images they use. Passes are added in
+// submission order, each declaring what it reads and writes. compile() then:
+//
+// - culls passes none of whose writes are read later, unless they write an
+//   imported resource or one passed to keep();
+// - sorts the rest into levels of passes that don't depend on each other,
+//   with one barrier in front of each level;
+// - creates the transient images and packs those whose lifetimes don't
+//   overlap into the same memory.
+//
+// A compiled graph can be recorded every frame. Transient images wait for
+// the previous recording's last use of their memory. Imported images must be
+// in their declared layouts when its commands start executing, and other
+// work on imported resources has to be synchronised with the graph by the
+// caller.
+class render_graph {
+public:
+  using resource_id = uint32_t;
+  using pass_id = uint32_t;
+
+  explicit render_graph(device device);
+
+  resource_id import_buffer(buffer_ref buffer);
+  resource_id import_image(image_ref image, image_layout layout,
+                           image_aspect aspect, uint32_t mip_count = 1,
+                           uint32_t layer_count = 1);
+  // Owned by the graph and only valid between the passes that use it.
+  resource_id create_image(texel_format format, extent<3> extent,
+                           image_usage usage,
+                           image_aspect aspect = image_aspect::colour,
+                           uint32_t mip_count = 1, uint32_t layer_count = 1);
+
+  pass_id add_pass(const char *name,
+                   std::function<void(command_builder&)> record);
+  // Accesses cover every subresource. Layouts only apply to images.
+  void read(pass_id pass, resource_id resource, pipeline_stage stage,
+            access_mask access, image_layout layout = image_layout::undefined);
+  void write(pass_id pass, resource_id resource, pipeline_stage stage,
+             access_mask access, image_layout layout = image_layout::undefined);
+  void keep(resource_id resource);
+
+  void compile();
+
+  void record(command_builder &builder);
+  // Also times each pass as a zone named after it.
+  void record(command_builder &builder, gpu_profiler &profiler);
+  // Records each pass into its own primary buffer from the recycler, on the
+  // pool's workers. Submit the buffers in order, in one batch.
+  std::vector<command_buffer> record(thread_pool &pool,
+                                     command_recycler &recycler);
+
+  // For pass callbacks to find transient images, once compiled.
+  VkImage image(resource_id resource) const;
+  bool culled(pass_id pass) const;
+  uint32_t level_count() const;
+  // Bytes of memory backing the transient images, after aliasing.
+  size_t transient_memory_size() const;
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
+// Pushed at offset 0 by every dispatch a compute_launcher makes. A launch
+// larger than maxComputeWorkGroupCount is split into several dispatches, each
+// pushing the workgroup it starts at, so a shader finds its invocation with
+// (gl_WorkGroupID + base) * gl_WorkGroupSize + gl_LocalInvocationID and skips
+// those outside size. In GLSL:
+//
+//   layout(push_constant) uniform launch { uint base[3]; uint size[3]; };
+struct launch_params {
+  uint32_t base[3];
+  uint32_t size[3];
+};
+
+// A compute shader with a pipeline layout pushing launch_params. The
+// workgroup size is either the shader's own local size, or one picked from
+// the device limits and passed in specialization constants 0 to 2, for
+// shaders declaring local_size_x_id = 0, local_size_y_id = 1 and
+// local_size_z_id = 2.
+class compute_kernel {
+public:
+  compute_kernel(device device, descriptor_set_layout *layouts,
+                 size_t layout_count, shader_module module,
+                 const char *entry_point, extent<3> local_size,
+                 pipeline_cache_ref cache = VK_NULL_HANDLE);
+  // Picks the size with local_size_for(). Constants 0 to 2 of the given ones
+  // are overwritten.
+  compute_kernel(device device, descriptor_set_layout *layouts,
+                 size_t layout_count, shader_module module,
+                 const char *entry_point, uint32_t dimensions,
+                 specialization constants = specialization{},
+                 pipeline_cache_ref cache = VK_NULL_HANDLE);
+
+  // A workgroup size for problems of 1 to 3 dimensions, grown evenly across
+  // them up to 256 invocations or the device's limits.
+  static extent<3> local_size_for(const physical_device &device,
+                                  uint32_t dimensions);
+
+  extent<3> local_size() const;
+  // Workgroups covering a problem of the given size.
+  extent<3> group_count(extent<3> size) const;
+  pipeline_layout_ref layout() const;
+  pipeline_ref pipeline() const;
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
+// Batches many small compute launches into one command buffer. Each launch
+// covers a problem size in invocations and declares the buffers it reads and
+// writes. record() sorts the launches into levels that don't depend on each
+// other, as render_graph does with passes, keeps launches of the same kernel
+// together within a level, and puts a global memory barrier in front of a
+// level only where a hazard needs one. Pipelines and descriptor sets are only
+// rebound when they change.
+//
+// Hazards are tracked across records in submission order, so buffers written
+// by one record() are made visible to the launches of the next.
+//
+// Not thread safe.
+class compute_launcher {
+public:
+  explicit compute_launcher(device device);
+
+  // Starts a launch. The calls that follow add to it.
+  compute_launcher& launch(compute_kernel kernel, extent<3> size);
+  // Binds the next set number, from 0.
+  compute_launcher& bind(descriptor_set_ref set);
+  compute_launcher& reads(buffer_ref buffer);
+  compute_launcher& writes(buffer_ref buffer);
+
+  // Records the launches so far and clears them.
+  void record(command_builder &builder);
+
+  // What the last record() made.
+  uint32_t dispatch_count() const;
+  uint32_t barrier_count() const;
+  // Pipeline and descriptor set binds, after skipping redundant ones.
+  uint32_t bind_count() const;
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
+struct compute_pipeline_info {
+  pipeline_layout layout;
+  shader_module module;
+  const char *entry_point;
+  specialization constants;
+};
+
+// The stages and states pointed to must stay alive until the pipeline has
+// compiled.
+struct graphics_pipeline_info {
+  const pipeline_shader *stages;
+  uint32_t stage_count;
+  const vertex_input_state *vertex_state;
+  const input_assembly_state *assembly_state;
+  const vk::viewport_state *viewport_state;
+  const rasterization_state *raster_state;
+  pipeline_layout layout;
+  vk::render_pass render_pass;
+};
+
+// Compiles batches of pipelines on a thread pool and hands back futures, so
+// loading can overlap compilation with other work. Each worker compiles into
+// a cache of its own, and those caches are merged into the target cache as
+// each batch completes, so the target mustn't be merged into or saved by
+// anyone else until wait_idle() returns.
+class pipeline_compiler {
+public:
+  pipeline_compiler(device device, thread_pool pool, pipeline_cache target);
+
+  std::vector<std::future<compute_pipeline>>
+  compile(const compute_pipeline_info *infos, size_t count);
+  std::vector<std::future<graphics_pipeline>>
+  compile(const graphics_pipeline_info *infos, size_t count);
+
+  // Waits for every batch to compile and merge.
+  void wait_idle();
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
 class surface {
 public:
 #ifdef VK_USE_PLATFORM_XLIB_KHR
@@ -1116,6 +2456,7 @@ public:
   operator VkSwapchainKHR();
 
   swapchain_image acquire_next_image();
+  swapchain_image acquire_next_image(semaphore signal);
   swapchain_image & get_image(uint32_t index);
   const swapchain_image & get_image(uint32_t index) const;
   uint32_t size() const;
@@ -1128,7 +2469,11 @@ class swapchain_image : public image {
 private:
   swapchain_image(vk::device device, swapchain chain, VkImage handle,
                   uint32_t index); 
-  
+
+public:
+  uint32_t index() const { return index_; }
+
+private:
   swapchain swapchain_;
   uint32_t index_;
 
@@ -1136,6 +2481,32 @@ private:
   friend class swapchain;
 };
 
+// Owns a fixed number of per-frame slots so the CPU can record frame N+1
+// while the GPU is still working on frame N. Each slot has its own acquire
+// semaphore, fence and command buffer, and each swapchain image its own
+// render semaphore for the present to wait on. begin_frame() only blocks
+// when the slot it is about to reuse is still in flight.
+class frame_pacer {
+public:
+  struct frame {
+    swapchain_image image;
+    command_buffer commands;
+  };
+
+  frame_pacer(device device, queue queue, uint32_t queue_family,
+              swapchain swapchain, uint32_t frames_in_flight = 2,
+              pipeline_stage wait_stage = pipeline_stage::colour_attachment_output);
+
+  frame begin_frame();
+  void end_frame();
+  void wait_idle();
+
+  uint32_t frames_in_flight() const;
+private:
+  class impl;
+  std::shared_ptr<impl> impl_;
+};
+
 class display {};
 class display_mode {};
 
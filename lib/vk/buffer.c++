@@ -1,5 +1,6 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
 
 using namespace vk;
 
@@ -10,21 +11,27 @@ public:
 
   device device_;
   VkBuffer handle_;
+  size_t size_;
   VkMemoryRequirements memory_requirements_;
+  std::unique_ptr<memory_allocation> allocation_;
 };
 
 buffer::impl::impl(device device)
-: device_{device}, handle_{VK_NULL_HANDLE}
+: device_{device}, handle_{VK_NULL_HANDLE}, size_{0}
 {
 }
 
 buffer::impl::~impl() {
   if (VK_NULL_HANDLE != handle_)
-    vkDestroyBuffer(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyBuffer(device_, handle_, nullptr);
 }
 
 buffer::buffer(device device, size_t size_in_bytes)
+: buffer(std::move(device), size_in_bytes, buffer_usage::storage) { }
+
+buffer::buffer(device device, size_t size_in_bytes, buffer_usage usage)
 : impl_{std::make_shared<impl>(std::move(device))} {
+  impl_->size_ = size_in_bytes;
 
   // Creation state for a buffer.
   VkBufferCreateInfo info;
@@ -32,15 +39,15 @@ buffer::buffer(device device, size_t size_in_bytes)
   info.pNext = nullptr;
   info.flags = 0;
   info.size = size_in_bytes;
-  info.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  info.usage = static_cast<VkBufferUsageFlags>(usage);
   info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
   info.queueFamilyIndexCount = 0;
   info.pQueueFamilyIndices = nullptr;
 
-  auto result = vkCreateBuffer(impl_->device_, &info, nullptr, &impl_->handle_);
+  auto result = impl_->device_.dispatch().vkCreateBuffer(impl_->device_, &info, nullptr, &impl_->handle_);
   assert(VK_SUCCESS == result && "Buffer creation failed.");
 
-  vkGetBufferMemoryRequirements(impl_->device_, impl_->handle_,
+  impl_->device_.dispatch().vkGetBufferMemoryRequirements(impl_->device_, impl_->handle_,
                                 &impl_->memory_requirements_);
 }
 
@@ -48,8 +55,34 @@ buffer::operator VkBuffer() {
   return impl_->handle_;
 }
 
+size_t buffer::size() const {
+  return impl_->size_;
+}
+
 void buffer::bind(device_memory memory, size_t offset, size_t /*size*/) {
-  auto result = vkBindBufferMemory(impl_->device_, impl_->handle_, memory, offset);
+  auto result = impl_->device_.dispatch().vkBindBufferMemory(impl_->device_, impl_->handle_, memory, offset);
   assert(VK_SUCCESS == result && "Failed to bind buffer memory.");
 }
 
+void buffer::bind(memory_allocation allocation) {
+  assert(allocation.size() >= impl_->memory_requirements_.size &&
+         "Allocation is too small for buffer.");
+  assert(0 == allocation.offset() % impl_->memory_requirements_.alignment &&
+         "Allocation does not satisfy buffer alignment.");
+  bind(allocation.memory(), allocation.offset(), allocation.size());
+
+  // Hold on to the allocation so the range is released with the buffer.
+  impl_->allocation_ = std::make_unique<memory_allocation>(std::move(allocation));
+}
+
+size_t buffer::minimum_allocation_size() const {
+  return impl_->memory_requirements_.size;
+}
+
+size_t buffer::minimum_allocation_alignment() const {
+  return impl_->memory_requirements_.alignment;
+}
+
+uint32_t buffer::memory_type_bits() const {
+  return impl_->memory_requirements_.memoryTypeBits;
+}
@@ -1,5 +1,6 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
 
 using namespace vk;
 
@@ -17,7 +18,7 @@ buffer_view::impl::impl(device device)
 
 buffer_view::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroyBufferView(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyBufferView(device_, handle_, nullptr);
   }
 }
 
@@ -34,8 +35,12 @@ buffer_view::buffer_view(device device, buffer buffer, texel_format format,
   info.offset = offset;
   info.range = range;
 
-  auto result = vkCreateBufferView(impl_->device_, &info, nullptr, 
+  auto result = impl_->device_.dispatch().vkCreateBufferView(impl_->device_, &info, nullptr, 
                                    &impl_->handle_);
   assert(VK_SUCCESS == result && "Failed to create buffer view.");
 }
 
+
+buffer_view::operator VkBufferView() {
+  return impl_->handle_;
+}
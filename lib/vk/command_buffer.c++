@@ -1,5 +1,7 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
+#include "utility.h"
 
 using namespace vk;
 
@@ -11,14 +13,16 @@ public:
   device device_;
   command_pool pool_;
   VkCommandBuffer handle_;
+  const device_dispatch *dispatch_;
 };
 
 command_buffer::impl::impl(device device, command_pool pool, VkCommandBuffer handle)
-: device_{device}, pool_{pool}, handle_{handle} { }
+: device_{device}, pool_{pool}, handle_{handle},
+  dispatch_{&device_.dispatch()} { }
 
 command_buffer::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkFreeCommandBuffers(device_, pool_, 1, &handle_);
+    dispatch_->vkFreeCommandBuffers(device_, pool_, 1, &handle_);
   }
 }
 
@@ -26,46 +30,102 @@ command_buffer::command_buffer(device device, command_pool pool, VkCommandBuffer
 : impl_{std::make_shared<impl>(device, pool, handle)} {}
 
 void command_buffer::begin() {
+  // Secondary buffers have to say they inherit no render pass. Primaries
+  // ignore it.
+  VkCommandBufferInheritanceInfo inheritance;
+  inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritance.pNext = nullptr;
+  inheritance.renderPass = VK_NULL_HANDLE;
+  inheritance.subpass = 0;
+  inheritance.framebuffer = VK_NULL_HANDLE;
+  inheritance.occlusionQueryEnable = VK_FALSE;
+  inheritance.queryFlags = 0;
+  inheritance.pipelineStatistics = 0;
+
   VkCommandBufferBeginInfo info;
   info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   info.pNext = nullptr;
   info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-  info.pInheritanceInfo = nullptr;
-  auto result = vkBeginCommandBuffer(impl_->handle_, &info);
+  info.pInheritanceInfo = &inheritance;
+  auto result = impl_->dispatch_->vkBeginCommandBuffer(impl_->handle_, &info);
   assert(VK_SUCCESS == result && "Error starting command buffer.");
 }
 
+void command_buffer::begin(render_pass_ref pass, uint32_t subpass,
+                           framebuffer_ref framebuffer) {
+  VkCommandBufferInheritanceInfo inheritance;
+  inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritance.pNext = nullptr;
+  inheritance.renderPass = pass;
+  inheritance.subpass = subpass;
+  inheritance.framebuffer = framebuffer;
+  inheritance.occlusionQueryEnable = VK_FALSE;
+  inheritance.queryFlags = 0;
+  inheritance.pipelineStatistics = 0;
+
+  VkCommandBufferBeginInfo info;
+  info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  info.pNext = nullptr;
+  info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+               VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  info.pInheritanceInfo = &inheritance;
+  auto result = impl_->dispatch_->vkBeginCommandBuffer(impl_->handle_, &info);
+  assert(VK_SUCCESS == result && "Error starting secondary command buffer.");
+}
+
+const device_dispatch& command_buffer::dispatch_table() const {
+  return *impl_->dispatch_;
+}
+
 command_buffer::operator VkCommandBuffer() {
   return impl_->handle_;
 }
 
-void command_buffer::bind_descriptor_sets(pipeline_layout layout, 
+void command_buffer::bind_descriptor_sets(pipeline_layout_ref layout, 
                                           descriptor_set* descriptors, size_t descriptor_count) {
-  std::vector<VkDescriptorSet> sets(descriptor_count);
+  bind_descriptor_sets(layout, descriptors, descriptor_count, nullptr, 0);
+}
+
+void command_buffer::bind_descriptor_sets(pipeline_layout_ref layout,
+                                          descriptor_set* descriptors, size_t descriptor_count,
+                                          const uint32_t *dynamic_offsets,
+                                          size_t offset_count) {
+  scratch_buffer<VkDescriptorSet> sets(descriptor_count);
   for (auto i = 0ul; i < descriptor_count; ++i)
     sets[i] = descriptors[i];
 
-  vkCmdBindDescriptorSets(impl_->handle_, VK_PIPELINE_BIND_POINT_COMPUTE,
-                          layout, 0, sets.size(), sets.data(), 0, nullptr);
+  impl_->dispatch_->vkCmdBindDescriptorSets(impl_->handle_, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          layout, 0, sets.size(), sets.data(),
+                          offset_count, dynamic_offsets);
 }
 
-void command_buffer::bind_pipeline(pipeline pipeline) {
-  vkCmdBindPipeline(impl_->handle_, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+void command_buffer::bind_pipeline(pipeline_ref pipeline) {
+  impl_->dispatch_->vkCmdBindPipeline(impl_->handle_, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
 }
 
 void command_buffer::end() {
-  auto result = vkEndCommandBuffer(impl_->handle_);
+  auto result = impl_->dispatch_->vkEndCommandBuffer(impl_->handle_);
   assert(VK_SUCCESS == result && "Error completing command buffer.");
 }
 
 void command_buffer::reset(bool release_all) {
   VkCommandBufferResetFlags flags =
     release_all ? VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT : 0;
-  auto result = vkResetCommandBuffer(impl_->handle_, flags);
+  auto result = impl_->dispatch_->vkResetCommandBuffer(impl_->handle_, flags);
   assert(VK_SUCCESS == result && "Failed to reset command buffer.");
 }
 
 void command_buffer::dispatch(uint32_t x, uint32_t y, uint32_t z) {
-  vkCmdDispatch(impl_->handle_, x, y, z);
+  impl_->dispatch_->vkCmdDispatch(impl_->handle_, x, y, z);
+}
+
+void command_buffer::push_constants(pipeline_layout_ref layout,
+                                    shader_stage_mask stages, uint32_t offset,
+                                    const void *data, uint32_t size) {
+  assert(0 == offset % 4 && 0 == size % 4 &&
+         "Push constants must be 4 byte aligned.");
+  impl_->dispatch_->vkCmdPushConstants(impl_->handle_, layout,
+                                       static_cast<VkShaderStageFlags>(stages),
+                                       offset, size, data);
 }
 
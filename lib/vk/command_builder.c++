@@ -1,12 +1,158 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
+#include "utility.h"
 
 using namespace vk;
 
+namespace {
+
+VkBufferMemoryBarrier ownership_barrier(buffer_ref buffer, uint32_t src_family,
+                                        uint32_t dst_family) {
+  VkBufferMemoryBarrier barrier;
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.pNext = nullptr;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = 0;
+  barrier.srcQueueFamilyIndex = src_family;
+  barrier.dstQueueFamilyIndex = dst_family;
+  barrier.buffer = buffer;
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+  return barrier;
+}
+
+VkImageMemoryBarrier ownership_barrier(image_ref image, const subresource_range &range,
+                                       image_layout old_layout,
+                                       image_layout new_layout,
+                                       uint32_t src_family, uint32_t dst_family) {
+  VkImageMemoryBarrier barrier;
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.pNext = nullptr;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = 0;
+  barrier.oldLayout = static_cast<VkImageLayout>(old_layout);
+  barrier.newLayout = static_cast<VkImageLayout>(new_layout);
+  barrier.srcQueueFamilyIndex = src_family;
+  barrier.dstQueueFamilyIndex = dst_family;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask =
+    static_cast<VkImageAspectFlags>(range.aspect_mask);
+  barrier.subresourceRange.baseMipLevel = range.base_mip_level;
+  barrier.subresourceRange.levelCount = range.mip_count;
+  barrier.subresourceRange.baseArrayLayer = range.base_array_layer;
+  barrier.subresourceRange.layerCount = range.layer_count;
+  return barrier;
+}
+
+VkImageSubresourceLayers subresource_layers(const subresource &subresource) {
+  VkImageSubresourceLayers layers;
+  layers.aspectMask = static_cast<VkImageAspectFlags>(subresource.aspect_mask);
+  layers.mipLevel = subresource.mip_level;
+  layers.baseArrayLayer = subresource.base_array_layer;
+  layers.layerCount = subresource.layer_count;
+  return layers;
+}
+
+VkOffset3D offset_3d(const offset<3> &offset) {
+  return VkOffset3D{offset.x, offset.y, offset.z};
+}
+
+VkBufferImageCopy buffer_image_region(const buffer_image_copy &region) {
+  VkBufferImageCopy copy;
+  copy.bufferOffset = region.buffer_offset;
+  copy.bufferRowLength = region.buffer_row_length;
+  copy.bufferImageHeight = region.buffer_image_height;
+  copy.imageSubresource = subresource_layers(region.subresource);
+  copy.imageOffset = offset_3d(region.image_offset);
+  copy.imageExtent = VkExtent3D{region.image_extent.width, region.image_extent.height,
+                                region.image_extent.depth};
+  return copy;
+}
+
+}
+
 command_builder::command_builder(command_buffer &buffer)
-: buffer_{buffer} { }
+: handle_{buffer}, dispatch_{&buffer.dispatch_table()} { }
+
+// On the releasing queue only the source half of the barrier matters, and on
+// the acquiring queue only the destination half, so the other scope is left
+// empty.
+void command_builder::acquire_ownership(buffer_ref buffer, uint32_t src_family,
+                                        uint32_t dst_family,
+                                        pipeline_stage dst_stage) {
+  auto barrier = ownership_barrier(buffer, src_family, dst_family);
+  barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+  dispatch_->vkCmdPipelineBarrier(handle_, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       static_cast<VkPipelineStageFlags>(dst_stage), 0,
+                       0, nullptr, 1, &barrier, 0, nullptr);
+}
 
-void command_builder::bind_index_buffer(buffer buffer, size_t offset, index_type type) {
+void command_builder::acquire_ownership(image_ref image, const subresource_range &range,
+                                        image_layout old_layout,
+                                        image_layout new_layout,
+                                        uint32_t src_family, uint32_t dst_family,
+                                        pipeline_stage dst_stage) {
+  auto barrier = ownership_barrier(image, range, old_layout, new_layout,
+                                   src_family, dst_family);
+  barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+  dispatch_->vkCmdPipelineBarrier(handle_, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       static_cast<VkPipelineStageFlags>(dst_stage), 0,
+                       0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void command_builder::begin_render_pass(render_pass_ref pass, framebuffer_ref framebuffer,
+                                        const rect<2> &area,
+                                        const clear_colour_value *clear_values,
+                                        uint32_t clear_value_count,
+                                        subpass_contents contents) {
+  scratch_buffer<VkClearValue> values(clear_value_count);
+  for (auto i = 0u; i < clear_value_count; ++i) {
+    for (auto j = 0u; j < 4; ++j)
+      values[i].color.uint32[j] = clear_values[i].uint32[j];
+  }
+
+  VkRenderPassBeginInfo info;
+  info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  info.pNext = nullptr;
+  info.renderPass = pass;
+  info.framebuffer = framebuffer;
+  info.renderArea.offset.x = area.offset.x;
+  info.renderArea.offset.y = area.offset.y;
+  info.renderArea.extent.width = area.extent.width;
+  info.renderArea.extent.height = area.extent.height;
+  info.clearValueCount = clear_value_count;
+  info.pClearValues = values.data();
+
+  dispatch_->vkCmdBeginRenderPass(handle_, &info, static_cast<VkSubpassContents>(contents));
+}
+
+void command_builder::begin_query(query_pool_ref pool, uint32_t index, bool precise) {
+  dispatch_->vkCmdBeginQuery(handle_, pool, index,
+                             precise ? VK_QUERY_CONTROL_PRECISE_BIT : 0);
+}
+
+void command_builder::bind_descriptor_sets(pipeline_layout_ref layout,
+                                           const descriptor_set_ref *sets,
+                                           uint32_t count) {
+  bind_descriptor_sets(layout, sets, count, nullptr, 0);
+}
+
+void command_builder::bind_descriptor_sets(pipeline_layout_ref layout,
+                                           const descriptor_set_ref *sets,
+                                           uint32_t count,
+                                           const uint32_t *dynamic_offsets,
+                                           uint32_t offset_count) {
+  scratch_buffer<VkDescriptorSet> handles(count);
+  for (auto i = 0u; i < count; ++i)
+    handles[i] = sets[i];
+
+  dispatch_->vkCmdBindDescriptorSets(handle_, VK_PIPELINE_BIND_POINT_COMPUTE, layout,
+                                     0, count, handles.data(), offset_count,
+                                     dynamic_offsets);
+}
+
+void command_builder::bind_index_buffer(buffer_ref buffer, size_t offset, index_type type) {
   VkIndexType vk_index_type;
   switch (type) {
   case index_type::uint16:
@@ -21,17 +167,63 @@ void command_builder::bind_index_buffer(buffer buffer, size_t offset, index_type
     assert(false && "Invalid index type.");
   }
 
-  vkCmdBindIndexBuffer(buffer_, buffer, offset, vk_index_type);
+  dispatch_->vkCmdBindIndexBuffer(handle_, buffer, offset, vk_index_type);
+}
+
+void command_builder::bind_pipeline(pipeline_ref pipeline) {
+  dispatch_->vkCmdBindPipeline(handle_, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+}
+
+void command_builder::blit_image(image_ref src, image_layout src_layout,
+                                 image_ref dst, image_layout dst_layout,
+                                 const image_blit *regions, uint32_t region_count,
+                                 vk::filter filter) {
+  scratch_buffer<VkImageBlit> blits(region_count);
+  for (auto i = 0u; i < region_count; ++i) {
+    auto &region = regions[i];
+    blits[i].srcSubresource = subresource_layers(region.src_subresource);
+    blits[i].dstSubresource = subresource_layers(region.dst_subresource);
+    for (auto corner = 0u; corner < 2; ++corner) {
+      blits[i].srcOffsets[corner] = offset_3d(region.src_offsets[corner]);
+      blits[i].dstOffsets[corner] = offset_3d(region.dst_offsets[corner]);
+    }
+  }
+
+  dispatch_->vkCmdBlitImage(handle_, src, static_cast<VkImageLayout>(src_layout),
+                            dst, static_cast<VkImageLayout>(dst_layout),
+                            region_count, blits.data(), static_cast<VkFilter>(filter));
+}
+
+void command_builder::clear_colour_attachment(uint32_t attachment,
+                                              const clear_colour_value &colour,
+                                              const rect<2> &area) {
+  VkClearAttachment clear;
+  clear.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  clear.colorAttachment = attachment;
+  for (auto i = 0u; i < 4; ++i)
+    clear.clearValue.color.uint32[i] = colour.uint32[i];
+
+  VkClearRect rect;
+  rect.rect.offset.x = area.offset.x;
+  rect.rect.offset.y = area.offset.y;
+  rect.rect.extent.width = area.extent.width;
+  rect.rect.extent.height = area.extent.height;
+  rect.baseArrayLayer = 0;
+  rect.layerCount = 1;
+
+  dispatch_->vkCmdClearAttachments(handle_, 1, &clear, 1, &rect);
 }
 
-void command_builder::clear_colour_image(image image, 
+void command_builder::clear_colour_image(image_ref image, 
                                          image_layout layout, 
                                          const clear_colour_value &colour,
                                          const subresource_range *ranges,
                                          uint32_t range_count) {
   VkClearColorValue value;
+  for (auto i = 0u; i < 4; ++i)
+    value.uint32[i] = colour.uint32[i];
 
-  std::vector<VkImageSubresourceRange> subresource_ranges(range_count);
+  scratch_buffer<VkImageSubresourceRange> subresource_ranges(range_count);
   for (auto i = 0u; i < range_count; ++i) {
     subresource_ranges[i].aspectMask = 
                         static_cast<VkImageAspectFlags>(ranges[i].aspect_mask);
@@ -40,138 +232,275 @@ void command_builder::clear_colour_image(image image,
     subresource_ranges[i].baseArrayLayer = ranges[i].base_array_layer;
     subresource_ranges[i].layerCount = ranges[i].layer_count;    
   }
-  vkCmdClearColorImage(buffer_, image, static_cast<VkImageLayout>(layout),
+  dispatch_->vkCmdClearColorImage(handle_, image, static_cast<VkImageLayout>(layout),
                        &value, 
                        range_count, subresource_ranges.data());  
 }
 
+void command_builder::copy_buffer(buffer_ref src, buffer_ref dst,
+                                  const buffer_copy *regions,
+                                  uint32_t region_count) {
+  scratch_buffer<VkBufferCopy> copies(region_count);
+  for (auto i = 0u; i < region_count; ++i) {
+    copies[i].srcOffset = regions[i].src_offset;
+    copies[i].dstOffset = regions[i].dst_offset;
+    copies[i].size = regions[i].size;
+  }
+
+  dispatch_->vkCmdCopyBuffer(handle_, src, dst, region_count, copies.data());
+}
+
+void command_builder::copy_buffer_to_image(buffer_ref src, image_ref dst,
+                                           image_layout dst_layout,
+                                           const buffer_image_copy *regions,
+                                           uint32_t region_count) {
+  scratch_buffer<VkBufferImageCopy> copies(region_count);
+  for (auto i = 0u; i < region_count; ++i)
+    copies[i] = buffer_image_region(regions[i]);
+
+  dispatch_->vkCmdCopyBufferToImage(handle_, src, dst,
+                                    static_cast<VkImageLayout>(dst_layout),
+                                    region_count, copies.data());
+}
+
+void command_builder::copy_image_to_buffer(image_ref src, image_layout src_layout,
+                                           buffer_ref dst,
+                                           const buffer_image_copy *regions,
+                                           uint32_t region_count) {
+  scratch_buffer<VkBufferImageCopy> copies(region_count);
+  for (auto i = 0u; i < region_count; ++i)
+    copies[i] = buffer_image_region(regions[i]);
+
+  dispatch_->vkCmdCopyImageToBuffer(handle_, src,
+                                    static_cast<VkImageLayout>(src_layout),
+                                    dst, region_count, copies.data());
+}
+
 void command_builder::dispatch(uint32_t x, uint32_t y, uint32_t z) {
-  vkCmdDispatch(buffer_, x, y, z);
+  dispatch_->vkCmdDispatch(handle_, x, y, z);
 }
 
-void command_builder::dispatch_indirect(buffer buffer, size_t offset) {
-  vkCmdDispatchIndirect(buffer_, buffer, offset);
+void command_builder::dispatch_indirect(buffer_ref buffer, size_t offset) {
+  dispatch_->vkCmdDispatchIndirect(handle_, buffer, offset);
 }
 
 void command_builder::draw(uint32_t vertex_count, uint32_t instance_count,
                            uint32_t first_vertex, uint32_t first_instance) {
-  vkCmdDraw(buffer_, vertex_count, instance_count, first_vertex, first_instance);
+  dispatch_->vkCmdDraw(handle_, vertex_count, instance_count, first_vertex, first_instance);
 }
 
 void command_builder::draw_indexed(uint32_t index_count, uint32_t instance_count,
                                    uint32_t first_index, int32_t vertex_offset,
                                    uint32_t first_instance) {
-  vkCmdDrawIndexed(buffer_, index_count, instance_count,first_index, vertex_offset, first_instance);
+  dispatch_->vkCmdDrawIndexed(handle_, index_count, instance_count,first_index, vertex_offset, first_instance);
 }
 
-void command_builder::draw_indirect(buffer buffer, size_t offset,
+void command_builder::draw_indirect(buffer_ref buffer, size_t offset,
                                     uint32_t draw_count, uint32_t stride) {
-  vkCmdDrawIndirect(buffer_, buffer, offset, draw_count, stride);
+  dispatch_->vkCmdDrawIndirect(handle_, buffer, offset, draw_count, stride);
 }
 
-void command_builder::draw_indexed_indirect(buffer buffer, size_t offset,
+void command_builder::draw_indexed_indirect(buffer_ref buffer, size_t offset,
                                             uint32_t draw_count, uint32_t stride) {
-  vkCmdDrawIndexedIndirect(buffer_, buffer, offset, draw_count, stride);
+  dispatch_->vkCmdDrawIndexedIndirect(handle_, buffer, offset, draw_count, stride);
 }  
 
-void command_builder::end_query(query_pool pool, uint32_t index) {
-  vkCmdEndQuery(buffer_, pool, index);
+void command_builder::end_query(query_pool_ref pool, uint32_t index) {
+  dispatch_->vkCmdEndQuery(handle_, pool, index);
 }
 
 void command_builder::end_render_pass() {
-  vkCmdEndRenderPass(buffer_);
+  dispatch_->vkCmdEndRenderPass(handle_);
 }
 
 void command_builder::execute_commands(command_buffer* buffers, uint32_t buffer_count) {
-  std::vector<VkCommandBuffer> cmd_buffers(buffer_count);
+  scratch_buffer<VkCommandBuffer> cmd_buffers(buffer_count);
   for (auto i = 0u; i < buffer_count; ++i) {
     cmd_buffers[i] = buffers[i];
   }
-  vkCmdExecuteCommands(buffer_, cmd_buffers.size(), cmd_buffers.data());
+  dispatch_->vkCmdExecuteCommands(handle_, cmd_buffers.size(), cmd_buffers.data());
 }
 
-void command_builder::fill_buffer(buffer buffer, size_t offset, uint32_t value, ssize_t size) {
+void command_builder::fill_buffer(buffer_ref buffer, size_t offset, uint32_t value, ssize_t size) {
   if (size < 0)
     size = VK_WHOLE_SIZE;
 
-  vkCmdFillBuffer(buffer_, buffer, offset, size, value);
+  dispatch_->vkCmdFillBuffer(handle_, buffer, offset, size, value);
+}
+
+namespace {
+
+// Barrier wrappers translated in place, sharing scratch space between
+// pipeline_barrier and wait_events.
+class barrier_batch {
+public:
+  barrier_batch(const memory_barrier *barriers, uint32_t barrier_count,
+                const buffer_memory_barrier *buffer_barriers,
+                uint32_t buffer_barrier_count,
+                const image_memory_barrier *image_barriers,
+                uint32_t image_barrier_count);
+
+  scratch_buffer<VkMemoryBarrier> memory_;
+  scratch_buffer<VkBufferMemoryBarrier> buffer_;
+  scratch_buffer<VkImageMemoryBarrier> image_;
+};
+
+barrier_batch::barrier_batch(const memory_barrier *barriers, uint32_t barrier_count,
+                             const buffer_memory_barrier *buffer_barriers,
+                             uint32_t buffer_barrier_count,
+                             const image_memory_barrier *image_barriers,
+                             uint32_t image_barrier_count)
+: memory_(barrier_count), buffer_(buffer_barrier_count),
+  image_(image_barrier_count) {
+  for (auto i = 0u; i < barrier_count; ++i) {
+    memory_[i].sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_[i].pNext = nullptr;
+    memory_[i].srcAccessMask = static_cast<VkAccessFlags>(barriers[i].src_access);
+    memory_[i].dstAccessMask = static_cast<VkAccessFlags>(barriers[i].dst_access);
+  }
+
+  for (auto i = 0u; i < buffer_barrier_count; ++i) {
+    auto &barrier = buffer_barriers[i];
+    buffer_[i] = ownership_barrier(barrier.buffer, barrier.src_family,
+                                   barrier.dst_family);
+    buffer_[i].srcAccessMask = static_cast<VkAccessFlags>(barrier.src_access);
+    buffer_[i].dstAccessMask = static_cast<VkAccessFlags>(barrier.dst_access);
+    buffer_[i].offset = barrier.offset;
+    buffer_[i].size = barrier.size;
+  }
+
+  for (auto i = 0u; i < image_barrier_count; ++i) {
+    auto &barrier = image_barriers[i];
+    image_[i] = ownership_barrier(barrier.image, barrier.range,
+                                  barrier.old_layout, barrier.new_layout,
+                                  barrier.src_family, barrier.dst_family);
+    image_[i].srcAccessMask = static_cast<VkAccessFlags>(barrier.src_access);
+    image_[i].dstAccessMask = static_cast<VkAccessFlags>(barrier.dst_access);
+  }
+}
+
 }
 
-void command_builder::pipeline_barrier(const memory_barrier *barriers,
+void command_builder::pipeline_barrier(pipeline_stage src_stages,
+                                       pipeline_stage dst_stages,
+                                       const memory_barrier *barriers,
                                        uint32_t barrier_count,
                                        const buffer_memory_barrier *buffer_barriers,
                                        uint32_t buffer_barrier_count,
                                        const image_memory_barrier *image_barriers, 
-                                       uint32_t image_barrier_count,
-                                       image image, image_layout layout) {
-  VkPipelineStageFlags src_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  VkPipelineStageFlags dst_stage_flags = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-  VkDependencyFlags dependency_flags = 0;
-  std::vector<VkMemoryBarrier> barrier_buf;
-  std::vector<VkBufferMemoryBarrier> buffer_barrier_buf;
-  std::vector<VkImageMemoryBarrier> image_barrier_buf;
-
-  uint32_t dst_mask = 0;
-  if (image_layout::transfer_destination == layout){
-    dst_mask |= VK_ACCESS_TRANSFER_WRITE_BIT;
-  } else if (image_layout::present_source == layout){
-    dst_mask |= VK_ACCESS_MEMORY_READ_BIT;
-  }
+                                       uint32_t image_barrier_count) {
+  barrier_batch batch{barriers, barrier_count, buffer_barriers,
+                      buffer_barrier_count, image_barriers, image_barrier_count};
+  dispatch_->vkCmdPipelineBarrier(handle_, static_cast<VkPipelineStageFlags>(src_stages),
+                       static_cast<VkPipelineStageFlags>(dst_stages), 0,
+                       barrier_count, batch.memory_.data(),
+                       buffer_barrier_count, batch.buffer_.data(),
+                       image_barrier_count, batch.image_.data());
+}
 
-  VkImageMemoryBarrier barrier;
-  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER; 
-  barrier.pNext = nullptr;
-  barrier.srcAccessMask = 0;
-  barrier.dstAccessMask = dst_mask;
-  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  barrier.newLayout = static_cast<VkImageLayout>(layout);
-  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-  barrier.image = image;
-  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-  barrier.subresourceRange.baseMipLevel = 0;
-  barrier.subresourceRange.levelCount = 1;
-  barrier.subresourceRange.baseArrayLayer = 0;
-  barrier.subresourceRange.layerCount = 1;
+gpu_zone command_builder::profile(gpu_profiler &profiler, const char *name) {
+  return gpu_zone{profiler, *this, name};
+}
 
-  vkCmdPipelineBarrier(buffer_, src_stage_flags, dst_stage_flags, dependency_flags,
-                       barrier_count, barrier_buf.data(),
-                       buffer_barrier_count, buffer_barrier_buf.data(),
-                       /*image_barrier_count*/1, &barrier/*image_barrier_buf.data()*/);
+void command_builder::push_constants(pipeline_layout_ref layout,
+                                     shader_stage_mask stages, uint32_t offset,
+                                     const void *data, uint32_t size) {
+  assert(0 == offset % 4 && 0 == size % 4 &&
+         "Push constants must be 4 byte aligned.");
+  dispatch_->vkCmdPushConstants(handle_, layout,
+                                static_cast<VkShaderStageFlags>(stages),
+                                offset, size, data);
 }
 
-void command_builder::reset_event(event event, pipeline_stage stage_mask) {
-  vkCmdResetEvent(buffer_, event, 
+void command_builder::release_ownership(buffer_ref buffer, uint32_t src_family,
+                                        uint32_t dst_family,
+                                        pipeline_stage src_stage) {
+  auto barrier = ownership_barrier(buffer, src_family, dst_family);
+  barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+  dispatch_->vkCmdPipelineBarrier(handle_, static_cast<VkPipelineStageFlags>(src_stage),
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                       0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void command_builder::release_ownership(image_ref image, const subresource_range &range,
+                                        image_layout old_layout,
+                                        image_layout new_layout,
+                                        uint32_t src_family, uint32_t dst_family,
+                                        pipeline_stage src_stage) {
+  auto barrier = ownership_barrier(image, range, old_layout, new_layout,
+                                   src_family, dst_family);
+  barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+  dispatch_->vkCmdPipelineBarrier(handle_, static_cast<VkPipelineStageFlags>(src_stage),
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                       0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void command_builder::reset_event(event_ref event, pipeline_stage stage_mask) {
+  dispatch_->vkCmdResetEvent(handle_, event, 
                   static_cast<VkPipelineStageFlags>(stage_mask));
 }
 
-void command_builder::set_event(event event, pipeline_stage stage_mask) {
-  vkCmdSetEvent(buffer_, event, 
+void command_builder::reset_query_pool(query_pool_ref pool, uint32_t first,
+                                       uint32_t count) {
+  dispatch_->vkCmdResetQueryPool(handle_, pool, first, count);
+}
+
+void command_builder::set_event(event_ref event, pipeline_stage stage_mask) {
+  dispatch_->vkCmdSetEvent(handle_, event, 
                 static_cast<VkPipelineStageFlags>(stage_mask));
 }
 
 void command_builder::set_line_width(float width) {
-  vkCmdSetLineWidth(buffer_, width);
+  dispatch_->vkCmdSetLineWidth(handle_, width);
 }
 
 void command_builder::set_depth_bias(float constant_factor, float clamp, float slope_factor) {
-  vkCmdSetDepthBias(buffer_, constant_factor, clamp, slope_factor);
+  dispatch_->vkCmdSetDepthBias(handle_, constant_factor, clamp, slope_factor);
 }
 
 void command_builder::set_depth_bounds(float min, float max) {
-  vkCmdSetDepthBounds(buffer_, min, max);
+  dispatch_->vkCmdSetDepthBounds(handle_, min, max);
 }
 
 void command_builder::set_viewports(viewport *viewports, size_t viewport_count) {
-  vkCmdSetViewport(buffer_, 0, viewport_count, reinterpret_cast<VkViewport*>(viewports));
+  dispatch_->vkCmdSetViewport(handle_, 0, viewport_count, reinterpret_cast<VkViewport*>(viewports));
 }
 
-void command_builder::update_buffer(buffer dst, size_t offset, const void *src, size_t size) {
+void command_builder::update_buffer(buffer_ref dst, size_t offset, const void *src, size_t size) {
 #if VK_HEADER_VERSION < 19
-  vkCmdUpdateBuffer(buffer_, dst, offset, size, 
+  dispatch_->vkCmdUpdateBuffer(handle_, dst, offset, size, 
                     static_cast<const uint32_t*>(src));
 #else
-  vkCmdUpdateBuffer(buffer_, dst, offset, size, src);
+  dispatch_->vkCmdUpdateBuffer(handle_, dst, offset, size, src);
 #endif 
 }
 
+void command_builder::wait_events(const event_ref *events, uint32_t event_count,
+                                  pipeline_stage src_stages,
+                                  pipeline_stage dst_stages,
+                                  const memory_barrier *barriers,
+                                  uint32_t barrier_count,
+                                  const buffer_memory_barrier *buffer_barriers,
+                                  uint32_t buffer_barrier_count,
+                                  const image_memory_barrier *image_barriers,
+                                  uint32_t image_barrier_count) {
+  scratch_buffer<VkEvent> handles(event_count);
+  for (auto i = 0u; i < event_count; ++i)
+    handles[i] = events[i];
+
+  barrier_batch batch{barriers, barrier_count, buffer_barriers,
+                      buffer_barrier_count, image_barriers, image_barrier_count};
+  dispatch_->vkCmdWaitEvents(handle_, event_count, handles.data(),
+                  static_cast<VkPipelineStageFlags>(src_stages),
+                  static_cast<VkPipelineStageFlags>(dst_stages),
+                  barrier_count, batch.memory_.data(),
+                  buffer_barrier_count, batch.buffer_.data(),
+                  image_barrier_count, batch.image_.data());
+}
+
+void command_builder::write_timestamp(pipeline_stage stage, query_pool_ref pool,
+                                      uint32_t index) {
+  dispatch_->vkCmdWriteTimestamp(handle_,
+                                 static_cast<VkPipelineStageFlagBits>(stage),
+                                 pool, index);
+}
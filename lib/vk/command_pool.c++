@@ -1,5 +1,6 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
 
 using namespace vk;
 
@@ -17,21 +18,26 @@ command_pool::impl::impl(device device)
 
 command_pool::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroyCommandPool(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyCommandPool(device_, handle_, nullptr);
   }
 }
 
 command_pool::command_pool(device device, uint32_t queue_family)
+: command_pool(device, queue_family, true) { }
+
+command_pool::command_pool(device device, uint32_t queue_family,
+                           bool resettable_buffers)
 : impl_{std::make_shared<impl>(device)}
 {
   VkCommandPoolCreateInfo info;
   info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
   info.pNext = nullptr;
-  info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | 
-               VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  if (resettable_buffers)
+    info.flags |= VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
   info.queueFamilyIndex = queue_family;
 
-  auto result = vkCreateCommandPool(impl_->device_, &info, nullptr,
+  auto result = impl_->device_.dispatch().vkCreateCommandPool(impl_->device_, &info, nullptr,
                                     &impl_->handle_);
   assert(VK_SUCCESS == result &&
          "Failed to create command pool.");
@@ -41,29 +47,49 @@ command_pool::operator VkCommandPool() {
   return impl_->handle_;
 }
 
-command_buffer command_pool::allocate() {
+command_buffer command_pool::allocate(command_buffer_level level) {
 
   VkCommandBufferAllocateInfo info;
   info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
   info.pNext = nullptr;
   info.commandPool = *this;
-  info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  info.level = static_cast<VkCommandBufferLevel>(level);
   info.commandBufferCount = 1;
 
   VkCommandBuffer handle = VK_NULL_HANDLE;
-  auto result = vkAllocateCommandBuffers(impl_->device_, &info, &handle);
+  auto result = impl_->device_.dispatch().vkAllocateCommandBuffers(impl_->device_, &info, &handle);
   assert(VK_SUCCESS == result && "Failed to allocate command buffer.");
 
   return command_buffer{impl_->device_, *this, handle};
 }
 
+std::vector<command_buffer> command_pool::allocate(uint32_t count,
+                                                   command_buffer_level level) {
+  VkCommandBufferAllocateInfo info;
+  info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  info.pNext = nullptr;
+  info.commandPool = *this;
+  info.level = static_cast<VkCommandBufferLevel>(level);
+  info.commandBufferCount = count;
+
+  std::vector<VkCommandBuffer> handles(count);
+  auto result = impl_->device_.dispatch().vkAllocateCommandBuffers(impl_->device_, &info, handles.data());
+  assert(VK_SUCCESS == result && "Failed to allocate command buffers.");
+
+  std::vector<command_buffer> buffers;
+  buffers.reserve(count);
+  for (auto handle: handles)
+    buffers.push_back(command_buffer{impl_->device_, *this, handle});
+  return buffers;
+}
+
 void command_pool::reset(bool release_resources) {
   VkCommandPoolResetFlags flags = 0;
   if (release_resources) {
     flags |= VK_COMMAND_POOL_RESET_RELEASE_RESOURCES_BIT;
   }
 
-  auto result = vkResetCommandPool(impl_->device_, impl_->handle_, flags);
+  auto result = impl_->device_.dispatch().vkResetCommandPool(impl_->device_, impl_->handle_, flags);
   assert(VK_SUCCESS == result && "Failed to reset command pool.");
 }
 
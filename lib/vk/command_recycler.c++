@@ -0,0 +1,84 @@
+#include <vk/vk.h>
+#include <cassert>
+
+using namespace vk;
+
+class command_recycler::impl {
+public:
+  struct thread_pool {
+    thread_pool(vk::device device, uint32_t queue_family);
+
+    command_pool pool_;
+    std::vector<command_buffer> buffers_;
+    size_t used_;
+  };
+
+  impl(device device, uint32_t queue_family, uint32_t frame_count,
+       uint32_t thread_count, uint32_t batch_size, command_buffer_level level);
+
+  device device_;
+  uint32_t thread_count_;
+  uint32_t batch_size_;
+  command_buffer_level level_;
+  uint32_t current_frame_;
+
+  // Indexed by frame * thread_count + thread. Each pool is a separate
+  // allocation so threads bumping their own counters don't share cache lines.
+  std::vector<std::unique_ptr<thread_pool>> pools_;
+};
+
+// Buffers are only ever reset with their whole pool, which lets drivers skip
+// tracking them one by one.
+command_recycler::impl::thread_pool::thread_pool(vk::device device,
+                                                 uint32_t queue_family)
+: pool_{device, queue_family, false}, used_{0} { }
+
+command_recycler::impl::impl(device device, uint32_t queue_family,
+                             uint32_t frame_count, uint32_t thread_count,
+                             uint32_t batch_size, command_buffer_level level)
+: device_{device}, thread_count_{thread_count}, batch_size_{batch_size},
+  level_{level}, current_frame_{0} {
+  assert(0 < frame_count && 0 < thread_count && 0 < batch_size &&
+         "Command recycler needs at least one frame, thread and buffer.");
+
+  pools_.reserve(frame_count * thread_count);
+  for (auto i = 0u; i < frame_count * thread_count; ++i)
+    pools_.push_back(std::make_unique<thread_pool>(device_, queue_family));
+}
+
+command_recycler::command_recycler(device device, uint32_t queue_family,
+                                   uint32_t frame_count, uint32_t thread_count,
+                                   uint32_t batch_size,
+                                   command_buffer_level level)
+: impl_{std::make_shared<impl>(device, queue_family, frame_count,
+                               thread_count, batch_size, level)} { }
+
+void command_recycler::begin_frame(uint32_t frame) {
+  auto first = frame * impl_->thread_count_;
+  assert(first < impl_->pools_.size() && "Frame slot out of range.");
+
+  // The caller has waited on this slot's fence, so every buffer allocated
+  // from these pools is done executing.
+  for (auto i = first; i < first + impl_->thread_count_; ++i) {
+    auto &pool = *impl_->pools_[i];
+    if (0 == pool.used_)
+      continue;
+
+    pool.pool_.reset(false);
+    pool.used_ = 0;
+  }
+
+  impl_->current_frame_ = frame;
+}
+
+command_buffer command_recycler::allocate(uint32_t thread) {
+  assert(thread < impl_->thread_count_ && "Thread index out of range.");
+  auto &pool = *impl_->pools_[impl_->current_frame_ * impl_->thread_count_ + thread];
+
+  if (pool.used_ == pool.buffers_.size()) {
+    auto batch = pool.pool_.allocate(impl_->batch_size_, impl_->level_);
+    pool.buffers_.insert(pool.buffers_.end(), batch.begin(), batch.end());
+  }
+
+  return pool.buffers_[pool.used_++];
+}
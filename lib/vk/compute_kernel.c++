@@ -0,0 +1,105 @@
+#include <vk/vk.h>
+#include <algorithm>
+#include <cassert>
+
+using namespace vk;
+
+namespace {
+
+// A multiple of every common subgroup size, and small enough that several
+// groups fit on a compute unit at once.
+const uint32_t preferred_invocations = 256;
+
+pipeline_layout make_layout(const device &device, descriptor_set_layout *layouts,
+                            size_t layout_count) {
+  push_constant_range range{shader_stage_mask::compute, 0, sizeof(launch_params)};
+  return pipeline_layout{device, layouts, layout_count, &range, 1};
+}
+
+}
+
+class compute_kernel::impl {
+public:
+  impl(device device, descriptor_set_layout *layouts, size_t layout_count,
+       shader_module module, const char *entry_point, extent<3> local_size,
+       const specialization &constants, pipeline_cache_ref cache);
+
+  extent<3> local_size_;
+  pipeline_layout layout_;
+  compute_pipeline pipeline_;
+};
+
+compute_kernel::impl::impl(device device, descriptor_set_layout *layouts,
+                           size_t layout_count, shader_module module,
+                           const char *entry_point, extent<3> local_size,
+                           const specialization &constants,
+                           pipeline_cache_ref cache)
+: local_size_{local_size},
+  layout_{make_layout(device, layouts, layout_count)},
+  pipeline_{device, layout_, std::move(module), entry_point, constants, cache} {
+  assert(0 != local_size.width && 0 != local_size.height && 0 != local_size.depth &&
+         "Workgroups need at least one invocation.");
+}
+
+compute_kernel::compute_kernel(device device, descriptor_set_layout *layouts,
+                               size_t layout_count, shader_module module,
+                               const char *entry_point, extent<3> local_size,
+                               pipeline_cache_ref cache)
+: impl_{std::make_shared<impl>(std::move(device), layouts, layout_count,
+                               std::move(module), entry_point, local_size,
+                               specialization{}, cache)} { }
+
+compute_kernel::compute_kernel(device device, descriptor_set_layout *layouts,
+                               size_t layout_count, shader_module module,
+                               const char *entry_point, uint32_t dimensions,
+                               specialization constants,
+                               pipeline_cache_ref cache) {
+  auto local_size = local_size_for(device.physical_device(), dimensions);
+  constants.set(0, local_size.width)
+           .set(1, local_size.height)
+           .set(2, local_size.depth);
+  impl_ = std::make_shared<impl>(std::move(device), layouts, layout_count,
+                                 std::move(module), entry_point, local_size,
+                                 constants, cache);
+}
+
+extent<3> compute_kernel::local_size_for(const physical_device &device,
+                                         uint32_t dimensions) {
+  assert(1 <= dimensions && dimensions <= 3 && "Problems have 1 to 3 dimensions.");
+  auto &limits = device.limits();
+  auto target = std::min(preferred_invocations, limits.maxComputeWorkGroupInvocations);
+
+  // Doubling each dimension in turn keeps 2D and 3D groups close to square,
+  // e.g. 16x16 and 8x8x4.
+  uint32_t size[3] = {1, 1, 1};
+  for (auto grown = true; grown;) {
+    grown = false;
+    for (auto i = 0u; i < dimensions; ++i) {
+      if (2 * size[0] * size[1] * size[2] <= target &&
+          2 * size[i] <= limits.maxComputeWorkGroupSize[i]) {
+        size[i] *= 2;
+        grown = true;
+      }
+    }
+  }
+  return extent<3>{size[0], size[1], size[2]};
+}
+
+extent<3> compute_kernel::local_size() const {
+  return impl_->local_size_;
+}
+
+extent<3> compute_kernel::group_count(extent<3> size) const {
+  auto &local = impl_->local_size_;
+  return extent<3>{(size.width + local.width - 1) / local.width,
+                   (size.height + local.height - 1) / local.height,
+                   (size.depth + local.depth - 1) / local.depth};
+}
+
+pipeline_layout_ref compute_kernel::layout() const {
+  return impl_->layout_;
+}
+
+pipeline_ref compute_kernel::pipeline() const {
+  return impl_->pipeline_;
+}
@@ -0,0 +1,234 @@
+#include <vk/vk.h>
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+
+using namespace vk;
+
+namespace {
+
+struct queued_launch {
+  compute_kernel kernel;
+  extent<3> size;
+  std::vector<descriptor_set_ref> sets;
+  std::vector<VkBuffer> reads;
+  std::vector<VkBuffer> writes;
+  uint32_t level;
+  // When the kernel was first launched, to keep its launches together.
+  uint32_t kernel_order;
+};
+
+bool contains(const std::vector<VkBuffer> &buffers, VkBuffer buffer) {
+  return buffers.end() != std::find(buffers.begin(), buffers.end(), buffer);
+}
+
+bool same_sets(const std::vector<descriptor_set_ref> &a,
+               const std::vector<descriptor_set_ref> &b) {
+  return a.size() == b.size() &&
+         std::equal(a.begin(), a.end(), b.begin(),
+                    [](descriptor_set_ref x, descriptor_set_ref y) {
+                      return static_cast<VkDescriptorSet>(x) ==
+                             static_cast<VkDescriptorSet>(y);
+                    });
+}
+
+}
+
+class compute_launcher::impl {
+public:
+  explicit impl(device device);
+
+  void assign_levels();
+  void dispatch(command_builder &builder, const queued_launch &launch);
+
+  device device_;
+  uint32_t max_groups_[3];
+  std::vector<queued_launch> launches_;
+  std::vector<uint32_t> order_;
+  resource_tracker tracker_;
+  uint32_t dispatch_count_;
+  uint32_t barrier_count_;
+  uint32_t bind_count_;
+};
+
+compute_launcher::impl::impl(device device)
+: device_{std::move(device)}, dispatch_count_{0}, barrier_count_{0},
+  bind_count_{0} {
+  auto &limits = device_.physical_device().limits();
+  for (auto i = 0u; i < 3; ++i)
+    max_groups_[i] = limits.maxComputeWorkGroupCount[i];
+}
+
+void compute_launcher::impl::assign_levels() {
+  // A launch goes one level after the latest launch it conflicts with: one
+  // that writes what it reads, or reads or writes what it writes.
+  struct buffer_usage {
+    int write_level;
+    int read_level;
+  };
+  std::unordered_map<VkBuffer, buffer_usage> usages;
+  std::unordered_map<VkPipeline, uint32_t> kernels;
+
+  for (auto id = 0u; id < launches_.size(); ++id) {
+    auto &launch = launches_[id];
+    auto level = 0;
+    for (auto buffer: launch.reads) {
+      auto &usage = usages.emplace(buffer, buffer_usage{-1, -1}).first->second;
+      level = std::max(level, usage.write_level + 1);
+    }
+    for (auto buffer: launch.writes) {
+      auto &usage = usages.emplace(buffer, buffer_usage{-1, -1}).first->second;
+      level = std::max(level, std::max(usage.write_level, usage.read_level) + 1);
+    }
+    launch.level = level;
+
+    for (auto buffer: launch.reads) {
+      auto &usage = usages[buffer];
+      usage.read_level = std::max(usage.read_level, level);
+    }
+    for (auto buffer: launch.writes) {
+      auto &usage = usages[buffer];
+      usage.write_level = level;
+      usage.read_level = -1;
+    }
+
+    auto kernel = kernels.emplace(launch.kernel.pipeline(), kernels.size()).first;
+    launch.kernel_order = kernel->second;
+    order_.push_back(id);
+  }
+
+  std::stable_sort(order_.begin(), order_.end(), [&](uint32_t a, uint32_t b) {
+    auto &first = launches_[a];
+    auto &second = launches_[b];
+    if (first.level != second.level)
+      return first.level < second.level;
+    return first.kernel_order < second.kernel_order;
+  });
+}
+
+void compute_launcher::impl::dispatch(command_builder &builder,
+                                      const queued_launch &launch) {
+  auto groups = launch.kernel.group_count(launch.size);
+  uint32_t count[3] = {groups.width, groups.height, groups.depth};
+  auto layout = launch.kernel.layout();
+
+  launch_params params{{0, 0, 0},
+                       {launch.size.width, launch.size.height, launch.size.depth}};
+  auto &base = params.base;
+  for (base[2] = 0; base[2] < count[2]; base[2] += max_groups_[2]) {
+    for (base[1] = 0; base[1] < count[1]; base[1] += max_groups_[1]) {
+      for (base[0] = 0; base[0] < count[0]; base[0] += max_groups_[0]) {
+        builder.push_constants(layout, shader_stage_mask::compute, 0, params);
+        builder.dispatch(std::min(max_groups_[0], count[0] - base[0]),
+                         std::min(max_groups_[1], count[1] - base[1]),
+                         std::min(max_groups_[2], count[2] - base[2]));
+        ++dispatch_count_;
+      }
+    }
+  }
+}
+
+compute_launcher::compute_launcher(device device)
+: impl_{std::make_shared<impl>(std::move(device))} { }
+
+compute_launcher& compute_launcher::launch(compute_kernel kernel, extent<3> size) {
+  impl_->launches_.push_back(queued_launch{std::move(kernel), size, {}, {}, {}, 0, 0});
+  return *this;
+}
+
+compute_launcher& compute_launcher::bind(descriptor_set_ref set) {
+  assert(!impl_->launches_.empty() && "Bind after starting a launch.");
+  impl_->launches_.back().sets.push_back(set);
+  return *this;
+}
+
+compute_launcher& compute_launcher::reads(buffer_ref buffer) {
+  assert(!impl_->launches_.empty() && "Declare reads after starting a launch.");
+  impl_->launches_.back().reads.push_back(buffer);
+  return *this;
+}
+
+compute_launcher& compute_launcher::writes(buffer_ref buffer) {
+  assert(!impl_->launches_.empty() && "Declare writes after starting a launch.");
+  impl_->launches_.back().writes.push_back(buffer);
+  return *this;
+}
+
+void compute_launcher::record(command_builder &builder) {
+  impl_->assign_levels();
+  impl_->dispatch_count_ = 0;
+  impl_->barrier_count_ = 0;
+  impl_->bind_count_ = 0;
+
+  auto &launches = impl_->launches_;
+  auto &order = impl_->order_;
+  auto &tracker = impl_->tracker_;
+  VkPipeline bound_pipeline = VK_NULL_HANDLE;
+  VkPipelineLayout bound_layout = VK_NULL_HANDLE;
+  const std::vector<descriptor_set_ref> *bound_sets = nullptr;
+
+  for (auto position = order.begin(); order.end() != position;) {
+    auto level = launches[*position].level;
+    auto end = std::find_if(position, order.end(), [&](uint32_t id) {
+      return launches[id].level != level;
+    });
+
+    // Launches in a level don't conflict, so one barrier covers them all.
+    for (auto id = position; end != id; ++id) {
+      auto &launch = launches[*id];
+      for (auto buffer: launch.reads) {
+        if (!contains(launch.writes, buffer))
+          tracker.use(buffer, pipeline_stage::compute_shader, access_mask::shader_read);
+      }
+      for (auto buffer: launch.writes) {
+        auto access = contains(launch.reads, buffer)
+                    ? access_mask::shader_read | access_mask::shader_write
+                    : access_mask::shader_write;
+        tracker.use(buffer, pipeline_stage::compute_shader, access);
+      }
+    }
+    if (tracker.pending()) {
+      tracker.flush(builder);
+      ++impl_->barrier_count_;
+    }
+
+    for (; end != position; ++position) {
+      auto &launch = launches[*position];
+      auto &size = launch.size;
+      if (0 == size.width || 0 == size.height || 0 == size.depth)
+        continue;
+
+      VkPipeline pipeline = launch.kernel.pipeline();
+      VkPipelineLayout layout = launch.kernel.layout();
+      if (bound_pipeline != pipeline) {
+        builder.bind_pipeline(pipeline);
+        bound_pipeline = pipeline;
+        ++impl_->bind_count_;
+      }
+      if (!launch.sets.empty() &&
+          (bound_layout != layout || nullptr == bound_sets ||
+           !same_sets(*bound_sets, launch.sets))) {
+        builder.bind_descriptor_sets(layout, launch.sets.data(), launch.sets.size());
+        bound_layout = layout;
+        bound_sets = &launch.sets;
+        ++impl_->bind_count_;
+      }
+      impl_->dispatch(builder, launch);
+    }
+  }
+
+  launches.clear();
+  order.clear();
+}
+
+uint32_t compute_launcher::dispatch_count() const {
+  return impl_->dispatch_count_;
+}
+
+uint32_t compute_launcher::barrier_count() const {
+  return impl_->barrier_count_;
+}
+
+uint32_t compute_launcher::bind_count() const {
+  return impl_->bind_count_;
+}
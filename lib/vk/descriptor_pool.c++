@@ -1,5 +1,10 @@
 #include <vk/vk.h>
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include "dispatch.h"
+#include "trace.h"
+#include "utility.h"
 
 using namespace vk;
 
@@ -20,6 +25,8 @@ public:
   
   device device_;
   VkDescriptorPool handle_;
+  // Whether sets may be handed back one at a time.
+  bool free_sets_;
 };
 
 descriptor_set::impl::impl(device device, descriptor_pool pool, VkDescriptorSet handle)
@@ -27,8 +34,9 @@ descriptor_set::impl::impl(device device, descriptor_pool pool, VkDescriptorSet
 }
 
 descriptor_set::impl::~impl() {
-  if (VK_NULL_HANDLE != handle_) {
-    vkFreeDescriptorSets(device_, pool_, 1, &handle_);
+  // Sets from pools without the free bit go back when the pool is reset.
+  if (VK_NULL_HANDLE != handle_ && pool_.impl_->free_sets_) {
+    device_.dispatch().vkFreeDescriptorSets(device_, pool_, 1, &handle_);
   }
 }
 
@@ -37,8 +45,9 @@ descriptor_set::operator VkDescriptorSet() {
 }
 
 void descriptor_set::update(descriptor_binding* bindings, size_t binding_count) {
-  std::vector<VkWriteDescriptorSet> writes(binding_count);
-  std::vector<VkDescriptorBufferInfo> buffer_info(binding_count);
+  VK_TRACE_SCOPE("vkUpdateDescriptorSets");
+  scratch_buffer<VkWriteDescriptorSet> writes(binding_count);
+  scratch_buffer<VkDescriptorBufferInfo> buffer_info(binding_count);
   for (auto i = 0ul; i < writes.size(); ++i) {
     buffer_info[i].buffer = bindings[i].buf;
     buffer_info[i].offset = 0;
@@ -56,15 +65,22 @@ void descriptor_set::update(descriptor_binding* bindings, size_t binding_count)
     writes[i].pTexelBufferView = nullptr;
   }
 
-  vkUpdateDescriptorSets(impl_->device_, binding_count, writes.data(), 0, nullptr);
+  impl_->device_.dispatch().vkUpdateDescriptorSets(impl_->device_, binding_count, writes.data(), 0, nullptr);
+}
+
+void descriptor_set::update(descriptor_update_template &update_template,
+                            const void *data) {
+  VK_TRACE_SCOPE("vkUpdateDescriptorSetWithTemplateKHR");
+  impl_->device_.dispatch().vkUpdateDescriptorSetWithTemplateKHR(impl_->device_, impl_->handle_,
+                                                update_template, data);
 }
 
 descriptor_pool::impl::impl(device device)
-: device_{std::move(device)}, handle_{VK_NULL_HANDLE} { }
+: device_{std::move(device)}, handle_{VK_NULL_HANDLE}, free_sets_{true} { }
 
 descriptor_pool::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroyDescriptorPool(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyDescriptorPool(device_, handle_, nullptr);
   }
 }
 
@@ -90,7 +106,28 @@ descriptor_pool::descriptor_pool(device device, uint32_t max_sets)
   info.poolSizeCount = 1;
   info.pPoolSizes = &pool_size;
 
-  auto result = vkCreateDescriptorPool(impl_->device_, &info, nullptr,
+  auto result = impl_->device_.dispatch().vkCreateDescriptorPool(impl_->device_, &info, nullptr,
+                                       &impl_->handle_);
+  assert(VK_SUCCESS == result &&
+         "Failed to create descriptor pool.");
+}
+
+descriptor_pool::descriptor_pool(device device, uint32_t max_sets,
+                                 const descriptor_pool_size *sizes,
+                                 size_t size_count, bool free_sets)
+: impl_{std::make_shared<impl>(device)}
+{
+  impl_->free_sets_ = free_sets;
+
+  VkDescriptorPoolCreateInfo info;
+  info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  info.pNext = nullptr;
+  info.flags = free_sets ? VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT : 0;
+  info.maxSets = max_sets;
+  info.poolSizeCount = size_count;
+  info.pPoolSizes = reinterpret_cast<const VkDescriptorPoolSize*>(sizes);
+
+  auto result = impl_->device_.dispatch().vkCreateDescriptorPool(impl_->device_, &info, nullptr,
                                        &impl_->handle_);
   assert(VK_SUCCESS == result &&
          "Failed to create descriptor pool.");
@@ -101,6 +138,7 @@ descriptor_pool::operator VkDescriptorPool() {
 }
 
 descriptor_set descriptor_pool::allocate(descriptor_set_layout layout) {
+  VK_TRACE_SCOPE("vkAllocateDescriptorSets");
   VkDescriptorSetLayout layout_handle = layout;
 
   VkDescriptorSetAllocateInfo info;
@@ -111,14 +149,162 @@ descriptor_set descriptor_pool::allocate(descriptor_set_layout layout) {
   info.pSetLayouts = &layout_handle;
 
   VkDescriptorSet handle;
-  auto result = vkAllocateDescriptorSets(impl_->device_, &info, &handle);
+  auto result = impl_->device_.dispatch().vkAllocateDescriptorSets(impl_->device_, &info, &handle);
   assert(VK_SUCCESS == result && "Failed to allocate descriptor set");
 
   return descriptor_set{impl_->device_, *this, handle};
 }
 
 void descriptor_pool::reset() {
-  auto result = vkResetDescriptorPool(impl_->device_, impl_->handle_, 0);
+  auto result = impl_->device_.dispatch().vkResetDescriptorPool(impl_->device_, impl_->handle_, 0);
   assert(VK_SUCCESS == result && "Failed to reset descriptor pool.");
 }
 
+
+class descriptor_allocator::impl {
+public:
+  // The pools one frame slot allocates from, in the order they were added.
+  struct chain {
+    std::vector<descriptor_pool> pools_;
+    size_t current_;
+  };
+
+  impl(device device, const descriptor_set_layout *layouts, size_t layout_count,
+       uint32_t sets_per_pool, uint32_t frame_count, bool linear);
+
+  descriptor_pool make_pool();
+  // Whether a fresh pool can hold a set with the layout.
+  bool fits(const descriptor_set_layout &layout) const;
+  // Returns whether the pool moved to was just created.
+  bool next_pool(chain &chain);
+
+  device device_;
+  uint32_t sets_per_pool_;
+  bool linear_;
+  std::vector<descriptor_pool_size> pool_sizes_;
+  std::vector<chain> chains_;
+  uint32_t current_frame_;
+};
+
+descriptor_allocator::impl::impl(device device,
+                                 const descriptor_set_layout *layouts,
+                                 size_t layout_count, uint32_t sets_per_pool,
+                                 uint32_t frame_count, bool linear)
+: device_{std::move(device)}, sets_per_pool_{sets_per_pool}, linear_{linear},
+  chains_(frame_count, chain{{}, 0}), current_frame_{0} {
+  assert(0 < sets_per_pool && 0 < frame_count &&
+         "Descriptor allocator needs at least one set and frame.");
+
+  // Size each type for a pool full of whichever layout needs the most of it,
+  // so any mix of the layouts fits sets_per_pool sets.
+  for (auto i = 0ul; i < layout_count; ++i) {
+    for (auto &count: layouts[i].descriptor_counts()) {
+      auto found = std::find_if(pool_sizes_.begin(), pool_sizes_.end(),
+          [&](const descriptor_pool_size &size) { return size.type == count.type; });
+      if (pool_sizes_.end() == found)
+        pool_sizes_.push_back({count.type, count.count * sets_per_pool});
+      else
+        found->count = std::max(found->count, count.count * sets_per_pool);
+    }
+  }
+}
+
+descriptor_pool descriptor_allocator::impl::make_pool() {
+  return descriptor_pool{device_, sets_per_pool_, pool_sizes_.data(),
+                         pool_sizes_.size(), !linear_};
+}
+
+bool descriptor_allocator::impl::fits(const descriptor_set_layout &layout) const {
+  for (auto &count: layout.descriptor_counts()) {
+    auto found = std::find_if(pool_sizes_.begin(), pool_sizes_.end(),
+        [&](const descriptor_pool_size &size) { return size.type == count.type; });
+    if (pool_sizes_.end() == found || found->count < count.count)
+      return false;
+  }
+  return true;
+}
+
+bool descriptor_allocator::impl::next_pool(chain &chain) {
+  ++chain.current_;
+  if (chain.pools_.size() != chain.current_)
+    return false;
+
+  chain.pools_.push_back(make_pool());
+  return true;
+}
+
+descriptor_allocator::descriptor_allocator(device device,
+                                           const descriptor_set_layout *layouts,
+                                           size_t layout_count,
+                                           uint32_t sets_per_pool)
+: impl_{std::make_shared<impl>(device, layouts, layout_count, sets_per_pool,
+                               1, false)} { }
+
+descriptor_allocator::descriptor_allocator(device device,
+                                           const descriptor_set_layout *layouts,
+                                           size_t layout_count,
+                                           uint32_t sets_per_pool,
+                                           uint32_t frame_count)
+: impl_{std::make_shared<impl>(device, layouts, layout_count, sets_per_pool,
+                               frame_count, true)} { }
+
+void descriptor_allocator::begin_frame(uint32_t frame) {
+  assert(impl_->linear_ && "Only per-frame allocators have frames.");
+  assert(frame < impl_->chains_.size() && "Frame slot out of range.");
+  impl_->current_frame_ = frame;
+
+  // The caller has waited on this slot's fence, so no set from these pools
+  // is still in use. Pools past current_ were never touched.
+  auto &chain = impl_->chains_[frame];
+  for (auto i = 0ul; i < chain.pools_.size() && i <= chain.current_; ++i)
+    chain.pools_[i].reset();
+  chain.current_ = 0;
+}
+
+descriptor_set descriptor_allocator::allocate(descriptor_set_layout layout) {
+  VK_TRACE_SCOPE("descriptor_allocator::allocate");
+  assert(impl_->fits(layout) &&
+         "Layout needs descriptors the allocator's pools weren't sized for.");
+  auto &chain = impl_->chains_[impl_->current_frame_];
+  auto fresh = chain.pools_.empty();
+  if (fresh)
+    chain.pools_.push_back(impl_->make_pool());
+
+  VkDescriptorSetLayout layout_handle = layout;
+
+  VkDescriptorSetAllocateInfo info;
+  info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  info.pNext = nullptr;
+  info.descriptorSetCount = 1;
+  info.pSetLayouts = &layout_handle;
+
+  // Individually freed sets leave holes anywhere in the chain, so those
+  // allocators start from the front. A linear chain only ever fills up.
+  if (!impl_->linear_)
+    chain.current_ = 0;
+
+  for (;;) {
+    auto &pool = chain.pools_[chain.current_];
+    info.descriptorPool = pool;
+
+    VkDescriptorSet handle;
+    auto result = impl_->device_.dispatch().vkAllocateDescriptorSets(impl_->device_, &info, &handle);
+    if (VK_SUCCESS == result)
+      return descriptor_set{impl_->device_, pool, handle};
+
+    // Another pool won't do better than an empty one.
+    if (fresh || (VK_ERROR_OUT_OF_POOL_MEMORY_KHR != result &&
+                  VK_ERROR_FRAGMENTED_POOL != result)) {
+      assert(false && "Failed to allocate descriptor set");
+      abort();
+    }
+    fresh = impl_->next_pool(chain);
+  }
+}
+
+size_t descriptor_allocator::pool_count() const {
+  size_t count = 0;
+  for (auto &chain: impl_->chains_)
+    count += chain.pools_.size();
+  return count;
+}
@@ -1,5 +1,7 @@
 #include <vk/vk.h>
+#include <algorithm>
 #include <cassert>
+#include "dispatch.h"
 
 using namespace vk;
 
@@ -10,6 +12,7 @@ public:
   
   device device_;
   VkDescriptorSetLayout handle_;
+  std::vector<descriptor_pool_size> descriptor_counts_;
 };
 
 descriptor_set_layout::impl::impl(device device)
@@ -17,7 +20,7 @@ descriptor_set_layout::impl::impl(device device)
 
 descriptor_set_layout::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroyDescriptorSetLayout(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyDescriptorSetLayout(device_, handle_, nullptr);
   }
 }
 
@@ -30,10 +33,18 @@ descriptor_set_layout::descriptor_set_layout(device device,
   std::vector<VkDescriptorSetLayoutBinding> layout_bindings(binding_count);
   for (auto i = 0ul; i < binding_count; ++i) {
     layout_bindings[i].binding = bindings[i].get_index();
-    layout_bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-    layout_bindings[i].descriptorCount = 1;
-    layout_bindings[i].stageFlags = VK_SHADER_STAGE_ALL;
+    layout_bindings[i].descriptorType = static_cast<VkDescriptorType>(bindings[i].type());
+    layout_bindings[i].descriptorCount = bindings[i].count();
+    layout_bindings[i].stageFlags = static_cast<VkShaderStageFlags>(bindings[i].stages());
     layout_bindings[i].pImmutableSamplers = nullptr;
+
+    auto &counts = impl_->descriptor_counts_;
+    auto found = std::find_if(counts.begin(), counts.end(),
+        [&](const descriptor_pool_size &size) { return size.type == bindings[i].type(); });
+    if (counts.end() == found)
+      counts.push_back({bindings[i].type(), bindings[i].count()});
+    else
+      found->count += bindings[i].count();
   }
 
   VkDescriptorSetLayoutCreateInfo info;
@@ -43,7 +54,7 @@ descriptor_set_layout::descriptor_set_layout(device device,
   info.bindingCount = binding_count;
   info.pBindings = layout_bindings.data();
 
-  auto result = vkCreateDescriptorSetLayout(impl_->device_, &info, nullptr,
+  auto result = impl_->device_.dispatch().vkCreateDescriptorSetLayout(impl_->device_, &info, nullptr,
                                        &impl_->handle_);
   assert(VK_SUCCESS == result &&
          "Failed to create descriptor set layout.");
@@ -52,3 +63,7 @@ descriptor_set_layout::descriptor_set_layout(device device,
 descriptor_set_layout::operator VkDescriptorSetLayout() {
   return impl_->handle_;
 }
+
+const std::vector<descriptor_pool_size>& descriptor_set_layout::descriptor_counts() const {
+  return impl_->descriptor_counts_;
+}
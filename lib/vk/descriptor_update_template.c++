@@ -0,0 +1,56 @@
+#include <vk/vk.h>
+#include <cassert>
+#include "dispatch.h"
+
+using namespace vk;
+
+class descriptor_update_template::impl {
+public:
+  impl(device device);
+  ~impl();
+
+  device device_;
+  VkDescriptorUpdateTemplateKHR handle_;
+};
+
+descriptor_update_template::impl::impl(device device)
+: device_{std::move(device)}, handle_{VK_NULL_HANDLE} { }
+
+descriptor_update_template::impl::~impl() {
+  if (VK_NULL_HANDLE != handle_) {
+    device_.dispatch().vkDestroyDescriptorUpdateTemplateKHR(device_, handle_, nullptr);
+  }
+}
+
+descriptor_update_template::descriptor_update_template(device device,
+                                                       descriptor_set_layout layout,
+                                                       const descriptor_update_entry *entries,
+                                                       size_t entry_count)
+: impl_{std::make_shared<impl>(std::move(device))}
+{
+  assert(nullptr != impl_->device_.dispatch().vkCreateDescriptorUpdateTemplateKHR &&
+         "Device does not support VK_KHR_descriptor_update_template.");
+
+  VkDescriptorUpdateTemplateCreateInfo info;
+  info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+  info.pNext = nullptr;
+  info.flags = 0;
+  info.descriptorUpdateEntryCount = entry_count;
+  info.pDescriptorUpdateEntries =
+    reinterpret_cast<const VkDescriptorUpdateTemplateEntry*>(entries);
+  info.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+  info.descriptorSetLayout = layout;
+  // Only used by push descriptor templates.
+  info.pipelineBindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+  info.pipelineLayout = VK_NULL_HANDLE;
+  info.set = 0;
+
+  auto result = impl_->device_.dispatch().vkCreateDescriptorUpdateTemplateKHR(impl_->device_, &info,
+                                         nullptr, &impl_->handle_);
+  assert(VK_SUCCESS == result &&
+         "Failed to create descriptor update template.");
+}
+
+descriptor_update_template::operator VkDescriptorUpdateTemplateKHR() {
+  return impl_->handle_;
+}
@@ -0,0 +1,95 @@
+#include <vk/vk.h>
+#include "dispatch.h"
+#include "trace.h"
+
+using namespace vk;
+
+descriptor_writer::descriptor_writer(device device)
+: device_{std::move(device)} { }
+
+void descriptor_writer::push_write(VkDescriptorSet set, uint32_t binding,
+                                   descriptor_type type, uint32_t array_element,
+                                   size_t info_index) {
+  VkWriteDescriptorSet write;
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.pNext = nullptr;
+  write.dstSet = set;
+  write.dstBinding = binding;
+  write.dstArrayElement = array_element;
+  write.descriptorCount = 1;
+  write.descriptorType = static_cast<VkDescriptorType>(type);
+  write.pImageInfo = nullptr;
+  write.pBufferInfo = nullptr;
+  write.pTexelBufferView = nullptr;
+  writes_.push_back(write);
+  info_indices_.push_back(info_index);
+}
+
+void descriptor_writer::write_buffer(descriptor_set_ref set, uint32_t binding,
+                                     descriptor_type type, buffer_ref buffer,
+                                     VkDeviceSize offset, VkDeviceSize range,
+                                     uint32_t array_element) {
+  push_write(set, binding, type, array_element, buffer_infos_.size());
+  buffer_infos_.push_back({buffer, offset, range});
+}
+
+void descriptor_writer::write_image(descriptor_set_ref set, uint32_t binding,
+                                    descriptor_type type, image_view_ref view,
+                                    image_layout layout, sampler_ref sampler,
+                                    uint32_t array_element) {
+  push_write(set, binding, type, array_element, image_infos_.size());
+  image_infos_.push_back({sampler, view, static_cast<VkImageLayout>(layout)});
+}
+
+void descriptor_writer::write_sampler(descriptor_set_ref set, uint32_t binding,
+                                      sampler_ref sampler, uint32_t array_element) {
+  push_write(set, binding, descriptor_type::sampler, array_element,
+             image_infos_.size());
+  image_infos_.push_back({sampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED});
+}
+
+void descriptor_writer::write_texel_buffer(descriptor_set_ref set, uint32_t binding,
+                                           descriptor_type type, buffer_view_ref view,
+                                           uint32_t array_element) {
+  push_write(set, binding, type, array_element, texel_buffer_views_.size());
+  texel_buffer_views_.push_back(view);
+}
+
+size_t descriptor_writer::size() const {
+  return writes_.size();
+}
+
+void descriptor_writer::flush() {
+  if (writes_.empty())
+    return;
+
+  VK_TRACE_SCOPE("vkUpdateDescriptorSets");
+  for (auto i = 0ul; i < writes_.size(); ++i) {
+    auto &write = writes_[i];
+    switch (write.descriptorType) {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+    case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+      write.pImageInfo = &image_infos_[info_indices_[i]];
+      break;
+    case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+    case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+      write.pTexelBufferView = &texel_buffer_views_[info_indices_[i]];
+      break;
+    default:
+      write.pBufferInfo = &buffer_infos_[info_indices_[i]];
+      break;
+    }
+  }
+
+  device_.dispatch().vkUpdateDescriptorSets(device_, writes_.size(), writes_.data(), 0, nullptr);
+
+  // clear() keeps the capacity for the next batch.
+  writes_.clear();
+  info_indices_.clear();
+  buffer_infos_.clear();
+  image_infos_.clear();
+  texel_buffer_views_.clear();
+}
@@ -1,36 +1,101 @@
 #include <vk/vk.h>
+#include <array>
 #include <cassert>
+#include <cstring>
+#include "dispatch.h"
+#include "trace.h"
 
 using namespace vk;
 
+namespace {
+
+std::vector<queue_request> default_queue_requests(const vk::physical_device &physical_dev) {
+  const queue_family *graphics = nullptr;
+  const queue_family *compute = nullptr;
+  const queue_family *transfer = nullptr;
+  for (auto &family: physical_dev.queue_families()) {
+    if (family.is_graphics_queue()) {
+      if (nullptr == graphics)
+        graphics = &family;
+    } else if (family.is_compute_queue()) {
+      if (nullptr == compute)
+        compute = &family;
+    } else if (family.is_transfer_queue()) {
+      if (nullptr == transfer)
+        transfer = &family;
+    }
+  }
+
+  // Without a transfer-only family, uploads are still better off on the
+  // async compute family than queued up behind graphics work.
+  if (nullptr == transfer)
+    transfer = compute;
+
+  std::vector<queue_request> requests;
+  requests.push_back({queue_role::graphics,
+                      nullptr != graphics ? graphics->index : 0, 1.0f});
+  if (nullptr != compute)
+    requests.push_back({queue_role::compute, compute->index, 0.5f});
+  if (nullptr != transfer)
+    requests.push_back({queue_role::transfer, transfer->index, 0.5f});
+  return requests;
+}
+
+}
+
+void device_dispatch::load(VkDevice device) {
+#define VK_DISPATCH_LOAD(name) \
+  name = reinterpret_cast<PFN_##name>(vkGetDeviceProcAddr(device, #name));
+  VK_DEVICE_FUNCTIONS(VK_DISPATCH_LOAD)
+#undef VK_DISPATCH_LOAD
+}
+
 class device::impl {
 public:
+  struct queue_binding {
+    bool assigned;
+    uint32_t family;
+    uint32_t index;
+  };
+
   impl(const vk::physical_device&);
   ~impl();
 
+  void create(const queue_request *requests, size_t request_count);
+  const queue_binding& binding(queue_role role) const;
+
   const vk::physical_device& physical_dev_;
   VkDevice handle_;
+  device_dispatch dispatch_;
+  std::array<queue_binding, 3> roles_;
+  VkPhysicalDeviceFeatures features_;
+  bool timeline_semaphores_;
 };
 
 device::impl::impl(const vk::physical_device& physical_dev)
-: physical_dev_{physical_dev}, handle_{VK_NULL_HANDLE} { }
+: physical_dev_{physical_dev}, handle_{VK_NULL_HANDLE}, dispatch_{},
+  timeline_semaphores_{false} {
+  roles_.fill({false, 0, 0});
+  features_ = VkPhysicalDeviceFeatures{};
+}
 
 device::impl::~impl() {
   if (0 != handle_) {
-    vkDestroyDevice(handle_, nullptr);
+    dispatch_.vkDestroyDevice(handle_, nullptr);
   }
 }
 
-device::device(const vk::physical_device& physical_dev)
-: impl_{std::make_shared<impl>(physical_dev)} {
+void device::impl::create(const queue_request *requests, size_t request_count) {
+  assert(0 < request_count && "A device needs at least one queue.");
+
   // Enumerate the available layers.
   uint32_t count = 0;
   std::vector<VkLayerProperties> layers;
   std::vector<const char*> enabled_layers;
-  auto result = vkEnumerateDeviceLayerProperties(physical_dev, &count, nullptr);
+  auto result = vkEnumerateDeviceLayerProperties(physical_dev_, &count, nullptr);
   if (VK_SUCCESS == result) {
     layers.resize(count);
-    result = vkEnumerateDeviceLayerProperties(physical_dev, &count, layers.data());
+    result = vkEnumerateDeviceLayerProperties(physical_dev_, &count, layers.data());
     if (VK_SUCCESS == result) {
       for (auto &layer: layers) {
         // We should really check each layer individually, but for now our test 
@@ -44,46 +109,116 @@ device::device(const vk::physical_device& physical_dev)
   count = 0;
   std::vector<VkExtensionProperties> extensions;
   std::vector<const char*> enabled_extensions;
-  result = vkEnumerateDeviceExtensionProperties(physical_dev, nullptr, &count, nullptr);
+  result = vkEnumerateDeviceExtensionProperties(physical_dev_, nullptr, &count, nullptr);
   if (VK_SUCCESS == result) {
     extensions.resize(count);
-    result = vkEnumerateDeviceExtensionProperties(physical_dev, nullptr, &count, extensions.data());
+    result = vkEnumerateDeviceExtensionProperties(physical_dev_, nullptr, &count, extensions.data());
     if (VK_SUCCESS == result) {
       for (auto &extension: extensions) {
         enabled_extensions.push_back(extension.extensionName);
+        if (0 == std::strcmp(extension.extensionName,
+                             VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+          timeline_semaphores_ = true;
       }
     }
   }
 
-  // For now we will just default to the first queue. This is easy but wrong.
-  float priority = 1.0f;
+  // Give each request its own queue while the family has queues left, after
+  // which requests share the family's last queue.
+  std::vector<uint32_t> family_sizes;
+  for (auto &family: physical_dev_.queue_families())
+    family_sizes.push_back(family.count);
+
+  std::vector<std::vector<float>> priorities(family_sizes.size());
+  for (auto i = 0ul; i < request_count; ++i) {
+    auto &request = requests[i];
+    assert(request.family < family_sizes.size() && "Unknown queue family.");
+
+    auto &family_priorities = priorities[request.family];
+    if (family_priorities.size() < family_sizes[request.family])
+      family_priorities.push_back(request.priority);
+
+    auto &binding = roles_[static_cast<size_t>(request.role)];
+    binding.assigned = true;
+    binding.family = request.family;
+    binding.index = family_priorities.size() - 1;
+  }
+
+  std::vector<VkDeviceQueueCreateInfo> queue_infos;
+  for (auto family = 0u; family < priorities.size(); ++family) {
+    if (priorities[family].empty())
+      continue;
+
+    VkDeviceQueueCreateInfo queue_info;
+    queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queue_info.pNext = nullptr;
+    queue_info.flags = 0;
+    queue_info.queueFamilyIndex = family;
+    queue_info.queueCount = priorities[family].size();
+    queue_info.pQueuePriorities = priorities[family].data();
+    queue_infos.push_back(queue_info);
+  }
+
+  // Roles nobody asked for run on the graphics queue, or failing that on
+  // whatever was requested first.
+  if (!roles_[static_cast<size_t>(queue_role::graphics)].assigned) {
+    auto &first = requests[0];
+    roles_[static_cast<size_t>(queue_role::graphics)] =
+      roles_[static_cast<size_t>(first.role)];
+  }
+
+  for (auto &binding: roles_) {
+    if (!binding.assigned)
+      binding = roles_[static_cast<size_t>(queue_role::graphics)];
+  }
+
+  // Query features are free to enable, and profiling needs them.
+  auto &supported = physical_dev_.features();
+  features_.occlusionQueryPrecise = supported.occlusionQueryPrecise;
+  features_.pipelineStatisticsQuery = supported.pipelineStatisticsQuery;
 
-  VkDeviceQueueCreateInfo queue_info;
-  queue_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-  queue_info.pNext = nullptr;
-  queue_info.flags = 0;
-  queue_info.queueFamilyIndex = 0;
-  queue_info.queueCount = 1;
-  queue_info.pQueuePriorities = &priority;
+  // The extension requires its feature to be supported, so there is nothing
+  // to query before turning it on.
+  VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_features;
+  timeline_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+  timeline_features.pNext = nullptr;
+  timeline_features.timelineSemaphore = VK_TRUE;
 
   VkDeviceCreateInfo info;
   info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-  info.pNext = nullptr;
+  info.pNext = timeline_semaphores_ ? &timeline_features : nullptr;
   info.flags = 0;
-  info.queueCreateInfoCount = 1;
-  info.pQueueCreateInfos = &queue_info;
+  info.queueCreateInfoCount = queue_infos.size();
+  info.pQueueCreateInfos = queue_infos.data();
   info.enabledLayerCount = enabled_layers.size();
   info.ppEnabledLayerNames = enabled_layers.data();
   info.enabledExtensionCount = enabled_extensions.size();
   info.ppEnabledExtensionNames = enabled_extensions.data();
-  info.pEnabledFeatures = nullptr;
+  info.pEnabledFeatures = &features_;
 
   VkDevice handle = 0;
-  result = vkCreateDevice(physical_dev, &info, nullptr, &handle);
+  result = vkCreateDevice(physical_dev_, &info, nullptr, &handle);
   if (VK_SUCCESS != result)
     return;
 
-  impl_->handle_ = handle;
+  handle_ = handle;
+  dispatch_.load(handle_);
+}
+
+const device::impl::queue_binding& device::impl::binding(queue_role role) const {
+  return roles_[static_cast<size_t>(role)];
+}
+
+device::device(const vk::physical_device& physical_dev)
+: impl_{std::make_shared<impl>(physical_dev)} {
+  auto requests = default_queue_requests(physical_dev);
+  impl_->create(requests.data(), requests.size());
+}
+
+device::device(const vk::physical_device& physical_dev,
+               const queue_request *requests, size_t request_count)
+: impl_{std::make_shared<impl>(physical_dev)} {
+  impl_->create(requests, request_count);
 }
 
 device::operator VkDevice() {
@@ -93,16 +228,38 @@ device::operator VkDevice() {
 queue device::get_queue(uint32_t queue_family, uint32_t index) {
   VkQueue queue_handle = 0;
 
-  vkGetDeviceQueue(impl_->handle_, queue_family, index, &queue_handle);
-  return queue{queue_handle};
+  impl_->dispatch_.vkGetDeviceQueue(impl_->handle_, queue_family, index, &queue_handle);
+  return queue{queue_handle, queue_family, impl_->dispatch_};
+}
+
+queue device::get_queue(queue_role role) {
+  auto &binding = impl_->binding(role);
+  return get_queue(binding.family, binding.index);
+}
+
+uint32_t device::queue_family_index(queue_role role) const {
+  return impl_->binding(role).family;
 }
 
 const vk::physical_device& device::physical_device() const {
   return impl_->physical_dev_;
 }
 
+const VkPhysicalDeviceFeatures& device::enabled_features() const {
+  return impl_->features_;
+}
+
+bool device::supports_timeline_semaphores() const {
+  return impl_->timeline_semaphores_;
+}
+
+const device_dispatch& device::dispatch() const {
+  return impl_->dispatch_;
+}
+
 void device::wait_idle() {
-  auto result = vkDeviceWaitIdle(impl_->handle_);
+  VK_TRACE_SCOPE("vkDeviceWaitIdle");
+  auto result = impl_->dispatch_.vkDeviceWaitIdle(impl_->handle_);
   assert(VK_SUCCESS == result && "Wait for device idle failed.");
 }
 
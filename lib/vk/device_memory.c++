@@ -1,5 +1,7 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
+#include "trace.h"
 
 using namespace vk;
 
@@ -8,31 +10,71 @@ public:
   impl(device);
   ~impl();
 
+  VkMappedMemoryRange range(size_t offset, size_t size) const;
+
   device device_;
   VkDeviceMemory handle_;
+  size_t size_;
+  bool coherent_;
+  void *mapped_;
 };
 
 device_memory::impl::impl(device device)
-: device_{device}, handle_{VK_NULL_HANDLE} { }
+: device_{device}, handle_{VK_NULL_HANDLE}, size_{0}, coherent_{false},
+  mapped_{nullptr} { }
 
 device_memory::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkFreeMemory(device_, handle_, nullptr);
+    if (nullptr != mapped_)
+      device_.dispatch().vkUnmapMemory(device_, handle_);
+    device_.dispatch().vkFreeMemory(device_, handle_, nullptr);
   }
 }
 
+VkMappedMemoryRange device_memory::impl::range(size_t offset, size_t size) const {
+  // Non-coherent ranges must start and end on atom boundaries, or run to the
+  // end of the allocation.
+  VkDeviceSize atom = device_.physical_device().limits().nonCoherentAtomSize;
+  VkDeviceSize begin = offset - offset % atom;
+  VkDeviceSize end = (offset + size + atom - 1) / atom * atom;
+
+  VkMappedMemoryRange range;
+  range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+  range.pNext = nullptr;
+  range.memory = handle_;
+  range.offset = begin;
+  range.size = end >= size_ ? VK_WHOLE_SIZE : end - begin;
+  return range;
+}
+
 device_memory::device_memory(device device, const physical_device::memory_type &memory_type, size_t size)
+: device_memory(device, memory_type, size, false) { }
+
+device_memory::device_memory(device device, const physical_device::memory_type &memory_type,
+                             size_t size, bool persistently_mapped)
 : impl_{std::make_shared<impl>(device)}
 {
+  VK_TRACE_SCOPE("vkAllocateMemory");
   VkMemoryAllocateInfo info;
   info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
   info.pNext = nullptr;
   info.allocationSize = size;
   info.memoryTypeIndex = memory_type.index;
 
-  auto result = vkAllocateMemory(impl_->device_, &info, nullptr, &impl_->handle_);
+  auto result = impl_->device_.dispatch().vkAllocateMemory(impl_->device_, &info, nullptr, &impl_->handle_);
   assert(VK_SUCCESS == result &&
          "Failed to allocate device memory.");
+
+  impl_->size_ = size;
+  impl_->coherent_ = memory_type.is_host_coherent();
+
+  if (persistently_mapped) {
+    assert(memory_type.is_host_visible() &&
+           "Only host visible memory can be mapped.");
+    result = impl_->device_.dispatch().vkMapMemory(impl_->device_, impl_->handle_, 0, VK_WHOLE_SIZE, 0,
+                         &impl_->mapped_);
+    assert(VK_SUCCESS == result && "Failed to map device memory.");
+  }
 }
 
 device_memory::operator VkDeviceMemory() {
@@ -41,12 +83,46 @@ device_memory::operator VkDeviceMemory() {
 
 size_t device_memory::get_commitment() const {
   size_t size_in_bytes = 0;
-  vkGetDeviceMemoryCommitment(impl_->device_, impl_->handle_, &size_in_bytes);
+  impl_->device_.dispatch().vkGetDeviceMemoryCommitment(impl_->device_, impl_->handle_, &size_in_bytes);
   return size_in_bytes;
 }
 
+bool device_memory::is_persistently_mapped() const {
+  return nullptr != impl_->mapped_;
+}
+
+void* device_memory::mapped_data() const {
+  assert(nullptr != impl_->mapped_ && "Memory is not persistently mapped.");
+  return impl_->mapped_;
+}
+
+void device_memory::flush(size_t offset, size_t size) {
+  if (impl_->coherent_)
+    return;
+
+  auto range = impl_->range(offset, size);
+  auto result = impl_->device_.dispatch().vkFlushMappedMemoryRanges(impl_->device_, 1, &range);
+  assert(VK_SUCCESS == result && "Failed to flush mapped memory.");
+}
+
+void device_memory::invalidate(size_t offset, size_t size) {
+  if (impl_->coherent_)
+    return;
+
+  auto range = impl_->range(offset, size);
+  auto result = impl_->device_.dispatch().vkInvalidateMappedMemoryRanges(impl_->device_, 1, &range);
+  assert(VK_SUCCESS == result && "Failed to invalidate mapped memory.");
+}
+
 bool vk::map_memory(device_memory memory, size_t offset, size_t size, void **ptr) {
- auto result = vkMapMemory(memory.impl_->device_,
+ // Persistently mapped memory can't be mapped again, hand out the existing
+ // mapping instead.
+ if (nullptr != memory.impl_->mapped_) {
+   *ptr = static_cast<char*>(memory.impl_->mapped_) + offset;
+   return true;
+ }
+
+ auto result = memory.impl_->device_.dispatch().vkMapMemory(memory.impl_->device_,
                            memory, offset, size, 0, ptr);
  if (VK_SUCCESS == result)
    return true;
@@ -55,6 +131,9 @@ bool vk::map_memory(device_memory memory, size_t offset, size_t size, void **ptr
 }
 
 void vk::unmap_memory(device_memory memory) {
-  vkUnmapMemory(memory.impl_->device_, memory);
+  if (nullptr != memory.impl_->mapped_)
+    return;
+
+  memory.impl_->device_.dispatch().vkUnmapMemory(memory.impl_->device_, memory);
 }
 
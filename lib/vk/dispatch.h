@@ -0,0 +1,141 @@
+#ifndef VK_DISPATCH_H
+#define VK_DISPATCH_H
+
+#include <vulkan/vulkan.h>
+
+// Every device and command level entry point the library calls. Adding a
+// call means adding it here; the table is filled from vkGetDeviceProcAddr.
+#define VK_DEVICE_FUNCTIONS(X)          \
+  X(vkAcquireNextImageKHR)              \
+  X(vkAllocateCommandBuffers)           \
+  X(vkAllocateDescriptorSets)           \
+  X(vkAllocateMemory)                   \
+  X(vkBeginCommandBuffer)               \
+  X(vkBindBufferMemory)                 \
+  X(vkBindImageMemory)                  \
+  X(vkCmdBeginQuery)                    \
+  X(vkCmdBeginRenderPass)               \
+  X(vkCmdBindDescriptorSets)            \
+  X(vkCmdBindIndexBuffer)               \
+  X(vkCmdBindPipeline)                  \
+  X(vkCmdBlitImage)                     \
+  X(vkCmdClearAttachments)              \
+  X(vkCmdClearColorImage)               \
+  X(vkCmdCopyBuffer)                    \
+  X(vkCmdCopyBufferToImage)             \
+  X(vkCmdCopyImageToBuffer)             \
+  X(vkCmdDispatch)                      \
+  X(vkCmdDispatchIndirect)              \
+  X(vkCmdDraw)                          \
+  X(vkCmdDrawIndexed)                   \
+  X(vkCmdDrawIndexedIndirect)           \
+  X(vkCmdDrawIndirect)                  \
+  X(vkCmdEndQuery)                      \
+  X(vkCmdEndRenderPass)                 \
+  X(vkCmdExecuteCommands)               \
+  X(vkCmdFillBuffer)                    \
+  X(vkCmdPipelineBarrier)               \
+  X(vkCmdPushConstants)                 \
+  X(vkCmdResetEvent)                    \
+  X(vkCmdResetQueryPool)                \
+  X(vkCmdSetDepthBias)                  \
+  X(vkCmdSetDepthBounds)                \
+  X(vkCmdSetEvent)                      \
+  X(vkCmdSetLineWidth)                  \
+  X(vkCmdSetViewport)                   \
+  X(vkCmdUpdateBuffer)                  \
+  X(vkCmdWaitEvents)                    \
+  X(vkCmdWriteTimestamp)                \
+  X(vkCreateBuffer)                     \
+  X(vkCreateBufferView)                 \
+  X(vkCreateCommandPool)                \
+  X(vkCreateComputePipelines)           \
+  X(vkCreateDescriptorPool)             \
+  X(vkCreateDescriptorSetLayout)        \
+  X(vkCreateDescriptorUpdateTemplateKHR) \
+  X(vkCreateEvent)                      \
+  X(vkCreateFence)                      \
+  X(vkCreateFramebuffer)                \
+  X(vkCreateGraphicsPipelines)          \
+  X(vkCreateImage)                      \
+  X(vkCreateImageView)                  \
+  X(vkCreatePipelineCache)              \
+  X(vkCreatePipelineLayout)             \
+  X(vkCreateQueryPool)                  \
+  X(vkCreateRenderPass)                 \
+  X(vkCreateSemaphore)                  \
+  X(vkCreateShaderModule)               \
+  X(vkCreateSwapchainKHR)               \
+  X(vkDestroyBuffer)                    \
+  X(vkDestroyBufferView)                \
+  X(vkDestroyCommandPool)               \
+  X(vkDestroyDescriptorPool)            \
+  X(vkDestroyDescriptorSetLayout)       \
+  X(vkDestroyDescriptorUpdateTemplateKHR) \
+  X(vkDestroyDevice)                    \
+  X(vkDestroyEvent)                     \
+  X(vkDestroyFence)                     \
+  X(vkDestroyFramebuffer)               \
+  X(vkDestroyImage)                     \
+  X(vkDestroyImageView)                 \
+  X(vkDestroyPipeline)                  \
+  X(vkDestroyPipelineCache)             \
+  X(vkDestroyPipelineLayout)            \
+  X(vkDestroyQueryPool)                 \
+  X(vkDestroyRenderPass)                \
+  X(vkDestroySampler)                   \
+  X(vkDestroySemaphore)                 \
+  X(vkDestroyShaderModule)              \
+  X(vkDestroySwapchainKHR)              \
+  X(vkDeviceWaitIdle)                   \
+  X(vkEndCommandBuffer)                 \
+  X(vkFlushMappedMemoryRanges)          \
+  X(vkFreeCommandBuffers)               \
+  X(vkFreeDescriptorSets)               \
+  X(vkFreeMemory)                       \
+  X(vkGetBufferMemoryRequirements)      \
+  X(vkGetDeviceMemoryCommitment)        \
+  X(vkGetDeviceQueue)                   \
+  X(vkGetEventStatus)                   \
+  X(vkGetFenceStatus)                   \
+  X(vkGetImageMemoryRequirements)       \
+  X(vkGetPipelineCacheData)             \
+  X(vkGetQueryPoolResults)              \
+  X(vkGetSemaphoreCounterValueKHR)      \
+  X(vkGetSwapchainImagesKHR)            \
+  X(vkInvalidateMappedMemoryRanges)     \
+  X(vkMapMemory)                        \
+  X(vkMergePipelineCaches)              \
+  X(vkQueuePresentKHR)                  \
+  X(vkQueueSubmit)                      \
+  X(vkQueueWaitIdle)                    \
+  X(vkResetCommandBuffer)               \
+  X(vkResetCommandPool)                 \
+  X(vkResetDescriptorPool)              \
+  X(vkResetEvent)                       \
+  X(vkResetFences)                      \
+  X(vkSetEvent)                         \
+  X(vkSignalSemaphoreKHR)               \
+  X(vkUnmapMemory)                      \
+  X(vkUpdateDescriptorSets)             \
+  X(vkUpdateDescriptorSetWithTemplateKHR) \
+  X(vkWaitForFences)                    \
+  X(vkWaitSemaphoresKHR)
+
+namespace vk {
+
+// Entry points resolved against one VkDevice. Calling through these skips
+// the loader's trampoline, which otherwise has to look up the device's
+// dispatch table on every call. Functions from extensions the device didn't
+// enable are left null.
+struct device_dispatch {
+#define VK_DISPATCH_MEMBER(name) PFN_##name name;
+  VK_DEVICE_FUNCTIONS(VK_DISPATCH_MEMBER)
+#undef VK_DISPATCH_MEMBER
+
+  void load(VkDevice device);
+};
+
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
 
 using namespace vk;
 
@@ -17,7 +18,7 @@ event::impl::impl(device device)
 
 event::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroyEvent(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyEvent(device_, handle_, nullptr);
   }
 }
 
@@ -28,7 +29,7 @@ event::event(device device)
   info.pNext = nullptr;
   info.flags = 0;
 
-  auto result = vkCreateEvent(impl_->device_, &info, nullptr, &impl_->handle_);
+  auto result = impl_->device_.dispatch().vkCreateEvent(impl_->device_, &info, nullptr, &impl_->handle_);
   assert(VK_SUCCESS == result && "Failed to create event.");
 }
 
@@ -37,17 +38,17 @@ event::operator VkEvent() {
 }
 
 void event::set() {
-  auto result = vkSetEvent(impl_->device_, impl_->handle_);
+  auto result = impl_->device_.dispatch().vkSetEvent(impl_->device_, impl_->handle_);
   assert(VK_SUCCESS == result && "Failed to set event.");
 }
 
 void event::reset() {
-  auto result = vkResetEvent(impl_->device_, impl_->handle_);
+  auto result = impl_->device_.dispatch().vkResetEvent(impl_->device_, impl_->handle_);
   assert(VK_SUCCESS == result && "Failed to reset event.");
 }
 
 signal_status event::status() const {
-  auto result = vkGetEventStatus(impl_->device_, impl_->handle_);
+  auto result = impl_->device_.dispatch().vkGetEventStatus(impl_->device_, impl_->handle_);
   switch (result) {
   case VK_EVENT_SET:
     return signal_status::signaled;
@@ -1,5 +1,9 @@
 #include <vk/vk.h>
 #include <cassert>
+#include <cstdlib>
+#include "dispatch.h"
+#include "trace.h"
+#include "utility.h"
 
 using namespace vk;
 
@@ -17,7 +21,7 @@ fence::impl::impl(device device)
 
 fence::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroyFence(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyFence(device_, handle_, nullptr);
   }
 }
 
@@ -28,7 +32,7 @@ fence::fence(device device, bool signaled)
   info.pNext = nullptr;
   info.flags = signaled ? VK_FENCE_CREATE_SIGNALED_BIT : 0;
 
-  auto result = vkCreateFence(impl_->device_, &info, nullptr, &impl_->handle_);
+  auto result = impl_->device_.dispatch().vkCreateFence(impl_->device_, &info, nullptr, &impl_->handle_);
   assert(VK_SUCCESS == result && "Failed to create fence.");
 }
 
@@ -41,13 +45,14 @@ void fence::reset(fence *fences, uint32_t fence_count) {
     return;
 
   VkDevice device = fences[0].impl_->device_;
-  std::vector<VkFence> fence_buf(fence_count);
+  auto &dispatch = fences[0].impl_->device_.dispatch();
+  scratch_buffer<VkFence> fence_buf(fence_count);
   for (auto i = 0u; i < fence_count; ++i) {
     fence_buf[i] = fences[i];
     assert(device == fences[i].impl_->device_ && "All fences for reset must share a device.");
   }
 
-  auto result = vkResetFences(device, fence_buf.size(), fence_buf.data());
+  auto result = dispatch.vkResetFences(device, fence_buf.size(), fence_buf.data());
   assert(VK_SUCCESS == result && "Failed to reset fences.");
 }
 
@@ -56,7 +61,7 @@ void fence::reset() {
 }
 
 signal_status fence::status() const {
-  auto result = vkGetFenceStatus(impl_->device_, impl_->handle_);
+  auto result = impl_->device_.dispatch().vkGetFenceStatus(impl_->device_, impl_->handle_);
   switch(result) {
   case VK_SUCCESS:
     return signal_status::signaled;
@@ -75,13 +80,15 @@ wait_result fence::wait(fence *fences, uint32_t fence_count, bool wait_all,
     return wait_result::SUCCESS;
 
   VkDevice device = fences[0].impl_->device_;
-  std::vector<VkFence> fence_buf(fence_count);
+  auto &dispatch = fences[0].impl_->device_.dispatch();
+  scratch_buffer<VkFence> fence_buf(fence_count);
   for (auto i = 0u; i < fence_count; ++i) {
     fence_buf[i] = fences[i];
     assert(device == fences[i].impl_->device_ && "All fences in a wait must share a device.");
   }
 
-  auto result = vkWaitForFences(device, fence_buf.size(), fence_buf.data(), wait_all, timeout);
+  VK_TRACE_SCOPE("vkWaitForFences");
+  auto result = dispatch.vkWaitForFences(device, fence_buf.size(), fence_buf.data(), wait_all, timeout);
   switch (result) {
   case VK_SUCCESS:
     return wait_result::SUCCESS;
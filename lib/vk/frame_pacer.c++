@@ -0,0 +1,105 @@
+#include <vk/vk.h>
+#include <cassert>
+
+using namespace vk;
+
+class frame_pacer::impl {
+public:
+  struct slot {
+    slot(vk::device device, command_pool pool);
+
+    semaphore acquired_;
+    fence in_flight_;
+    command_buffer commands_;
+  };
+
+  impl(device device, queue queue, uint32_t queue_family,
+       swapchain swapchain, pipeline_stage wait_stage);
+  ~impl();
+
+  void wait_idle();
+
+  device device_;
+  queue queue_;
+  swapchain swapchain_;
+  command_pool pool_;
+  pipeline_stage wait_stage_;
+  std::vector<slot> slots_;
+  // Indexed by swapchain image. A slot's fence only shows its submit has
+  // finished, not that the present waiting on the semaphore has, but an
+  // image is only acquired again once its last present is done with it.
+  std::vector<semaphore> rendered_;
+  uint32_t current_;
+  uint32_t image_index_;
+};
+
+frame_pacer::impl::slot::slot(vk::device device, command_pool pool)
+: acquired_{device}, in_flight_{device, true},
+  commands_{pool.allocate()} { }
+
+frame_pacer::impl::impl(device device, queue queue, uint32_t queue_family,
+                        swapchain swapchain, pipeline_stage wait_stage)
+: device_{device}, queue_{queue}, swapchain_{swapchain},
+  pool_{device, queue_family}, wait_stage_{wait_stage}, current_{0},
+  image_index_{0} {
+  for (auto i = 0u; i < swapchain_.size(); ++i)
+    rendered_.emplace_back(device_);
+}
+
+frame_pacer::impl::~impl() {
+  // Semaphores and command buffers can't be destroyed while the GPU may
+  // still be using them.
+  wait_idle();
+}
+
+void frame_pacer::impl::wait_idle() {
+  for (auto &slot: slots_) {
+    auto status = slot.in_flight_.wait(UINT64_MAX);
+    assert(wait_result::SUCCESS == status && "Failed waiting for frame.");
+  }
+}
+
+frame_pacer::frame_pacer(device device, queue queue, uint32_t queue_family,
+                         swapchain swapchain, uint32_t frames_in_flight,
+                         pipeline_stage wait_stage)
+: impl_{std::make_shared<impl>(device, queue, queue_family, swapchain, wait_stage)} {
+  assert(0 < frames_in_flight && "At least one frame must be in flight.");
+
+  // Fences start signaled so the first pass through each slot doesn't wait.
+  impl_->slots_.reserve(frames_in_flight);
+  for (auto i = 0u; i < frames_in_flight; ++i)
+    impl_->slots_.emplace_back(impl_->device_, impl_->pool_);
+}
+
+frame_pacer::frame frame_pacer::begin_frame() {
+  auto &slot = impl_->slots_[impl_->current_];
+
+  // Only blocks once the CPU is a full set of frames ahead of the GPU.
+  auto status = slot.in_flight_.wait(UINT64_MAX);
+  assert(wait_result::SUCCESS == status && "Failed waiting for frame.");
+
+  auto image = impl_->swapchain_.acquire_next_image(slot.acquired_);
+  impl_->image_index_ = image.index();
+  return frame{image, slot.commands_};
+}
+
+void frame_pacer::end_frame() {
+  auto &slot = impl_->slots_[impl_->current_];
+  auto &rendered = impl_->rendered_[impl_->image_index_];
+
+  slot.in_flight_.reset();
+  impl_->queue_.submit(slot.commands_, slot.acquired_, impl_->wait_stage_,
+                       rendered, slot.in_flight_);
+  impl_->queue_.present(impl_->swapchain_.get_image(impl_->image_index_),
+                        rendered);
+
+  impl_->current_ = (impl_->current_ + 1) % impl_->slots_.size();
+}
+
+void frame_pacer::wait_idle() {
+  impl_->wait_idle();
+}
+
+uint32_t frame_pacer::frames_in_flight() const {
+  return impl_->slots_.size();
+}
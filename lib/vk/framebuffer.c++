@@ -1,5 +1,6 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
 
 using namespace vk;
 
@@ -17,7 +18,7 @@ framebuffer::impl::impl(device device)
 
 framebuffer::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroyFramebuffer(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyFramebuffer(device_, handle_, nullptr);
   }
 }
 
@@ -40,6 +41,10 @@ framebuffer::framebuffer(device device, render_pass pass,
   info.height = height;
   info.layers = layers;
 
-  auto result = vkCreateFramebuffer(impl_->device_, &info, nullptr, &impl_->handle_);
+  auto result = impl_->device_.dispatch().vkCreateFramebuffer(impl_->device_, &info, nullptr, &impl_->handle_);
   assert(VK_SUCCESS == result && "Failed to create frame buffer.");
 }
+
+framebuffer::operator VkFramebuffer() {
+  return impl_->handle_;
+}
@@ -0,0 +1,260 @@
+#include <vk/vk.h>
+#include <cassert>
+#include <iomanip>
+#include <ostream>
+
+using namespace vk;
+
+namespace {
+
+const char *statistic_names[] = {
+  "input_assembly_vertices",
+  "input_assembly_primitives",
+  "vertex_shader_invocations",
+  "geometry_shader_invocations",
+  "geometry_shader_primitives",
+  "clipping_invocations",
+  "clipping_primitives",
+  "fragment_shader_invocations",
+  "tessellation_control_shader_patches",
+  "tessellation_evaluation_shader_invocations",
+  "compute_shader_invocations",
+};
+
+void write_string(std::ostream &out, const std::string &value) {
+  out << '"';
+  for (auto c: value) {
+    switch (c) {
+    case '"':  out << "\\\""; break;
+    case '\\': out << "\\\\"; break;
+    case '\n': out << "\\n"; break;
+    case '\t': out << "\\t"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20)
+        out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+            << static_cast<int>(c) << std::dec << std::setfill(' ');
+      else
+        out << c;
+    }
+  }
+  out << '"';
+}
+
+}
+
+class gpu_profiler::impl {
+public:
+  struct recorded_zone {
+    std::string name;
+    uint32_t depth;
+    // Index of the zone's statistics query in the slice, or ~0u.
+    uint32_t statistics;
+  };
+
+  // The queries of one frame in flight.
+  struct slice {
+    uint64_t frame;
+    std::vector<recorded_zone> zones;
+    uint32_t statistics_count;
+  };
+
+  impl(device device, uint32_t queue_family, uint32_t frame_count,
+       uint32_t max_zones, pipeline_statistic statistics);
+
+  void collect(uint32_t index);
+
+  device device_;
+  uint32_t max_zones_;
+  pipeline_statistic statistic_bits_;
+  // Two timestamps per zone.
+  query_pool timestamps_;
+  std::unique_ptr<query_pool> statistics_;
+  double period_;
+  uint64_t valid_mask_;
+
+  uint64_t frame_;
+  uint32_t current_;
+  std::vector<slice> slices_;
+  // Zones begun and not yet ended, innermost last. ~0u for untimed zones.
+  std::vector<uint32_t> open_;
+  std::vector<uint64_t> values_;
+
+  std::vector<zone_timing> zones_;
+  uint64_t dropped_;
+};
+
+gpu_profiler::impl::impl(device device, uint32_t queue_family,
+                         uint32_t frame_count, uint32_t max_zones,
+                         pipeline_statistic statistics)
+: device_{device}, max_zones_{max_zones}, statistic_bits_{statistics},
+  timestamps_{device, query_type::timestamp, 2 * frame_count * max_zones},
+  frame_{0}, current_{0}, slices_(frame_count, slice{0, {}, 0}), dropped_{0} {
+  assert(0 < frame_count && 0 < max_zones && "Profiler needs room for zones.");
+  auto &physical_device = device_.physical_device();
+  auto families = physical_device.queue_families();
+  assert(queue_family < families.end() - families.begin() && "Unknown queue family.");
+  auto valid_bits = families.begin()[queue_family].timestamp_valid_bits();
+  assert(0 != valid_bits && "Queue family doesn't support timestamps.");
+  valid_mask_ = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+  period_ = physical_device.limits().timestampPeriod;
+
+  if (pipeline_statistic::none != statistics)
+    statistics_ = std::make_unique<query_pool>(device_, query_type::pipeline_statistics,
+                                               frame_count * max_zones, statistics);
+
+  for (auto &slice: slices_)
+    slice.zones.reserve(max_zones);
+}
+
+void gpu_profiler::impl::collect(uint32_t index) {
+  auto &slice = slices_[index];
+  if (slice.zones.empty())
+    return;
+
+  auto zone_count = static_cast<uint32_t>(slice.zones.size());
+  auto value_count = statistics_ ? statistics_->value_count() : 0u;
+  values_.resize(2 * zone_count + slice.statistics_count * value_count);
+  auto timestamps = values_.data();
+  auto statistics = timestamps + 2 * zone_count;
+
+  auto ready = timestamps_.results(2 * index * max_zones_, 2 * zone_count, timestamps);
+  if (ready && 0 != slice.statistics_count)
+    ready = statistics_->results(index * max_zones_, slice.statistics_count, statistics);
+  if (!ready) {
+    ++dropped_;
+    return;
+  }
+
+  for (auto i = 0u; i < zone_count; ++i) {
+    auto &zone = slice.zones[i];
+    zone_timing timing;
+    timing.name = zone.name;
+    timing.frame = slice.frame;
+    timing.depth = zone.depth;
+    timing.begin = (timestamps[2 * i] & valid_mask_) * period_;
+    timing.end = (timestamps[2 * i + 1] & valid_mask_) * period_;
+    if (~0u != zone.statistics) {
+      auto first = statistics + zone.statistics * value_count;
+      timing.statistics.assign(first, first + value_count);
+    }
+    zones_.push_back(std::move(timing));
+  }
+}
+
+gpu_profiler::gpu_profiler(device device, uint32_t queue_family,
+                           uint32_t frame_count, uint32_t max_zones,
+                           pipeline_statistic statistics)
+: impl_{std::make_shared<impl>(std::move(device), queue_family, frame_count,
+                               max_zones, statistics)} { }
+
+void gpu_profiler::begin_frame(command_builder &builder) {
+  assert(impl_->open_.empty() && "Zones of the last frame were left open.");
+  auto index = static_cast<uint32_t>(impl_->frame_ % impl_->slices_.size());
+  impl_->collect(index);
+
+  auto &slice = impl_->slices_[index];
+  slice.frame = impl_->frame_++;
+  slice.zones.clear();
+  slice.statistics_count = 0;
+  impl_->current_ = index;
+
+  auto max_zones = impl_->max_zones_;
+  builder.reset_query_pool(impl_->timestamps_, 2 * index * max_zones, 2 * max_zones);
+  if (impl_->statistics_)
+    builder.reset_query_pool(*impl_->statistics_, index * max_zones, max_zones);
+}
+
+void gpu_profiler::begin_zone(command_builder &builder, const char *name) {
+  auto &slice = impl_->slices_[impl_->current_];
+  auto zone = static_cast<uint32_t>(slice.zones.size());
+  if (zone == impl_->max_zones_) {
+    impl_->open_.push_back(~0u);
+    return;
+  }
+
+  auto depth = static_cast<uint32_t>(impl_->open_.size());
+  auto statistics = ~0u;
+  if (impl_->statistics_ && 0 == depth)
+    statistics = slice.statistics_count++;
+  slice.zones.push_back(impl::recorded_zone{name, depth, statistics});
+  impl_->open_.push_back(zone);
+
+  auto base = impl_->current_ * impl_->max_zones_;
+  builder.write_timestamp(pipeline_stage::top_of_pipe, impl_->timestamps_,
+                          2 * (base + zone));
+  if (~0u != statistics)
+    builder.begin_query(*impl_->statistics_, base + statistics);
+}
+
+void gpu_profiler::end_zone(command_builder &builder) {
+  assert(!impl_->open_.empty() && "No zone to end.");
+  auto zone = impl_->open_.back();
+  impl_->open_.pop_back();
+  if (~0u == zone)
+    return;
+
+  auto &slice = impl_->slices_[impl_->current_];
+  auto base = impl_->current_ * impl_->max_zones_;
+  auto statistics = slice.zones[zone].statistics;
+  if (~0u != statistics)
+    builder.end_query(*impl_->statistics_, base + statistics);
+  builder.write_timestamp(pipeline_stage::bottom_of_pipe, impl_->timestamps_,
+                          2 * (base + zone) + 1);
+}
+
+const std::vector<gpu_profiler::zone_timing>& gpu_profiler::zones() const {
+  return impl_->zones_;
+}
+
+uint64_t gpu_profiler::dropped_frames() const {
+  return impl_->dropped_;
+}
+
+void gpu_profiler::clear() {
+  impl_->zones_.clear();
+  impl_->dropped_ = 0;
+}
+
+void gpu_profiler::write_trace(std::ostream &out) const {
+  // Complete events, timestamped in microseconds. Nesting follows from the
+  // times.
+  auto bits = static_cast<uint32_t>(impl_->statistic_bits_);
+  auto flags = out.flags();
+  auto precision = out.precision();
+  out << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+  auto first = true;
+  for (auto &zone: impl_->zones_) {
+    out << (first ? "\n" : ",\n") << "{\"name\":";
+    write_string(out, zone.name);
+    out << ",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+        << ",\"ts\":" << zone.begin / 1000.0
+        << ",\"dur\":" << (zone.end - zone.begin) / 1000.0
+        << ",\"args\":{\"frame\":" << zone.frame;
+    auto value = zone.statistics.begin();
+    for (auto bit = 0u; bit < 32 && zone.statistics.end() != value; ++bit) {
+      if (bits & (1u << bit))
+        out << ",\"" << statistic_names[bit] << "\":" << *value++;
+    }
+    out << "}}";
+    first = false;
+  }
+  out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+  out.flags(flags);
+  out.precision(precision);
+}
+
+gpu_zone::gpu_zone(gpu_profiler &profiler, command_builder &builder,
+                   const char *name)
+: profiler_{&profiler}, builder_{&builder} {
+  profiler_->begin_zone(*builder_, name);
+}
+
+gpu_zone::gpu_zone(gpu_zone &&other)
+: profiler_{other.profiler_}, builder_{other.builder_} {
+  other.profiler_ = nullptr;
+}
+
+gpu_zone::~gpu_zone() {
+  if (nullptr != profiler_)
+    profiler_->end_zone(*builder_);
+}
@@ -1,5 +1,6 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
 
 using namespace vk;
 
@@ -10,6 +11,7 @@ public:
 
   vk::device device_;
   std::unique_ptr<device_memory> memory_;
+  std::unique_ptr<memory_allocation> allocation_;
   VkImage handle_;
   VkMemoryRequirements memory_requirements_;
   bool owns_handle_;
@@ -21,16 +23,20 @@ image::impl::impl(vk::device device, VkImage handle, bool owns_handle)
 
 image::impl::~impl() {
   if (owns_handle_ && VK_NULL_HANDLE != handle_) {
-    vkDestroyImage(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyImage(device_, handle_, nullptr);
   }
 }
 
 image::image(vk::device device, VkImage handle, bool owns_handle)
 : impl_{std::make_shared<impl>(device, handle, owns_handle)} {
-  vkGetImageMemoryRequirements(impl_->device_, impl_->handle_, &impl_->memory_requirements_);
+  impl_->device_.dispatch().vkGetImageMemoryRequirements(impl_->device_, impl_->handle_, &impl_->memory_requirements_);
 }
 
 image::image(vk::device device, texel_format format, extent<3> extent, uint32_t mip_levels, uint32_t array_layers)
+: image(device, format, extent, mip_levels, array_layers, image_usage::sampled) {}
+
+image::image(vk::device device, texel_format format, extent<3> extent,
+             uint32_t mip_levels, uint32_t array_layers, image_usage usage)
 : impl_{std::make_shared<impl>(device, static_cast<VkImage>(VK_NULL_HANDLE),
                                true)} {
   VkImageCreateInfo info;
@@ -46,13 +52,16 @@ image::image(vk::device device, texel_format format, extent<3> extent, uint32_t
   info.arrayLayers = array_layers;
   info.samples = VK_SAMPLE_COUNT_1_BIT;
   info.tiling = VK_IMAGE_TILING_OPTIMAL;
-  info.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+  info.usage = static_cast<VkImageUsageFlags>(usage);
   info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
   info.queueFamilyIndexCount = 0;
   info.pQueueFamilyIndices = nullptr;
   info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-  auto result = vkCreateImage(impl_->device_, &info, nullptr, &impl_->handle_);
+  auto result = impl_->device_.dispatch().vkCreateImage(impl_->device_, &info, nullptr, &impl_->handle_);
   assert(VK_SUCCESS == result && "Failed to create image.");
+
+  impl_->device_.dispatch().vkGetImageMemoryRequirements(impl_->device_, impl_->handle_,
+                               &impl_->memory_requirements_);
 }
 
 image::operator VkImage() {
@@ -60,11 +69,22 @@ image::operator VkImage() {
 }
 
 void image::bind(device_memory memory, size_t offset, size_t /*size*/) {
-  auto result = vkBindImageMemory(impl_->device_, impl_->handle_, memory, offset);
+  auto result = impl_->device_.dispatch().vkBindImageMemory(impl_->device_, impl_->handle_, memory, offset);
   assert(VK_SUCCESS == result && "Failed to bind image memory.");
   impl_->memory_ = std::make_unique<vk::device_memory>(memory);
 }
 
+void image::bind(memory_allocation allocation) {
+  assert(allocation.size() >= impl_->memory_requirements_.size &&
+         "Allocation is too small for image.");
+  assert(0 == allocation.offset() % impl_->memory_requirements_.alignment &&
+         "Allocation does not satisfy image alignment.");
+  bind(allocation.memory(), allocation.offset(), allocation.size());
+
+  // Hold on to the allocation so the range is released with the image.
+  impl_->allocation_ = std::make_unique<memory_allocation>(std::move(allocation));
+}
+
 device & image::device() {
   return impl_->device_;
 }
@@ -81,3 +101,7 @@ size_t image::minimum_allocation_size() const {
   return impl_->memory_requirements_.size;
 }
 
+
+uint32_t image::memory_type_bits() const {
+  return impl_->memory_requirements_.memoryTypeBits;
+}
@@ -1,5 +1,6 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
 
 using namespace vk;
 
@@ -17,7 +18,7 @@ image_view::impl::impl(image image)
 
 image_view::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroyImageView(image_.device(), handle_, nullptr);
+    image_.device().dispatch().vkDestroyImageView(image_.device(), handle_, nullptr);
   }
 }
 
@@ -46,7 +47,7 @@ image_view::image_view(image image, type view_type, texel_format format,
   info.subresourceRange.baseArrayLayer = range.base_array_layer;
   info.subresourceRange.layerCount = range.layer_count;
 
-  auto result = vkCreateImageView(impl_->image_.device(), &info, nullptr, 
+  auto result = impl_->image_.device().dispatch().vkCreateImageView(impl_->image_.device(), &info, nullptr, 
                                   &impl_->handle_);
   assert(VK_SUCCESS == result && "Failed to create image view.");
 }
@@ -12,6 +12,8 @@ public:
 
   VkInstance handle_;
   VkDebugReportCallbackEXT debug_report_handle_;
+  // Resolved once, alongside creating the callback.
+  PFN_vkDestroyDebugReportCallbackEXT destroy_debug_report_;
   std::vector<physical_device> physical_devices_;
 };
 
@@ -37,19 +39,15 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debug_report_callback(VkDebugReportFlagsEX
 
         
 instance::impl::impl()
-: handle_{VK_NULL_HANDLE}, debug_report_handle_{VK_NULL_HANDLE} {}
+: handle_{VK_NULL_HANDLE}, debug_report_handle_{VK_NULL_HANDLE},
+  destroy_debug_report_{nullptr} {}
 
 instance::impl::~impl() {
   // TODO: This seems a bit suspect. This destroys validation when the instance
   // is destroyed. We probably want debug reporting to persist, but it requires
   // the instance handle to destroy.
-  if (debug_report_handle_) {
-    auto vkDestroyDebugReportCallbackEXT =
-      reinterpret_cast<PFN_vkDestroyDebugReportCallbackEXT>(
-        vkGetInstanceProcAddr(handle_, "vkDestroyDebugReportCallbackEXT"));
-    if (vkDestroyDebugReportCallbackEXT) {
-      vkDestroyDebugReportCallbackEXT(handle_, debug_report_handle_, nullptr);
-    }
+  if (debug_report_handle_ && destroy_debug_report_) {
+    destroy_debug_report_(handle_, debug_report_handle_, nullptr);
   }
 
   if (handle_) {
@@ -114,6 +112,9 @@ instance::instance()
   auto vkCreateDebugReportCallbackEXT =
     reinterpret_cast<PFN_vkCreateDebugReportCallbackEXT>(
         vkGetInstanceProcAddr(impl_->handle_, "vkCreateDebugReportCallbackEXT"));
+  impl_->destroy_debug_report_ =
+    reinterpret_cast<PFN_vkDestroyDebugReportCallbackEXT>(
+        vkGetInstanceProcAddr(impl_->handle_, "vkDestroyDebugReportCallbackEXT"));
   if (vkCreateDebugReportCallbackEXT) {
     VkDebugReportCallbackCreateInfoEXT debug_info;
     debug_info.sType = VK_STRUCTURE_TYPE_DEBUG_REPORT_CREATE_INFO_EXT;
@@ -0,0 +1,537 @@
+#include <vk/vk.h>
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+#include "trace.h"
+
+using namespace vk;
+
+namespace {
+
+// A two level segregated fit (TLSF) allocator over a range of offsets. It
+// hands out aligned sub-ranges of a single device memory block in constant
+// time and coalesces neighbouring free ranges when they are released.
+class range_allocator {
+public:
+  static const uint32_t npos = ~0u;
+
+  explicit range_allocator(VkDeviceSize size);
+
+  uint32_t allocate(VkDeviceSize size, VkDeviceSize alignment);
+  // Takes the whole range, which nothing may have been allocated from yet.
+  // allocate() would round its search past a range of exactly the size.
+  uint32_t allocate_all();
+  void free(uint32_t node);
+
+  VkDeviceSize offset(uint32_t node) const { return nodes_[node].offset; }
+  VkDeviceSize size(uint32_t node) const { return nodes_[node].size; }
+
+  VkDeviceSize free_bytes() const { return free_bytes_; }
+  size_t free_range_count() const { return free_range_count_; }
+  VkDeviceSize largest_free_range() const;
+
+private:
+  // Each first level class is split into 2^SL_BITS linear second level classes.
+  static const uint32_t SL_BITS = 5;
+  static const uint32_t SL_COUNT = 1u << SL_BITS;
+  static const uint32_t FL_COUNT = 64 - SL_BITS + 1;
+
+  struct node {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    uint32_t prev_phys;
+    uint32_t next_phys;
+    uint32_t prev_free;
+    uint32_t next_free;
+    bool free;
+  };
+
+  static uint32_t log2(VkDeviceSize size);
+  static void mapping(VkDeviceSize size, uint32_t &fl, uint32_t &sl);
+
+  uint32_t make_node(VkDeviceSize offset, VkDeviceSize size);
+  void release_node(uint32_t index);
+  void insert_free(uint32_t index);
+  void remove_free(uint32_t index);
+  void link_after(uint32_t index, uint32_t after);
+  void unlink(uint32_t index);
+
+  std::vector<node> nodes_;
+  std::vector<uint32_t> unused_nodes_;
+
+  uint64_t fl_bitmap_;
+  uint32_t sl_bitmap_[FL_COUNT];
+  uint32_t heads_[FL_COUNT][SL_COUNT];
+
+  VkDeviceSize free_bytes_;
+  size_t free_range_count_;
+};
+
+const uint32_t range_allocator::npos;
+
+range_allocator::range_allocator(VkDeviceSize size)
+: fl_bitmap_{0}, free_bytes_{0}, free_range_count_{0} {
+  std::fill(std::begin(sl_bitmap_), std::end(sl_bitmap_), 0u);
+  for (auto &row: heads_)
+    std::fill(std::begin(row), std::end(row), npos);
+
+  insert_free(make_node(0, size));
+}
+
+uint32_t range_allocator::log2(VkDeviceSize size) {
+  return 63 - __builtin_clzll(size);
+}
+
+void range_allocator::mapping(VkDeviceSize size, uint32_t &fl, uint32_t &sl) {
+  if (size < SL_COUNT) {
+    // Small ranges are all tracked linearly in the first class.
+    fl = 0;
+    sl = static_cast<uint32_t>(size);
+  } else {
+    auto bit = log2(size);
+    sl = static_cast<uint32_t>(size >> (bit - SL_BITS)) ^ SL_COUNT;
+    fl = bit - SL_BITS + 1;
+  }
+}
+
+uint32_t range_allocator::make_node(VkDeviceSize offset, VkDeviceSize size) {
+  uint32_t index;
+  if (unused_nodes_.empty()) {
+    index = static_cast<uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+  } else {
+    index = unused_nodes_.back();
+    unused_nodes_.pop_back();
+  }
+
+  auto &n = nodes_[index];
+  n.offset = offset;
+  n.size = size;
+  n.prev_phys = n.next_phys = npos;
+  n.prev_free = n.next_free = npos;
+  n.free = false;
+  return index;
+}
+
+void range_allocator::release_node(uint32_t index) {
+  unused_nodes_.push_back(index);
+}
+
+void range_allocator::insert_free(uint32_t index) {
+  auto &n = nodes_[index];
+  uint32_t fl, sl;
+  mapping(n.size, fl, sl);
+
+  n.free = true;
+  n.prev_free = npos;
+  n.next_free = heads_[fl][sl];
+  if (npos != n.next_free)
+    nodes_[n.next_free].prev_free = index;
+  heads_[fl][sl] = index;
+
+  fl_bitmap_ |= uint64_t{1} << fl;
+  sl_bitmap_[fl] |= 1u << sl;
+
+  free_bytes_ += n.size;
+  ++free_range_count_;
+}
+
+void range_allocator::remove_free(uint32_t index) {
+  auto &n = nodes_[index];
+  uint32_t fl, sl;
+  mapping(n.size, fl, sl);
+
+  if (npos != n.prev_free)
+    nodes_[n.prev_free].next_free = n.next_free;
+  else
+    heads_[fl][sl] = n.next_free;
+
+  if (npos != n.next_free)
+    nodes_[n.next_free].prev_free = n.prev_free;
+
+  if (npos == heads_[fl][sl]) {
+    sl_bitmap_[fl] &= ~(1u << sl);
+    if (0 == sl_bitmap_[fl])
+      fl_bitmap_ &= ~(uint64_t{1} << fl);
+  }
+
+  n.free = false;
+  n.prev_free = n.next_free = npos;
+
+  free_bytes_ -= n.size;
+  --free_range_count_;
+}
+
+void range_allocator::link_after(uint32_t index, uint32_t after) {
+  auto &n = nodes_[index];
+  n.prev_phys = after;
+  n.next_phys = nodes_[after].next_phys;
+  if (npos != n.next_phys)
+    nodes_[n.next_phys].prev_phys = index;
+  nodes_[after].next_phys = index;
+}
+
+void range_allocator::unlink(uint32_t index) {
+  auto &n = nodes_[index];
+  if (npos != n.prev_phys)
+    nodes_[n.prev_phys].next_phys = n.next_phys;
+  if (npos != n.next_phys)
+    nodes_[n.next_phys].prev_phys = n.prev_phys;
+  release_node(index);
+}
+
+uint32_t range_allocator::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+  assert(0 != size && "Cannot allocate an empty range.");
+  assert(0 == (alignment & (alignment - 1)) && "Alignment must be a power of two.");
+  if (0 == alignment)
+    alignment = 1;
+
+  // Search for a class where every range is guaranteed to fit the request
+  // even in the worst case alignment. Rounding up to the next class start
+  // means we never need to walk a free list.
+  VkDeviceSize search = size + alignment - 1;
+  if (search >= SL_COUNT)
+    search += (VkDeviceSize{1} << (log2(search) - SL_BITS)) - 1;
+
+  uint32_t fl, sl;
+  mapping(search, fl, sl);
+  if (fl >= FL_COUNT)
+    return npos;
+
+  auto sl_map = sl_bitmap_[fl] & (~0u << sl);
+  if (0 == sl_map) {
+    auto fl_map = (fl + 1 < 64) ? fl_bitmap_ & (~uint64_t{0} << (fl + 1)) : 0;
+    if (0 == fl_map)
+      return npos;
+
+    fl = __builtin_ctzll(fl_map);
+    sl_map = sl_bitmap_[fl];
+  }
+  sl = __builtin_ctz(sl_map);
+
+  auto index = heads_[fl][sl];
+  remove_free(index);
+
+  // Split off any padding needed to align the start of the range.
+  auto start = nodes_[index].offset;
+  auto aligned = (start + alignment - 1) & ~(alignment - 1);
+  if (aligned != start) {
+    auto padding = make_node(start, aligned - start);
+    auto prev = nodes_[index].prev_phys;
+    nodes_[padding].prev_phys = prev;
+    nodes_[padding].next_phys = index;
+    if (npos != prev)
+      nodes_[prev].next_phys = padding;
+    nodes_[index].prev_phys = padding;
+    nodes_[index].offset = aligned;
+    nodes_[index].size -= aligned - start;
+    insert_free(padding);
+  }
+
+  // Return whatever is left over at the end to the free lists.
+  if (nodes_[index].size > size) {
+    auto remainder = make_node(aligned + size, nodes_[index].size - size);
+    link_after(remainder, index);
+    nodes_[index].size = size;
+    insert_free(remainder);
+  }
+
+  return index;
+}
+
+uint32_t range_allocator::allocate_all() {
+  // The constructor's range is always the first node made.
+  assert(1 == free_range_count_ && nodes_[0].free &&
+         "Range has already been allocated from.");
+  remove_free(0);
+  return 0;
+}
+
+void range_allocator::free(uint32_t index) {
+  assert(!nodes_[index].free && "Range has already been freed.");
+
+  // Merge with the preceding range if it is free.
+  auto prev = nodes_[index].prev_phys;
+  if (npos != prev && nodes_[prev].free) {
+    remove_free(prev);
+    nodes_[prev].size += nodes_[index].size;
+    unlink(index);
+    index = prev;
+  }
+
+  // Merge with the following range if it is free.
+  auto next = nodes_[index].next_phys;
+  if (npos != next && nodes_[next].free) {
+    remove_free(next);
+    nodes_[index].size += nodes_[next].size;
+    unlink(next);
+  }
+
+  insert_free(index);
+}
+
+VkDeviceSize range_allocator::largest_free_range() const {
+  if (0 == fl_bitmap_)
+    return 0;
+
+  // The largest range lives in the highest populated class, but that class
+  // spans a range of sizes so we still have to look through its list.
+  auto fl = log2(fl_bitmap_);
+  auto sl = log2(sl_bitmap_[fl]);
+  VkDeviceSize largest = 0;
+  for (auto i = heads_[fl][sl]; npos != i; i = nodes_[i].next_free)
+    largest = std::max(largest, nodes_[i].size);
+  return largest;
+}
+
+}
+
+class memory_allocator::impl: public std::enable_shared_from_this<memory_allocator::impl> {
+public:
+  struct block {
+    block(vk::device device, const physical_device::memory_type &type,
+          size_t size, bool dedicated);
+
+    // Host visible blocks stay mapped for their whole lifetime.
+    device_memory memory_;
+    range_allocator ranges_;
+    size_t size_;
+    size_t allocation_count_;
+    bool dedicated_;
+  };
+
+  // Blocks are grouped by memory type, and optionally by whether they hold
+  // linear or optimally tiled resources.
+  struct pool {
+    std::vector<std::unique_ptr<block>> blocks_;
+  };
+
+  impl(vk::device device, size_t block_size);
+
+  memory_allocation allocate(const physical_device::memory_type &memory_type,
+                             size_t size, size_t alignment, bool linear);
+  void free(uint32_t pool_index, block *block, uint32_t node);
+  void accumulate(const pool &pool, memory_statistics &stats) const;
+
+  vk::device device_;
+  size_t block_size_;
+  VkDeviceSize granularity_;
+  std::vector<pool> pools_;
+  mutable std::mutex mutex_;
+};
+
+class memory_allocation::impl {
+public:
+  impl(std::shared_ptr<memory_allocator::impl> allocator, uint32_t pool_index,
+       memory_allocator::impl::block *block, uint32_t node,
+       size_t offset, size_t size);
+  ~impl();
+
+  std::shared_ptr<memory_allocator::impl> allocator_;
+  uint32_t pool_index_;
+  memory_allocator::impl::block *block_;
+  uint32_t node_;
+  size_t offset_;
+  size_t size_;
+};
+
+memory_allocator::impl::block::block(vk::device device,
+                                     const physical_device::memory_type &type,
+                                     size_t size, bool dedicated)
+: memory_{std::move(device), type, size, type.is_host_visible()}, ranges_{size}, size_{size},
+  allocation_count_{0}, dedicated_{dedicated} { }
+
+memory_allocator::impl::impl(vk::device device, size_t block_size)
+: device_{std::move(device)}, block_size_{block_size} {
+  auto &physical_device = device_.physical_device();
+  granularity_ = physical_device.limits().bufferImageGranularity;
+
+  auto type_count = std::distance(physical_device.memory_types().begin(),
+                                  physical_device.memory_types().end());
+  pools_.resize(2 * type_count);
+}
+
+memory_allocation memory_allocator::impl::allocate(
+    const physical_device::memory_type &memory_type,
+    size_t size, size_t alignment, bool linear) {
+  // Flushes and invalidates of non-coherent memory are widened to whole
+  // atoms, so no two allocations may share one.
+  if (memory_type.is_host_visible() && !memory_type.is_host_coherent()) {
+    size_t atom = device_.physical_device().limits().nonCoherentAtomSize;
+    alignment = std::max(alignment, atom);
+    size = (size + atom - 1) / atom * atom;
+  }
+
+  // If the device needs linear and optimal resources on separate pages we
+  // simply never mix them in a block.
+  uint32_t pool_index = 2 * memory_type.index;
+  if (!linear && granularity_ > 1)
+    pool_index += 1;
+
+  // Don't let a single block claim too much of a small heap.
+  auto block_size = std::min<size_t>(block_size_,
+                                     std::max<size_t>(memory_type.heap_size() / 8, 1));
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto &pool = pools_[pool_index];
+
+  block *target = nullptr;
+  uint32_t node = range_allocator::npos;
+  if (size > block_size / 2) {
+    // Large resources get a block to themselves rather than fragmenting the
+    // shared ones.
+    pool.blocks_.emplace_back(
+      std::make_unique<block>(device_, memory_type, size, true));
+    target = pool.blocks_.back().get();
+    node = target->ranges_.allocate_all();
+  } else {
+    for (auto &candidate: pool.blocks_) {
+      if (candidate->dedicated_)
+        continue;
+
+      node = candidate->ranges_.allocate(size, alignment);
+      if (range_allocator::npos != node) {
+        target = candidate.get();
+        break;
+      }
+    }
+
+    if (nullptr == target) {
+      pool.blocks_.emplace_back(
+        std::make_unique<block>(device_, memory_type, block_size, false));
+      target = pool.blocks_.back().get();
+      node = target->ranges_.allocate(size, alignment);
+    }
+  }
+
+  assert(range_allocator::npos != node && "Failed to sub-allocate device memory.");
+  ++target->allocation_count_;
+
+  auto offset = target->ranges_.offset(node);
+  return memory_allocation{std::make_shared<memory_allocation::impl>(
+    shared_from_this(), pool_index, target, node, offset, size)};
+}
+
+void memory_allocator::impl::free(uint32_t pool_index, block *target, uint32_t node) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  target->ranges_.free(node);
+  if (0 != --target->allocation_count_)
+    return;
+
+  // Keep a single empty shared block around per pool so that allocation
+  // patterns which bounce around zero don't hit the driver every time.
+  auto &blocks = pools_[pool_index].blocks_;
+  auto empty = std::count_if(blocks.begin(), blocks.end(),
+    [](const std::unique_ptr<block> &b) {
+      return !b->dedicated_ && 0 == b->allocation_count_;
+    });
+
+  if (target->dedicated_ || empty > 1) {
+    blocks.erase(std::find_if(blocks.begin(), blocks.end(),
+      [target](const std::unique_ptr<block> &b) { return b.get() == target; }));
+  }
+}
+
+void memory_allocator::impl::accumulate(const pool &pool,
+                                        memory_statistics &stats) const {
+  for (auto &b: pool.blocks_) {
+    stats.block_count += 1;
+    stats.allocation_count += b->allocation_count_;
+    stats.bytes_reserved += b->size_;
+    stats.bytes_allocated += b->size_ - b->ranges_.free_bytes();
+    stats.free_range_count += b->ranges_.free_range_count();
+    stats.largest_free_range = std::max<size_t>(stats.largest_free_range,
+                                                b->ranges_.largest_free_range());
+  }
+}
+
+memory_allocation::impl::impl(std::shared_ptr<memory_allocator::impl> allocator,
+                              uint32_t pool_index,
+                              memory_allocator::impl::block *block,
+                              uint32_t node, size_t offset, size_t size)
+: allocator_{std::move(allocator)}, pool_index_{pool_index}, block_{block},
+  node_{node}, offset_{offset}, size_{size} { }
+
+memory_allocation::impl::~impl() {
+  allocator_->free(pool_index_, block_, node_);
+}
+
+memory_allocation::memory_allocation(std::shared_ptr<impl> impl)
+: impl_{std::move(impl)} { }
+
+device_memory memory_allocation::memory() const {
+  return impl_->block_->memory_;
+}
+
+size_t memory_allocation::offset() const {
+  return impl_->offset_;
+}
+
+size_t memory_allocation::size() const {
+  return impl_->size_;
+}
+
+void* memory_allocation::mapped_data() const {
+  return static_cast<char*>(impl_->block_->memory_.mapped_data()) + impl_->offset_;
+}
+
+void memory_allocation::flush() {
+  impl_->block_->memory_.flush(impl_->offset_, impl_->size_);
+}
+
+void memory_allocation::invalidate() {
+  impl_->block_->memory_.invalidate(impl_->offset_, impl_->size_);
+}
+
+float memory_statistics::fragmentation() const {
+  auto free_bytes = bytes_reserved - bytes_allocated;
+  if (0 == free_bytes)
+    return 0.0f;
+
+  return 1.0f - static_cast<float>(largest_free_range) / free_bytes;
+}
+
+memory_allocator::memory_allocator(device device, size_t block_size)
+: impl_{std::make_shared<impl>(std::move(device), block_size)} { }
+
+memory_allocation memory_allocator::allocate(const physical_device::memory_type &memory_type,
+                                             size_t size, size_t alignment,
+                                             bool linear) {
+  VK_TRACE_SCOPE("memory_allocator::allocate");
+  return impl_->allocate(memory_type, size, alignment, linear);
+}
+
+memory_allocation memory_allocator::allocate(const physical_device::memory_type &memory_type,
+                                             const buffer &buffer) {
+  VK_TRACE_SCOPE("memory_allocator::allocate");
+  assert((buffer.memory_type_bits() & (1u << memory_type.index)) &&
+         "Memory type is not supported by buffer.");
+  return impl_->allocate(memory_type, buffer.minimum_allocation_size(),
+                         buffer.minimum_allocation_alignment(), true);
+}
+
+memory_allocation memory_allocator::allocate(const physical_device::memory_type &memory_type,
+                                             const image &image) {
+  VK_TRACE_SCOPE("memory_allocator::allocate");
+  assert((image.memory_type_bits() & (1u << memory_type.index)) &&
+         "Memory type is not supported by image.");
+  // All of our images use optimal tiling.
+  return impl_->allocate(memory_type, image.minimum_allocation_size(),
+                         image.minimum_allocation_alignment(), false);
+}
+
+memory_statistics memory_allocator::statistics() const {
+  memory_statistics stats{};
+  std::lock_guard<std::mutex> lock{impl_->mutex_};
+  for (auto &pool: impl_->pools_)
+    impl_->accumulate(pool, stats);
+  return stats;
+}
+
+memory_statistics memory_allocator::statistics(const physical_device::memory_type &memory_type) const {
+  memory_statistics stats{};
+  std::lock_guard<std::mutex> lock{impl_->mutex_};
+  impl_->accumulate(impl_->pools_[2 * memory_type.index], stats);
+  impl_->accumulate(impl_->pools_[2 * memory_type.index + 1], stats);
+  return stats;
+}
@@ -0,0 +1,51 @@
+#include <vk/vk.h>
+#include <cassert>
+#include "dispatch.h"
+
+using namespace vk;
+
+class parallel_recorder::impl {
+public:
+  impl(device device, uint32_t queue_family, thread_pool pool,
+       uint32_t frame_count);
+
+  thread_pool pool_;
+  command_recycler recycler_;
+  std::vector<VkCommandBuffer> secondaries_;
+};
+
+parallel_recorder::impl::impl(device device, uint32_t queue_family,
+                              thread_pool pool, uint32_t frame_count)
+: pool_{pool},
+  recycler_{device, queue_family, frame_count, pool.size(), 16,
+            command_buffer_level::secondary} { }
+
+parallel_recorder::parallel_recorder(device device, uint32_t queue_family,
+                                     thread_pool pool, uint32_t frame_count)
+: impl_{std::make_shared<impl>(device, queue_family, pool, frame_count)} { }
+
+void parallel_recorder::begin_frame(uint32_t frame) {
+  impl_->recycler_.begin_frame(frame);
+}
+
+void parallel_recorder::record(command_builder &primary, render_pass pass,
+                               uint32_t subpass, framebuffer framebuffer,
+                               uint32_t batch_count,
+                               const std::function<void(command_builder&, uint32_t)> &record_batch) {
+  auto &secondaries = impl_->secondaries_;
+  secondaries.resize(batch_count);
+
+  // Workers record into buffers from their own pools. The buffers stay alive
+  // in the recycler until the frame slot comes round again.
+  auto &recycler = impl_->recycler_;
+  impl_->pool_.parallel_for(batch_count, [&](uint32_t batch, uint32_t worker) {
+    auto buffer = recycler.allocate(worker);
+    buffer.begin(pass, subpass, framebuffer);
+    command_builder builder{buffer};
+    record_batch(builder, batch);
+    buffer.end();
+    secondaries[batch] = buffer;
+  });
+
+  primary.dispatch_->vkCmdExecuteCommands(primary.handle_, secondaries.size(), secondaries.data());
+}
@@ -4,8 +4,10 @@
 using namespace vk;
 
 queue_family::queue_family(physical_device &physical_device, uint32_t index,
-                           uint32_t count, VkQueueFlags flags)
-: index{index}, count{count}, flags_{flags}, physical_device_{physical_device}
+                           uint32_t count, VkQueueFlags flags,
+                           uint32_t timestamp_valid_bits)
+: index{index}, count{count}, flags_{flags},
+  timestamp_valid_bits_{timestamp_valid_bits}, physical_device_{physical_device}
 { 
 }
 
@@ -13,6 +15,18 @@ bool queue_family::is_graphics_queue() const {
   return flags_ & VK_QUEUE_GRAPHICS_BIT;
 }
 
+bool queue_family::is_compute_queue() const {
+  return flags_ & VK_QUEUE_COMPUTE_BIT;
+}
+
+bool queue_family::is_transfer_queue() const {
+  return flags_ & VK_QUEUE_TRANSFER_BIT;
+}
+
+uint32_t queue_family::timestamp_valid_bits() const {
+  return timestamp_valid_bits_;
+}
+
 bool queue_family::is_surface_supported(surface surface) const {
   VkBool32 supported = false;
   auto result = vkGetPhysicalDeviceSurfaceSupportKHR(physical_device_, index,
@@ -93,6 +107,10 @@ bool physical_device::memory_type::is_lazily_allocated() const {
   return type_.propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
 }
 
+size_t physical_device::memory_type::heap_size() const {
+  return heap_.size;
+}
+
 physical_device::physical_device(VkPhysicalDevice handle)
 : handle_{handle} {
   if (0 == handle)
@@ -112,7 +130,8 @@ physical_device::physical_device(VkPhysicalDevice handle)
   for (uint32_t i = 0; i < count; ++i) {
 
     queue_families_.emplace_back(queue_family{*this, i, properties[i].queueCount,
-                                              properties[i].queueFlags});
+                                              properties[i].queueFlags,
+                                              properties[i].timestampValidBits});
   }
 
   // Get the memory properties for the device.
@@ -136,6 +155,18 @@ physical_device::queue_family_range physical_device::queue_families() const {
   };
 }
 
+const VkPhysicalDeviceLimits& physical_device::limits() const {
+  return properties_.limits;
+}
+
+const VkPhysicalDeviceProperties& physical_device::properties() const {
+  return properties_;
+}
+
+const VkPhysicalDeviceFeatures& physical_device::features() const {
+  return features_;
+}
+
 std::vector<surface_format> physical_device::surface_formats(surface surface) const {
   std::vector<surface_format> surface_formats;
   
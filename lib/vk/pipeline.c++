@@ -1,5 +1,7 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
+#include "trace.h"
 #include "utility.h"
 
 using namespace vk;
@@ -18,13 +20,19 @@ pipeline::impl::impl(device device)
 
 pipeline::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroyPipeline(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyPipeline(device_, handle_, nullptr);
   }
 }
 
 pipeline_shader::pipeline_shader(shader_stage stage, shader_module module,
                                  const char *entry_point)
-: stage_{stage}, module_{module}, name_{entry_point} {}
+: pipeline_shader(stage, module, entry_point, specialization{}) {}
+
+pipeline_shader::pipeline_shader(shader_stage stage, shader_module module,
+                                 const char *entry_point,
+                                 specialization constants)
+: stage_{stage}, module_{module}, name_{entry_point},
+  constants_{std::move(constants)} {}
 
 const char *pipeline_shader::name() const {
   return name_;
@@ -38,6 +46,10 @@ pipeline_shader::shader_stage pipeline_shader::stage() const {
   return stage_;
 }
 
+const specialization& pipeline_shader::constants() const {
+  return constants_;
+}
+
 pipeline::pipeline(device device)
 : impl_{std::make_shared<impl>(device)} { }
 
@@ -46,9 +58,18 @@ pipeline::operator VkPipeline() {
 }
 
 compute_pipeline::compute_pipeline(device device, pipeline_layout layout,
-                                   shader_module module, const char* entry_point)
+                                   shader_module module, const char* entry_point,
+                                   pipeline_cache_ref cache)
+: compute_pipeline(device, layout, module, entry_point, specialization{},
+                   cache) {}
+
+compute_pipeline::compute_pipeline(device device, pipeline_layout layout,
+                                   shader_module module, const char* entry_point,
+                                   const specialization &constants,
+                                   pipeline_cache_ref cache)
 : pipeline{device} {
-  VkPipelineCache cache = VK_NULL_HANDLE;
+  VK_TRACE_SCOPE("vkCreateComputePipelines");
+  auto specialization_info = constants.info();
 
   VkPipelineShaderStageCreateInfo stage;
   stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -57,7 +78,7 @@ compute_pipeline::compute_pipeline(device device, pipeline_layout layout,
   stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
   stage.module = module;
   stage.pName   = entry_point;
-  stage.pSpecializationInfo = nullptr;
+  stage.pSpecializationInfo = constants.empty() ? nullptr : &specialization_info;
 
   VkPipelineCreateFlags flags = 0;
   VkComputePipelineCreateInfo info;
@@ -69,7 +90,7 @@ compute_pipeline::compute_pipeline(device device, pipeline_layout layout,
   info.basePipelineHandle = VK_NULL_HANDLE;
   info.basePipelineIndex = -1;
 
-  auto result = vkCreateComputePipelines(impl_->device_, cache, 1, &info,
+  auto result = impl_->device_.dispatch().vkCreateComputePipelines(impl_->device_, cache, 1, &info,
                                          nullptr, &impl_->handle_);
   assert(VK_SUCCESS == result &&
          "Failed to create compute pipeline.");
@@ -180,12 +201,15 @@ graphics_pipeline::graphics_pipeline(device device,
                                      const viewport_state &viewport_state,
                                      const rasterization_state &raster_state,
                                      pipeline_layout layout,
-                                     render_pass render_pass)
+                                     render_pass render_pass,
+                                     pipeline_cache_ref cache)
 : pipeline{device} {
-  VkPipelineCache cache = VK_NULL_HANDLE;
-
+  VK_TRACE_SCOPE("vkCreateGraphicsPipelines");
+  std::vector<VkSpecializationInfo> specialization_infos;
+  specialization_infos.reserve(stage_count);
   auto pipeline_stages = transform(stages, stages + stage_count, 
-      [](const pipeline_shader &stage) {
+      [&specialization_infos](const pipeline_shader &stage) {
+        specialization_infos.push_back(stage.constants().info());
         VkPipelineShaderStageCreateInfo info;
         info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         info.pNext = nullptr;
@@ -193,7 +217,8 @@ graphics_pipeline::graphics_pipeline(device device,
         info.stage = static_cast<VkShaderStageFlagBits>(stage.stage());
         info.module = stage.module();
         info.pName = stage.name();
-        info.pSpecializationInfo = nullptr;
+        info.pSpecializationInfo = stage.constants().empty() ?
+          nullptr : &specialization_infos.back();
         return info;
       });
 
@@ -259,7 +284,7 @@ graphics_pipeline::graphics_pipeline(device device,
   info.basePipelineHandle = VK_NULL_HANDLE;
   info.basePipelineIndex = -1;
 
-  auto result = vkCreateGraphicsPipelines(impl_->device_, cache, 1, &info,
+  auto result = impl_->device_.dispatch().vkCreateGraphicsPipelines(impl_->device_, cache, 1, &info,
                                           nullptr, &impl_->handle_);
   assert(VK_SUCCESS == result &&
          "Failed to create graphics pipeline.");
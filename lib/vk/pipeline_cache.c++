@@ -1,5 +1,6 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
 
 using namespace vk;
 
@@ -17,10 +18,13 @@ pipeline_cache::impl::impl(device device)
 
 pipeline_cache::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroyPipelineCache(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyPipelineCache(device_, handle_, nullptr);
   }
 }
 
+pipeline_cache::pipeline_cache(device device)
+: pipeline_cache(std::move(device), nullptr, 0) { }
+
 pipeline_cache::pipeline_cache(device device, const void* data, size_t size_in_bytes)
 : impl_{std::make_shared<impl>(std::move(device))} {
   VkPipelineCacheCreateInfo info;
@@ -30,7 +34,7 @@ pipeline_cache::pipeline_cache(device device, const void* data, size_t size_in_b
   info.initialDataSize = size_in_bytes;
   info.pInitialData = data;
 
-  auto result = vkCreatePipelineCache(impl_->device_, &info, nullptr, &impl_->handle_);
+  auto result = impl_->device_.dispatch().vkCreatePipelineCache(impl_->device_, &info, nullptr, &impl_->handle_);
   assert(VK_SUCCESS == result && "Failed to create pipeline cache.");
 }
 
@@ -40,17 +44,17 @@ pipeline_cache::operator VkPipelineCache() {
 
 size_t pipeline_cache::size() const {
   size_t size_in_bytes = 0;
-  auto result = vkGetPipelineCacheData(impl_->device_, impl_->handle_, &size_in_bytes, nullptr);
+  auto result = impl_->device_.dispatch().vkGetPipelineCacheData(impl_->device_, impl_->handle_, &size_in_bytes, nullptr);
   assert(VK_SUCCESS == result && "Failed to get pipeline cache size.");
   return size_in_bytes;
 }
 
 std::vector<uint8_t> pipeline_cache::data() const {
   size_t size_in_bytes = 0;
-  auto result = vkGetPipelineCacheData(impl_->device_, impl_->handle_, &size_in_bytes, nullptr);
+  auto result = impl_->device_.dispatch().vkGetPipelineCacheData(impl_->device_, impl_->handle_, &size_in_bytes, nullptr);
   if (VK_SUCCESS == result) {
     std::vector<uint8_t> buffer(size_in_bytes);
-    result = vkGetPipelineCacheData(impl_->device_, impl_->handle_,
+    result = impl_->device_.dispatch().vkGetPipelineCacheData(impl_->device_, impl_->handle_,
                                     &size_in_bytes, buffer.data());
     if (VK_SUCCESS == result)
       return buffer;
@@ -64,7 +68,7 @@ void pipeline_cache::merge(pipeline_cache *caches, size_t cache_count) {
   for (auto i = 0ul; i < cache_count; ++i)
     pipeline_caches[i] = caches[i];
 
-  auto result = vkMergePipelineCaches(impl_->device_, impl_->handle_,
+  auto result = impl_->device_.dispatch().vkMergePipelineCaches(impl_->device_, impl_->handle_,
                                       cache_count, pipeline_caches.data());
   assert(VK_SUCCESS == result && "Failed to merge pipeline caches.");
 }
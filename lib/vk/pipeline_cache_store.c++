@@ -0,0 +1,159 @@
+#include <vk/vk.h>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace vk;
+
+namespace {
+
+// The VkPipelineCacheHeaderVersionOne layout every cache blob starts with.
+struct cache_header {
+  uint32_t header_size;
+  uint32_t header_version;
+  uint32_t vendor_id;
+  uint32_t device_id;
+  uint8_t uuid[VK_UUID_SIZE];
+};
+
+// Drivers are meant to reject foreign data themselves, but not all of them
+// do, and a blob from another driver version can crash pipeline creation.
+bool is_compatible(const vk::physical_device &physical_dev,
+                   const void *data, size_t size) {
+  cache_header header;
+  if (size < sizeof(header))
+    return false;
+  std::memcpy(&header, data, sizeof(header));
+
+  auto &properties = physical_dev.properties();
+  return sizeof(header) <= header.header_size &&
+         VK_PIPELINE_CACHE_HEADER_VERSION_ONE == header.header_version &&
+         properties.vendorID == header.vendor_id &&
+         properties.deviceID == header.device_id &&
+         0 == std::memcmp(properties.pipelineCacheUUID, header.uuid, VK_UUID_SIZE);
+}
+
+// A read-only mapping of a whole file. Empty if the file can't be mapped.
+class mapped_file {
+public:
+  explicit mapped_file(const char *path);
+  ~mapped_file();
+
+  const void* data() const { return data_; }
+  size_t size() const { return size_; }
+private:
+  void *data_;
+  size_t size_;
+};
+
+mapped_file::mapped_file(const char *path)
+: data_{nullptr}, size_{0} {
+  auto fd = open(path, O_RDONLY);
+  if (-1 == fd)
+    return;
+
+  struct stat status;
+  if (0 == fstat(fd, &status) && 0 < status.st_size) {
+    auto data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED != data) {
+      data_ = data;
+      size_ = status.st_size;
+    }
+  }
+  close(fd);
+}
+
+mapped_file::~mapped_file() {
+  if (nullptr != data_)
+    munmap(data_, size_);
+}
+
+bool write_all(int fd, const uint8_t *data, size_t size) {
+  while (0 < size) {
+    auto written = write(fd, data, size);
+    if (0 > written)
+      return false;
+    data += written;
+    size -= written;
+  }
+  return true;
+}
+
+}
+
+class pipeline_cache_store::impl {
+public:
+  impl(device device, const char *path);
+
+  device device_;
+  std::string path_;
+  bool loaded_;
+  pipeline_cache cache_;
+  // Merging needs the destination cache externally synchronised, and save()
+  // shouldn't read it halfway through a merge.
+  std::mutex mutex_;
+private:
+  pipeline_cache load();
+};
+
+pipeline_cache_store::impl::impl(device device, const char *path)
+: device_{std::move(device)}, path_{path}, loaded_{false}, cache_{load()} { }
+
+pipeline_cache pipeline_cache_store::impl::load() {
+  // The driver copies the initial data, so the file only stays mapped while
+  // the cache is created.
+  mapped_file file{path_.c_str()};
+  if (nullptr == file.data() ||
+      !is_compatible(device_.physical_device(), file.data(), file.size()))
+    return pipeline_cache{device_};
+
+  loaded_ = true;
+  return pipeline_cache{device_, file.data(), file.size()};
+}
+
+pipeline_cache_store::pipeline_cache_store(device device, const char *path)
+: impl_{std::make_shared<impl>(std::move(device), path)} { }
+
+pipeline_cache pipeline_cache_store::cache() {
+  return impl_->cache_;
+}
+
+bool pipeline_cache_store::loaded() const {
+  return impl_->loaded_;
+}
+
+void pipeline_cache_store::merge(pipeline_cache *caches, size_t cache_count) {
+  std::lock_guard<std::mutex> lock{impl_->mutex_};
+  impl_->cache_.merge(caches, cache_count);
+}
+
+bool pipeline_cache_store::save() {
+  std::vector<uint8_t> data;
+  {
+    std::lock_guard<std::mutex> lock{impl_->mutex_};
+    data = impl_->cache_.data();
+  }
+
+  // Readers either see the old file or the complete new one, never a torn
+  // write. Every save gets a temporary file of its own, so threads and
+  // processes saving at once never write into each other's.
+  auto temp_path = impl_->path_ + ".tmp.XXXXXX";
+  auto fd = mkstemp(&temp_path[0]);
+  if (-1 == fd)
+    return false;
+
+  auto written = 0 == fchmod(fd, 0644) &&
+                 write_all(fd, data.data(), data.size()) && 0 == fsync(fd);
+  written = 0 == close(fd) && written;
+  if (!written || 0 != rename(temp_path.c_str(), impl_->path_.c_str())) {
+    unlink(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
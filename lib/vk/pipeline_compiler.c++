@@ -0,0 +1,124 @@
+#include <vk/vk.h>
+#include <cassert>
+#include <condition_variable>
+#include <mutex>
+
+using namespace vk;
+
+namespace {
+
+template<typename P, typename I>
+struct compile_batch {
+  std::vector<I> infos_;
+  std::vector<std::promise<P>> promises_;
+};
+
+compute_pipeline create(device device, const compute_pipeline_info &info,
+                        pipeline_cache &cache) {
+  return compute_pipeline{device, info.layout, info.module, info.entry_point,
+                          info.constants, cache};
+}
+
+graphics_pipeline create(device device, const graphics_pipeline_info &info,
+                         pipeline_cache &cache) {
+  return graphics_pipeline{device, info.stages, info.stage_count,
+                           *info.vertex_state, *info.assembly_state,
+                           *info.viewport_state, *info.raster_state,
+                           info.layout, info.render_pass, cache};
+}
+
+}
+
+class pipeline_compiler::impl {
+public:
+  impl(device device, thread_pool pool, pipeline_cache target);
+  ~impl();
+
+  template<typename P, typename I>
+  std::vector<std::future<P>> compile(const I *infos, size_t count);
+  void merge();
+  void wait_idle();
+
+  device device_;
+  thread_pool pool_;
+  pipeline_cache target_;
+  // Indexed by worker, so no two threads compile into the same cache.
+  std::vector<pipeline_cache> worker_caches_;
+
+  // Guards outstanding_ and every merge into target_.
+  std::mutex mutex_;
+  std::condition_variable idle_;
+  uint32_t outstanding_;
+};
+
+pipeline_compiler::impl::impl(device device, thread_pool pool,
+                              pipeline_cache target)
+: device_{std::move(device)}, pool_{std::move(pool)},
+  target_{std::move(target)}, outstanding_{0} {
+  for (auto i = 0u; i < pool_.size(); ++i)
+    worker_caches_.emplace_back(device_);
+}
+
+pipeline_compiler::impl::~impl() {
+  // Queued jobs point back at us.
+  wait_idle();
+}
+
+template<typename P, typename I>
+std::vector<std::future<P>> pipeline_compiler::impl::compile(const I *infos,
+                                                             size_t count) {
+  // Shared because the pool copies the job function.
+  auto batch = std::make_shared<compile_batch<P, I>>();
+  batch->infos_.assign(infos, infos + count);
+  batch->promises_.resize(count);
+
+  std::vector<std::future<P>> futures;
+  futures.reserve(count);
+  for (auto &promise: batch->promises_)
+    futures.push_back(promise.get_future());
+
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    ++outstanding_;
+  }
+
+  pool_.async_for(count, [this, batch](uint32_t index, uint32_t worker) {
+    batch->promises_[index].set_value(
+      create(device_, batch->infos_[index], worker_caches_[worker]));
+  }, [this]() { merge(); });
+  return futures;
+}
+
+void pipeline_compiler::impl::merge() {
+  // Worker caches keep what they had, so later merges repeat earlier
+  // entries. The driver drops the duplicates, and resetting a cache other
+  // workers may be compiling into isn't possible.
+  std::lock_guard<std::mutex> lock{mutex_};
+  target_.merge(worker_caches_.data(), worker_caches_.size());
+  --outstanding_;
+  idle_.notify_all();
+}
+
+void pipeline_compiler::impl::wait_idle() {
+  std::unique_lock<std::mutex> lock{mutex_};
+  idle_.wait(lock, [this]() { return 0 == outstanding_; });
+}
+
+pipeline_compiler::pipeline_compiler(device device, thread_pool pool,
+                                     pipeline_cache target)
+: impl_{std::make_shared<impl>(std::move(device), std::move(pool),
+                               std::move(target))} { }
+
+std::vector<std::future<compute_pipeline>>
+pipeline_compiler::compile(const compute_pipeline_info *infos, size_t count) {
+  return impl_->compile<compute_pipeline>(infos, count);
+}
+
+std::vector<std::future<graphics_pipeline>>
+pipeline_compiler::compile(const graphics_pipeline_info *infos, size_t count) {
+  return impl_->compile<graphics_pipeline>(infos, count);
+}
+
+void pipeline_compiler::wait_idle() {
+  impl_->wait_idle();
+}
@@ -1,5 +1,6 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
 
 using namespace vk;
 
@@ -17,14 +18,28 @@ pipeline_layout::impl::impl(device device)
 
 pipeline_layout::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroyPipelineLayout(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyPipelineLayout(device_, handle_, nullptr);
   }
 }
 
 pipeline_layout::pipeline_layout(device device, descriptor_set_layout* layouts,
                                  size_t layout_count)
+: pipeline_layout(device, layouts, layout_count, nullptr, 0) { }
+
+pipeline_layout::pipeline_layout(device device, descriptor_set_layout* layouts,
+                                 size_t layout_count,
+                                 const push_constant_range *ranges,
+                                 size_t range_count)
 : impl_{std::make_shared<impl>(device)}
 {
+  auto max_size = impl_->device_.physical_device().limits().maxPushConstantsSize;
+  for (auto i = 0ul; i < range_count; ++i) {
+    assert(0 == ranges[i].offset % 4 && 0 == ranges[i].size % 4 &&
+           "Push constant ranges must be 4 byte aligned.");
+    assert(ranges[i].offset + ranges[i].size <= max_size &&
+           "Push constant range exceeds maxPushConstantsSize.");
+  }
+
   // Populate a vector of layout handles.
   std::vector<VkDescriptorSetLayout> layout_handles(layout_count);
   for (auto i = 0ul; i < layout_count; ++i)
@@ -36,10 +51,10 @@ pipeline_layout::pipeline_layout(device device, descriptor_set_layout* layouts,
   info.flags = 0;
   info.setLayoutCount = layout_count;
   info.pSetLayouts = layout_handles.data();
-  info.pushConstantRangeCount = 0;
-  info.pPushConstantRanges = nullptr;
+  info.pushConstantRangeCount = range_count;
+  info.pPushConstantRanges = reinterpret_cast<const VkPushConstantRange*>(ranges);
 
-  auto result = vkCreatePipelineLayout(impl_->device_, &info, nullptr,
+  auto result = impl_->device_.dispatch().vkCreatePipelineLayout(impl_->device_, &info, nullptr,
                                        &impl_->handle_);
   assert(VK_SUCCESS == result &&
          "Failed to create pipeline layout.");
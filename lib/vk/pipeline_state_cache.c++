@@ -0,0 +1,222 @@
+#include <vk/vk.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+using namespace vk;
+
+namespace {
+
+template<typename T>
+uint64_t handle_word(T handle) {
+  // Non-dispatchable handles are pointers on 64 bit targets and integers on
+  // 32 bit ones.
+  uint64_t word = 0;
+  std::memcpy(&word, &handle, sizeof(handle));
+  return word;
+}
+
+uint64_t float_word(float value) {
+  // Both zeros describe the same state.
+  if (0.0f == value)
+    value = 0.0f;
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// Packs bytes eight to a word.
+void append_bytes(std::vector<uint64_t> &words, const void *data, size_t size) {
+  auto bytes = static_cast<const uint8_t*>(data);
+  for (auto i = 0ul; i < size; i += sizeof(uint64_t)) {
+    uint64_t word = 0;
+    std::memcpy(&word, bytes + i, std::min(sizeof(word), size - i));
+    words.push_back(word);
+  }
+}
+
+std::vector<uint64_t> stage_words(const pipeline_shader &stage) {
+  std::vector<uint64_t> words;
+  words.push_back(static_cast<uint64_t>(stage.stage()));
+  words.push_back(handle_word(static_cast<VkShaderModule>(stage.module())));
+
+  auto length = std::strlen(stage.name());
+  words.push_back(length);
+  append_bytes(words, stage.name(), length);
+
+  // Specialization constants, in their canonical ID order.
+  auto constants = stage.constants().info();
+  words.push_back(constants.mapEntryCount);
+  for (auto i = 0u; i < constants.mapEntryCount; ++i) {
+    auto &entry = constants.pMapEntries[i];
+    words.push_back(uint64_t(entry.constantID) << 32 | entry.size);
+  }
+  append_bytes(words, constants.pData, constants.dataSize);
+  return words;
+}
+
+}
+
+pipeline_state_key::pipeline_state_key(const pipeline_shader *stages,
+                                       uint32_t stage_count,
+                                       const vertex_input_state &,
+                                       const input_assembly_state &assembly_state,
+                                       const viewport_state &viewport_state,
+                                       const rasterization_state &raster_state,
+                                       pipeline_layout_ref layout,
+                                       render_pass_ref render_pass) {
+  std::vector<std::vector<uint64_t>> stage_keys;
+  for (auto i = 0u; i < stage_count; ++i)
+    stage_keys.push_back(stage_words(stages[i]));
+  std::sort(stage_keys.begin(), stage_keys.end());
+
+  words_.push_back(stage_count);
+  for (auto &stage_key: stage_keys)
+    words_.insert(words_.end(), stage_key.begin(), stage_key.end());
+
+  // vertex_input_state carries no state yet.
+
+  words_.push_back(static_cast<uint64_t>(assembly_state.topology));
+  words_.push_back(assembly_state.primitive_restart_enabled);
+
+  words_.push_back(viewport_state.count_);
+  for (auto i = 0u; i < viewport_state.count_; ++i) {
+    auto &viewport = viewport_state.viewports_[i];
+    for (auto value: {viewport.x, viewport.y, viewport.width, viewport.height,
+                      viewport.min_depth, viewport.max_depth})
+      words_.push_back(float_word(value));
+
+    auto &scissor = viewport_state.scissors_[i];
+    words_.push_back(static_cast<uint32_t>(scissor.offset.x));
+    words_.push_back(static_cast<uint32_t>(scissor.offset.y));
+    words_.push_back(scissor.extent.width);
+    words_.push_back(scissor.extent.height);
+  }
+
+  words_.push_back(raster_state.depth_clamp_enabled);
+  words_.push_back(raster_state.rasterizer_discard_enabled);
+  words_.push_back(raster_state.depth_bias_enabled);
+  words_.push_back(raster_state.cull_mode);
+
+  words_.push_back(handle_word(static_cast<VkPipelineLayout>(layout)));
+  words_.push_back(handle_word(static_cast<VkRenderPass>(render_pass)));
+
+  // FNV-1a over the words.
+  uint64_t hash = 14695981039346656037ull;
+  for (auto word: words_) {
+    hash ^= word;
+    hash *= 1099511628211ull;
+  }
+  hash_ = static_cast<size_t>(hash);
+}
+
+bool pipeline_state_key::operator==(const pipeline_state_key &other) const {
+  return hash_ == other.hash_ && words_ == other.words_;
+}
+
+bool pipeline_state_key::operator!=(const pipeline_state_key &other) const {
+  return !(*this == other);
+}
+
+class pipeline_state_cache::impl {
+public:
+  struct key_hash {
+    size_t operator()(const pipeline_state_key &key) const { return key.hash(); }
+  };
+
+  // Holds the objects a key names by handle, so their handles can't be
+  // reused by new objects while the entry exists.
+  struct entry {
+    std::shared_future<graphics_pipeline> pipeline;
+    std::vector<shader_module> modules;
+    pipeline_layout layout;
+    vk::render_pass render_pass;
+  };
+
+  impl(device device, std::unique_ptr<pipeline_cache> cache);
+
+  device device_;
+  std::unique_ptr<pipeline_cache> cache_;
+
+  // Entries go in as soon as a compile starts, so concurrent requests for
+  // the same state share it.
+  mutable std::mutex mutex_;
+  std::unordered_map<pipeline_state_key, entry, key_hash> pipelines_;
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+};
+
+pipeline_state_cache::impl::impl(device device,
+                                 std::unique_ptr<pipeline_cache> cache)
+: device_{std::move(device)}, cache_{std::move(cache)}, hits_{0}, misses_{0} { }
+
+pipeline_state_cache::pipeline_state_cache(device device)
+: impl_{std::make_shared<impl>(std::move(device), nullptr)} { }
+
+pipeline_state_cache::pipeline_state_cache(device device, pipeline_cache cache)
+: impl_{std::make_shared<impl>(std::move(device),
+                               std::make_unique<pipeline_cache>(std::move(cache)))} { }
+
+graphics_pipeline pipeline_state_cache::get(const pipeline_shader *stages,
+                                            uint32_t stage_count,
+                                            const vertex_input_state &vertex_state,
+                                            const input_assembly_state &assembly_state,
+                                            const viewport_state &viewport_state,
+                                            const rasterization_state &raster_state,
+                                            pipeline_layout layout,
+                                            vk::render_pass render_pass) {
+  pipeline_state_key key{stages, stage_count, vertex_state, assembly_state,
+                         viewport_state, raster_state, layout, render_pass};
+
+  std::shared_future<graphics_pipeline> existing;
+  std::promise<graphics_pipeline> promise;
+  {
+    std::lock_guard<std::mutex> lock{impl_->mutex_};
+    auto found = impl_->pipelines_.find(key);
+    if (impl_->pipelines_.end() != found) {
+      ++impl_->hits_;
+      existing = found->second.pipeline;
+    } else {
+      ++impl_->misses_;
+      impl::entry entry{promise.get_future().share(), {}, layout, render_pass};
+      for (auto i = 0u; i < stage_count; ++i)
+        entry.modules.push_back(stages[i].module());
+      impl_->pipelines_.emplace(std::move(key), std::move(entry));
+    }
+  }
+
+  // A hit may still be compiling on another thread. Wait for it outside the
+  // lock so other state isn't held up.
+  if (existing.valid())
+    return existing.get();
+
+  VkPipelineCache cache = VK_NULL_HANDLE;
+  if (impl_->cache_)
+    cache = *impl_->cache_;
+
+  graphics_pipeline pipeline{impl_->device_, stages, stage_count, vertex_state,
+                             assembly_state, viewport_state, raster_state,
+                             layout, render_pass, cache};
+  promise.set_value(pipeline);
+  return pipeline;
+}
+
+void pipeline_state_cache::clear() {
+  std::lock_guard<std::mutex> lock{impl_->mutex_};
+  impl_->pipelines_.clear();
+}
+
+size_t pipeline_state_cache::size() const {
+  std::lock_guard<std::mutex> lock{impl_->mutex_};
+  return impl_->pipelines_.size();
+}
+
+uint64_t pipeline_state_cache::hits() const {
+  return impl_->hits_;
+}
+
+uint64_t pipeline_state_cache::misses() const {
+  return impl_->misses_;
+}
@@ -1,29 +1,94 @@
 #include <vk/vk.h>
+#include <cassert>
+#include "dispatch.h"
 
 using namespace vk;
 
 class query_pool::impl {
 public:
-  impl(device device);
+  impl(device device, query_type type, uint32_t count, uint32_t value_count);
   ~impl();
 
   device device_;
   VkQueryPool handle_;
+  query_type type_;
+  uint32_t count_;
+  uint32_t value_count_;
 };
 
-query_pool::impl::impl(device device)
-: device_{std::move(device)}, handle_{VK_NULL_HANDLE} { }
+query_pool::impl::impl(device device, query_type type, uint32_t count,
+                       uint32_t value_count)
+: device_{std::move(device)}, handle_{VK_NULL_HANDLE}, type_{type},
+  count_{count}, value_count_{value_count} { }
 
 query_pool::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroyQueryPool(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyQueryPool(device_, handle_, nullptr);
   }
 }
 
-query_pool::query_pool(device device)
-: impl_{std::make_shared<impl>(std::move(device))} { }
+namespace {
+
+uint32_t bit_count(uint32_t bits) {
+  auto count = 0u;
+  for (; 0 != bits; bits &= bits - 1)
+    ++count;
+  return count;
+}
+
+}
+
+query_pool::query_pool(device device, query_type type, uint32_t count,
+                       pipeline_statistic statistics) {
+  auto statistic_bits = static_cast<uint32_t>(statistics);
+  auto is_statistics = query_type::pipeline_statistics == type;
+  assert(is_statistics == (0 != statistic_bits) &&
+         "Statistics go with pipeline statistics pools, and only with them.");
+  assert((!is_statistics || device.enabled_features().pipelineStatisticsQuery) &&
+         "Device doesn't support pipeline statistics queries.");
+
+  impl_ = std::make_shared<impl>(std::move(device), type, count,
+                                 is_statistics ? bit_count(statistic_bits) : 1);
+
+  VkQueryPoolCreateInfo info;
+  info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  info.pNext = nullptr;
+  info.flags = 0;
+  info.queryType = static_cast<VkQueryType>(type);
+  info.queryCount = count;
+  info.pipelineStatistics = statistic_bits;
+
+  auto result = impl_->device_.dispatch().vkCreateQueryPool(impl_->device_, &info, nullptr, &impl_->handle_);
+  assert(VK_SUCCESS == result && "Failed to create query pool.");
+}
+
+query_type query_pool::type() const {
+  return impl_->type_;
+}
+
+uint32_t query_pool::count() const {
+  return impl_->count_;
+}
+
+uint32_t query_pool::value_count() const {
+  return impl_->value_count_;
+}
+
+bool query_pool::results(uint32_t first, uint32_t count, uint64_t *values) const {
+  assert(first + count <= impl_->count_ && "Queries are outside the pool.");
+  auto stride = impl_->value_count_ * sizeof(uint64_t);
+
+  // Without the wait bit this never stalls on the GPU.
+  auto result = impl_->device_.dispatch().vkGetQueryPoolResults(
+      impl_->device_, impl_->handle_, first, count, count * stride, values,
+      stride, VK_QUERY_RESULT_64_BIT);
+  if (VK_NOT_READY == result)
+    return false;
+
+  assert(VK_SUCCESS == result && "Failed to get query pool results.");
+  return true;
+}
 
 query_pool::operator VkQueryPool() {
   return impl_->handle_;
 }
-
@@ -1,12 +1,17 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
+#include "trace.h"
+#include "utility.h"
 
 using namespace vk;
 
-queue::queue(VkQueue handle) :handle_{handle} {
+queue::queue(VkQueue handle, uint32_t family, const device_dispatch &dispatch)
+: handle_{handle}, family_{family}, dispatch_{&dispatch} {
 }
 
 void queue::present(swapchain_image image) {
+  VK_TRACE_SCOPE("vkQueuePresentKHR");
   VkSwapchainKHR swapchain = image.swapchain_;
   uint32_t index = image.index_;
 
@@ -20,12 +25,34 @@ void queue::present(swapchain_image image) {
   info.pImageIndices = &index;
   info.pResults = nullptr;
 
-  auto result = vkQueuePresentKHR(handle_, &info);
+  auto result = dispatch_->vkQueuePresentKHR(handle_, &info);
   assert(VK_SUCCESS == result && "Present failed.");
 }
 
+void queue::present(swapchain_image image, semaphore wait) {
+  VK_TRACE_SCOPE("vkQueuePresentKHR");
+  VkSwapchainKHR swapchain = image.swapchain_;
+  uint32_t index = image.index_;
+  VkSemaphore wait_semaphore = wait;
+
+  VkPresentInfoKHR info;
+  info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+  info.pNext = nullptr;
+  info.waitSemaphoreCount = 1;
+  info.pWaitSemaphores = &wait_semaphore;
+  info.swapchainCount = 1;
+  info.pSwapchains = &swapchain;
+  info.pImageIndices = &index;
+  info.pResults = nullptr;
+
+  auto result = dispatch_->vkQueuePresentKHR(handle_, &info);
+  assert((VK_SUCCESS == result || VK_SUBOPTIMAL_KHR == result) &&
+         "Present failed.");
+}
+
 void queue::submit(command_buffer* buffers, size_t buffer_count) {
-  std::vector<VkCommandBuffer> command_bufs(buffer_count);
+  VK_TRACE_SCOPE("vkQueueSubmit");
+  scratch_buffer<VkCommandBuffer> command_bufs(buffer_count);
   for (auto i = 0ul; i < buffer_count; ++i)
     command_bufs[i] = buffers[i];
 
@@ -39,11 +66,117 @@ void queue::submit(command_buffer* buffers, size_t buffer_count) {
   info.pCommandBuffers = command_bufs.data();
   info.signalSemaphoreCount = 0;
   info.pSignalSemaphores = nullptr;
-  auto result = vkQueueSubmit(handle_, 1, &info, VK_NULL_HANDLE);
+  auto result = dispatch_->vkQueueSubmit(handle_, 1, &info, VK_NULL_HANDLE);
+  assert(VK_SUCCESS == result && "Command buffer submission failed.");
+}
+
+void queue::submit(command_buffer buffer, semaphore wait,
+                   pipeline_stage wait_stage, semaphore signal, fence fence) {
+  VK_TRACE_SCOPE("vkQueueSubmit");
+  VkCommandBuffer command_buf = buffer;
+  VkSemaphore wait_semaphore = wait;
+  VkSemaphore signal_semaphore = signal;
+  VkPipelineStageFlags wait_stage_mask = static_cast<VkPipelineStageFlags>(wait_stage);
+
+  VkSubmitInfo info;
+  info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  info.pNext = nullptr;
+  info.waitSemaphoreCount = 1;
+  info.pWaitSemaphores = &wait_semaphore;
+  info.pWaitDstStageMask = &wait_stage_mask;
+  info.commandBufferCount = 1;
+  info.pCommandBuffers = &command_buf;
+  info.signalSemaphoreCount = 1;
+  info.pSignalSemaphores = &signal_semaphore;
+  auto result = dispatch_->vkQueueSubmit(handle_, 1, &info, fence);
+  assert(VK_SUCCESS == result && "Command buffer submission failed.");
+}
+
+void queue::submit(const submission &submission) {
+  if (submission.empty())
+    return;
+
+  submit_batches(submission, VK_NULL_HANDLE);
+}
+
+void queue::submit(const submission &submission, fence fence) {
+  submit_batches(submission, fence);
+}
+
+void queue::submit(const submission &submission, timeline_semaphore semaphore,
+                   uint64_t value) {
+  submit_batches(submission, VK_NULL_HANDLE, semaphore, value);
+}
+
+void queue::submit_batches(const submission &submission, VkFence fence,
+                           VkSemaphore timeline, uint64_t timeline_value) {
+  VK_TRACE_SCOPE("vkQueueSubmit");
+  // The arrays are only complete once building has finished, so the submit
+  // infos are pointed into them here rather than as batches are added.
+  auto &infos = submission.infos_;
+  auto &timeline_infos = submission.timeline_infos_;
+  infos.clear();
+  timeline_infos.clear();
+  // Submit infos point at these, so they mustn't move.
+  timeline_infos.reserve(submission.batches_.size() + 1);
+  for (auto &batch: submission.batches_) {
+    const void *next = nullptr;
+    if (batch.timeline) {
+      VkTimelineSemaphoreSubmitInfoKHR timeline_info;
+      timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+      timeline_info.pNext = nullptr;
+      timeline_info.waitSemaphoreValueCount = batch.wait_count;
+      timeline_info.pWaitSemaphoreValues = submission.wait_values_.data() + batch.first_wait;
+      timeline_info.signalSemaphoreValueCount = batch.signal_count;
+      timeline_info.pSignalSemaphoreValues = submission.signal_values_.data() + batch.first_signal;
+      timeline_infos.push_back(timeline_info);
+      next = &timeline_infos.back();
+    }
+
+    VkSubmitInfo info;
+    info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    info.pNext = next;
+    info.waitSemaphoreCount = batch.wait_count;
+    info.pWaitSemaphores = submission.waits_.data() + batch.first_wait;
+    info.pWaitDstStageMask = submission.wait_stages_.data() + batch.first_wait;
+    info.commandBufferCount = batch.buffer_count;
+    info.pCommandBuffers = submission.buffers_.data() + batch.first_buffer;
+    info.signalSemaphoreCount = batch.signal_count;
+    info.pSignalSemaphores = submission.signals_.data() + batch.first_signal;
+    infos.push_back(info);
+  }
+
+  // A trailing batch with nothing but the signal. Signals cover everything
+  // submitted ahead of them on the queue, so it completes after the rest.
+  if (VK_NULL_HANDLE != timeline) {
+    VkTimelineSemaphoreSubmitInfoKHR timeline_info;
+    timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+    timeline_info.pNext = nullptr;
+    timeline_info.waitSemaphoreValueCount = 0;
+    timeline_info.pWaitSemaphoreValues = nullptr;
+    timeline_info.signalSemaphoreValueCount = 1;
+    timeline_info.pSignalSemaphoreValues = &timeline_value;
+    timeline_infos.push_back(timeline_info);
+
+    VkSubmitInfo info;
+    info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    info.pNext = &timeline_infos.back();
+    info.waitSemaphoreCount = 0;
+    info.pWaitSemaphores = nullptr;
+    info.pWaitDstStageMask = nullptr;
+    info.commandBufferCount = 0;
+    info.pCommandBuffers = nullptr;
+    info.signalSemaphoreCount = 1;
+    info.pSignalSemaphores = &timeline;
+    infos.push_back(info);
+  }
+
+  auto result = dispatch_->vkQueueSubmit(handle_, infos.size(), infos.data(), fence);
   assert(VK_SUCCESS == result && "Command buffer submission failed.");
 }
 
 void queue::wait_idle() {
-  vkQueueWaitIdle(handle_);
+  VK_TRACE_SCOPE("vkQueueWaitIdle");
+  dispatch_->vkQueueWaitIdle(handle_);
 }
 
@@ -0,0 +1,62 @@
+#include <vk/vk.h>
+#include <algorithm>
+#include <cassert>
+
+using namespace vk;
+
+class queue_timeline::impl {
+public:
+  impl(device device, queue queue);
+
+  queue queue_;
+  timeline_semaphore semaphore_;
+  uint64_t submitted_;
+  // The latest value read back, which the counter can only have passed.
+  uint64_t completed_;
+};
+
+queue_timeline::impl::impl(device device, queue queue)
+: queue_{queue}, semaphore_{std::move(device), 0}, submitted_{0},
+  completed_{0} { }
+
+queue_timeline::queue_timeline(device device, queue queue)
+: impl_{std::make_shared<impl>(std::move(device), queue)} { }
+
+uint64_t queue_timeline::submit(const submission &submission) {
+  auto value = impl_->submitted_ + 1;
+  impl_->queue_.submit(submission, impl_->semaphore_, value);
+  impl_->submitted_ = value;
+  return value;
+}
+
+uint64_t queue_timeline::last_submitted() const {
+  return impl_->submitted_;
+}
+
+bool queue_timeline::is_complete(uint64_t value) const {
+  assert(value <= impl_->submitted_ && "Value hasn't been submitted.");
+  if (value <= impl_->completed_)
+    return true;
+
+  return value <= completed_value();
+}
+
+uint64_t queue_timeline::completed_value() const {
+  impl_->completed_ = impl_->semaphore_.current_value();
+  return impl_->completed_;
+}
+
+wait_result queue_timeline::wait(uint64_t value, uint64_t timeout) {
+  assert(value <= impl_->submitted_ && "Value hasn't been submitted.");
+  if (value <= impl_->completed_)
+    return wait_result::SUCCESS;
+
+  auto result = impl_->semaphore_.wait(value, timeout);
+  if (wait_result::SUCCESS == result)
+    impl_->completed_ = std::max(impl_->completed_, value);
+  return result;
+}
+
+timeline_semaphore& queue_timeline::semaphore() {
+  return impl_->semaphore_;
+}
@@ -0,0 +1,476 @@
+#include <vk/vk.h>
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+using namespace vk;
+
+namespace {
+
+using stage_flags = std::underlying_type_t<pipeline_stage>;
+
+struct resource_info {
+  bool imported;
+  bool image;
+  bool kept;
+  VkBuffer buffer_handle;
+  VkImage image_handle;
+  image_layout layout;
+  image_aspect aspect;
+  uint32_t mip_count;
+  uint32_t layer_count;
+
+  // Transient images only.
+  texel_format format;
+  vk::extent<3> extent;
+  image_usage usage;
+  std::unique_ptr<vk::image> transient;
+  size_t offset;
+  size_t size;
+  uint32_t first_level;
+  uint32_t last_level;
+  // Stages that touch the image in its last level, which whatever takes
+  // over its memory has to wait for.
+  stage_flags last_stages;
+};
+
+struct resource_access {
+  render_graph::resource_id resource;
+  pipeline_stage stage;
+  access_mask access;
+  image_layout layout;
+  bool write;
+};
+
+struct pass_info {
+  std::string name;
+  std::function<void(command_builder&)> record;
+  std::vector<resource_access> accesses;
+  bool culled;
+  uint32_t level;
+};
+
+size_t align_up(size_t offset, size_t alignment) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+bool lifetimes_overlap(const resource_info &a, const resource_info &b) {
+  return a.first_level <= b.last_level && b.first_level <= a.last_level;
+}
+
+bool memory_overlaps(const resource_info &a, const resource_info &b) {
+  return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+}
+
+}
+
+class render_graph::impl {
+public:
+  impl(device device);
+
+  resource_id add_resource(resource_info info);
+  void cull();
+  void assign_levels();
+  void place_transients();
+  void plan_barriers();
+  // Whether a later image reuses any of the transient's memory.
+  bool taken_over(resource_id transient) const;
+
+  device device_;
+  std::vector<resource_info> resources_;
+  std::vector<pass_info> passes_;
+
+  // Filled by compile().
+  std::vector<pass_id> order_;
+  std::vector<barrier_set> barriers_;
+  std::vector<resource_id> transients_;
+  std::unique_ptr<device_memory> memory_;
+  size_t memory_size_;
+};
+
+render_graph::impl::impl(device device)
+: device_{std::move(device)}, memory_size_{0} { }
+
+render_graph::resource_id render_graph::impl::add_resource(resource_info info) {
+  resources_.push_back(std::move(info));
+  return resources_.size() - 1;
+}
+
+void render_graph::impl::cull() {
+  // Walk back from the end, where only imported and kept resources are
+  // still wanted. A pass lives if it writes something wanted at that point.
+  std::vector<bool> wanted(resources_.size());
+  for (auto i = 0ul; i < resources_.size(); ++i)
+    wanted[i] = resources_[i].imported || resources_[i].kept;
+
+  for (auto pass = passes_.rbegin(); pass != passes_.rend(); ++pass) {
+    auto &accesses = pass->accesses;
+    pass->culled = std::none_of(accesses.begin(), accesses.end(),
+        [&](const resource_access &access) {
+          return access.write && wanted[access.resource];
+        });
+    if (pass->culled)
+      continue;
+
+    // Earlier contents of what this pass overwrites are dead, except for
+    // imported resources, whose contents may be used outside the graph.
+    for (auto &access: accesses) {
+      if (access.write && !resources_[access.resource].imported)
+        wanted[access.resource] = false;
+    }
+    for (auto &access: accesses) {
+      if (!access.write)
+        wanted[access.resource] = true;
+    }
+  }
+}
+
+void render_graph::impl::assign_levels() {
+  // A pass goes one level after the latest pass it conflicts with: one that
+  // writes what it reads, or reads or writes what it writes. Layout
+  // transitions count as writes.
+  struct usage {
+    int write_level;
+    int read_level;
+    image_layout layout;
+  };
+  std::vector<usage> usages;
+  for (auto &resource: resources_)
+    usages.push_back({-1, -1, resource.layout});
+
+  std::vector<bool> writes;
+  for (auto id = 0u; id < passes_.size(); ++id) {
+    auto &pass = passes_[id];
+    if (pass.culled)
+      continue;
+
+    auto level = 0;
+    writes.clear();
+    for (auto &access: pass.accesses) {
+      auto &usage = usages[access.resource];
+      auto transition = resources_[access.resource].image &&
+                        access.layout != usage.layout;
+      writes.push_back(access.write || transition);
+      if (writes.back())
+        level = std::max(level, std::max(usage.write_level, usage.read_level) + 1);
+      else
+        level = std::max(level, usage.write_level + 1);
+    }
+    pass.level = level;
+
+    for (auto i = 0ul; i < pass.accesses.size(); ++i) {
+      auto &usage = usages[pass.accesses[i].resource];
+      if (!writes[i])
+        usage.read_level = std::max(usage.read_level, level);
+    }
+    for (auto i = 0ul; i < pass.accesses.size(); ++i) {
+      auto &usage = usages[pass.accesses[i].resource];
+      if (writes[i]) {
+        usage.write_level = level;
+        usage.read_level = -1;
+        usage.layout = pass.accesses[i].layout;
+      }
+    }
+    order_.push_back(id);
+  }
+
+  // Declaration order is kept within a level.
+  std::stable_sort(order_.begin(), order_.end(), [&](pass_id a, pass_id b) {
+    return passes_[a].level < passes_[b].level;
+  });
+}
+
+void render_graph::impl::place_transients() {
+  for (auto id = 0u; id < resources_.size(); ++id) {
+    auto &resource = resources_[id];
+    resource.first_level = UINT32_MAX;
+    resource.last_level = 0;
+    resource.last_stages = 0;
+  }
+
+  for (auto id: order_) {
+    auto &pass = passes_[id];
+    for (auto &access: pass.accesses) {
+      auto &resource = resources_[access.resource];
+      auto stage = static_cast<stage_flags>(access.stage);
+      if (pass.level > resource.last_level || UINT32_MAX == resource.first_level)
+        resource.last_stages = 0;
+      resource.first_level = std::min(resource.first_level, pass.level);
+      resource.last_level = std::max(resource.last_level, pass.level);
+      resource.last_stages |= stage;
+    }
+  }
+
+  // Images nothing live uses are never created.
+  uint32_t type_bits = ~0u;
+  for (auto id = 0u; id < resources_.size(); ++id) {
+    auto &resource = resources_[id];
+    if (resource.imported || UINT32_MAX == resource.first_level)
+      continue;
+
+    resource.transient = std::make_unique<vk::image>(
+      device_, resource.format, resource.extent, resource.mip_count,
+      resource.layer_count, resource.usage);
+    resource.size = resource.transient->minimum_allocation_size();
+    type_bits &= resource.transient->memory_type_bits();
+    transients_.push_back(id);
+  }
+  if (transients_.empty())
+    return;
+
+  // Largest first, each at the lowest offset clear of every image it is
+  // alive alongside.
+  auto placement_order = transients_;
+  std::stable_sort(placement_order.begin(), placement_order.end(),
+                   [&](resource_id a, resource_id b) {
+                     return resources_[a].size > resources_[b].size;
+                   });
+
+  std::vector<resource_id> placed;
+  std::vector<resource_id> conflicts;
+  for (auto id: placement_order) {
+    auto &resource = resources_[id];
+    auto alignment = resource.transient->minimum_allocation_alignment();
+
+    conflicts.clear();
+    for (auto other: placed) {
+      if (lifetimes_overlap(resource, resources_[other]))
+        conflicts.push_back(other);
+    }
+    std::sort(conflicts.begin(), conflicts.end(), [&](resource_id a, resource_id b) {
+      return resources_[a].offset < resources_[b].offset;
+    });
+
+    size_t offset = 0;
+    for (auto other: conflicts) {
+      auto &conflict = resources_[other];
+      if (offset + resource.size <= conflict.offset)
+        break;
+      offset = std::max(offset, align_up(conflict.offset + conflict.size, alignment));
+    }
+    resource.offset = offset;
+    memory_size_ = std::max(memory_size_, offset + resource.size);
+    placed.push_back(id);
+  }
+
+  const physical_device::memory_type *memory_type = nullptr;
+  for (auto &candidate: device_.physical_device().memory_types()) {
+    if (0 == (type_bits & (1u << candidate.index)))
+      continue;
+    if (nullptr == memory_type || (!memory_type->is_device_local() &&
+                                   candidate.is_device_local()))
+      memory_type = &candidate;
+  }
+  assert(nullptr != memory_type &&
+         "No memory type can hold every transient image.");
+
+  memory_ = std::make_unique<device_memory>(device_, *memory_type, memory_size_);
+  for (auto id: transients_) {
+    auto &resource = resources_[id];
+    resource.transient->bind(*memory_, resource.offset, resource.size);
+    resource.image_handle = *resource.transient;
+  }
+}
+
+bool render_graph::impl::taken_over(resource_id transient) const {
+  auto &resource = resources_[transient];
+  return std::any_of(transients_.begin(), transients_.end(), [&](resource_id other) {
+    auto &next = resources_[other];
+    return next.first_level > resource.last_level && memory_overlaps(resource, next);
+  });
+}
+
+void render_graph::impl::plan_barriers() {
+  resource_tracker tracker;
+  for (auto &resource: resources_) {
+    if (resource.imported && resource.image)
+      tracker.track(resource.image_handle, resource.layout, resource.aspect,
+                    resource.mip_count, resource.layer_count);
+  }
+
+  auto position = order_.begin();
+  while (order_.end() != position) {
+    auto level = passes_[*position].level;
+
+    // An image taking over memory waits for the last stages of the images
+    // that had it before. The first to use some memory waits for whatever
+    // held it at the end of the graph, since the previous recording may
+    // still be using it.
+    for (auto id: transients_) {
+      auto &resource = resources_[id];
+      if (level != resource.first_level)
+        continue;
+
+      stage_flags ready = 0;
+      for (auto other: transients_) {
+        auto &previous = resources_[other];
+        if (previous.last_level < level && memory_overlaps(resource, previous))
+          ready |= previous.last_stages;
+      }
+      if (0 == ready) {
+        for (auto other: transients_) {
+          auto &last = resources_[other];
+          if (memory_overlaps(resource, last) && !taken_over(other))
+            ready |= last.last_stages;
+        }
+      }
+      tracker.track(resource.image_handle, image_layout::undefined,
+                    resource.aspect, resource.mip_count, resource.layer_count,
+                    0 == ready ? pipeline_stage::top_of_pipe
+                               : static_cast<pipeline_stage>(ready));
+    }
+
+    for (; order_.end() != position && level == passes_[*position].level; ++position) {
+      for (auto &access: passes_[*position].accesses) {
+        auto &resource = resources_[access.resource];
+        if (resource.image)
+          tracker.use(resource.image_handle,
+                      subresource_range{resource.aspect, 0, resource.mip_count,
+                                        0, resource.layer_count},
+                      access.stage, access.access, access.layout);
+        else
+          tracker.use(resource.buffer_handle, access.stage, access.access);
+      }
+    }
+    barriers_.push_back(tracker.take());
+  }
+}
+
+render_graph::render_graph(device device)
+: impl_{std::make_shared<impl>(std::move(device))} { }
+
+render_graph::resource_id render_graph::import_buffer(buffer_ref buffer) {
+  resource_info info{};
+  info.imported = true;
+  info.buffer_handle = buffer;
+  info.layout = image_layout::undefined;
+  return impl_->add_resource(std::move(info));
+}
+
+render_graph::resource_id render_graph::import_image(image_ref image,
+                                                     image_layout layout,
+                                                     image_aspect aspect,
+                                                     uint32_t mip_count,
+                                                     uint32_t layer_count) {
+  resource_info info{};
+  info.imported = true;
+  info.image = true;
+  info.image_handle = image;
+  info.layout = layout;
+  info.aspect = aspect;
+  info.mip_count = mip_count;
+  info.layer_count = layer_count;
+  return impl_->add_resource(std::move(info));
+}
+
+render_graph::resource_id render_graph::create_image(texel_format format,
+                                                     extent<3> extent,
+                                                     image_usage usage,
+                                                     image_aspect aspect,
+                                                     uint32_t mip_count,
+                                                     uint32_t layer_count) {
+  resource_info info{};
+  info.image = true;
+  info.image_handle = VK_NULL_HANDLE;
+  info.layout = image_layout::undefined;
+  info.aspect = aspect;
+  info.mip_count = mip_count;
+  info.layer_count = layer_count;
+  info.format = format;
+  info.extent = extent;
+  info.usage = usage;
+  return impl_->add_resource(std::move(info));
+}
+
+render_graph::pass_id render_graph::add_pass(const char *name,
+                                             std::function<void(command_builder&)> record) {
+  impl_->passes_.push_back(pass_info{name, std::move(record), {}, false, 0});
+  return impl_->passes_.size() - 1;
+}
+
+void render_graph::read(pass_id pass, resource_id resource, pipeline_stage stage,
+                        access_mask access, image_layout layout) {
+  impl_->passes_[pass].accesses.push_back({resource, stage, access, layout, false});
+}
+
+void render_graph::write(pass_id pass, resource_id resource, pipeline_stage stage,
+                         access_mask access, image_layout layout) {
+  impl_->passes_[pass].accesses.push_back({resource, stage, access, layout, true});
+}
+
+void render_graph::keep(resource_id resource) {
+  impl_->resources_[resource].kept = true;
+}
+
+void render_graph::compile() {
+  assert(impl_->order_.empty() && "Render graph is already compiled.");
+  impl_->cull();
+  impl_->assign_levels();
+  impl_->place_transients();
+  impl_->plan_barriers();
+}
+
+void render_graph::record(command_builder &builder) {
+  auto level = 0u;
+  for (auto id: impl_->order_) {
+    auto &pass = impl_->passes_[id];
+    // Every level has at least one pass, so levels are reached in order.
+    if (pass.level == level)
+      impl_->barriers_[level++].record(builder);
+    pass.record(builder);
+  }
+}
+
+void render_graph::record(command_builder &builder, gpu_profiler &profiler) {
+  auto level = 0u;
+  for (auto id: impl_->order_) {
+    auto &pass = impl_->passes_[id];
+    if (pass.level == level)
+      impl_->barriers_[level++].record(builder);
+    auto zone = builder.profile(profiler, pass.name.c_str());
+    pass.record(builder);
+  }
+}
+
+std::vector<command_buffer> render_graph::record(thread_pool &pool,
+                                                 command_recycler &recycler) {
+  auto &order = impl_->order_;
+  std::vector<std::unique_ptr<command_buffer>> recorded(order.size());
+
+  // The first pass of each level carries the level's barrier. Submitted in
+  // order, it still sits between the levels on the queue.
+  pool.parallel_for(order.size(), [&](uint32_t index, uint32_t worker) {
+    auto &pass = impl_->passes_[order[index]];
+    auto first = 0 == index || impl_->passes_[order[index - 1]].level != pass.level;
+
+    auto buffer = recycler.allocate(worker);
+    buffer.record([&](command_builder &builder) {
+      if (first)
+        impl_->barriers_[pass.level].record(builder);
+      pass.record(builder);
+    });
+    recorded[index] = std::make_unique<command_buffer>(buffer);
+  });
+
+  std::vector<command_buffer> buffers;
+  buffers.reserve(recorded.size());
+  for (auto &buffer: recorded)
+    buffers.push_back(*buffer);
+  return buffers;
+}
+
+VkImage render_graph::image(resource_id resource) const {
+  return impl_->resources_[resource].image_handle;
+}
+
+bool render_graph::culled(pass_id pass) const {
+  return impl_->passes_[pass].culled;
+}
+
+uint32_t render_graph::level_count() const {
+  return impl_->barriers_.size();
+}
+
+size_t render_graph::transient_memory_size() const {
+  return impl_->memory_size_;
+}
@@ -1,5 +1,6 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
 #include "utility.h"
 
 using namespace vk;
@@ -18,7 +19,7 @@ render_pass::impl::impl(device device)
 
 render_pass::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroyRenderPass(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyRenderPass(device_, handle_, nullptr);
   }
 }
 
@@ -86,7 +87,7 @@ render_pass::render_pass(device device,
   info.dependencyCount = dependency_count;
   info.pDependencies = reinterpret_cast<const VkSubpassDependency*>(dependencies);
 
-  auto result = vkCreateRenderPass(impl_->device_, &info, nullptr, 
+  auto result = impl_->device_.dispatch().vkCreateRenderPass(impl_->device_, &info, nullptr, 
                                    &impl_->handle_);
   assert(VK_SUCCESS == result && "Failed to create render pass.");
 }
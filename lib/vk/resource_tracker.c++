@@ -0,0 +1,343 @@
+#include <vk/vk.h>
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+
+using namespace vk;
+
+namespace {
+
+using stage_flags = std::underlying_type_t<pipeline_stage>;
+using access_flags = std::underlying_type_t<access_mask>;
+
+const access_flags write_accesses = VK_ACCESS_SHADER_WRITE_BIT |
+                                    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                    VK_ACCESS_TRANSFER_WRITE_BIT |
+                                    VK_ACCESS_HOST_WRITE_BIT |
+                                    VK_ACCESS_MEMORY_WRITE_BIT;
+
+// What has happened to a buffer or image subresource since its last write.
+struct access_state {
+  image_layout layout;
+  stage_flags write_stages;
+  access_flags write_access;
+  // Reads since the write, which a following write has to wait for.
+  stage_flags read_stages;
+  // Where a barrier has already made the write visible.
+  stage_flags visible_stages;
+  access_flags visible_access;
+};
+
+access_state initial_state(image_layout layout, stage_flags ready_stages) {
+  return access_state{layout, ready_stages, 0, 0, 0, 0};
+}
+
+// The source half of the barrier an access needs.
+struct dependency {
+  bool needed;
+  stage_flags src_stages;
+  access_flags src_access;
+  image_layout old_layout;
+};
+
+// Works out what an access has to wait for, and moves the state past it.
+dependency advance(access_state &state, stage_flags stage, access_flags access,
+                   image_layout layout) {
+  dependency dep{false, 0, 0, state.layout};
+  auto transition = layout != state.layout;
+
+  if (transition || 0 != (access & write_accesses)) {
+    // Write after write or read. A layout transition is a write too, and
+    // always needs a barrier to happen in.
+    dep.src_stages = state.write_stages | state.read_stages;
+    dep.src_access = state.write_access;
+    dep.needed = transition || 0 != dep.src_stages;
+
+    state.layout = layout;
+    state.write_stages = stage;
+    state.write_access = access & write_accesses;
+    state.read_stages = 0;
+    // A new write isn't visible anywhere yet, even to its own stage. Only a
+    // transition that just reads leaves its barrier's destination visible.
+    if (0 == state.write_access) {
+      state.visible_stages = stage;
+      state.visible_access = access;
+    } else {
+      state.visible_stages = 0;
+      state.visible_access = 0;
+    }
+  } else {
+    // Reads after reads need nothing, and neither do reads the last write
+    // was already made visible to.
+    auto visible = stage == (stage & state.visible_stages) &&
+                   access == (access & state.visible_access);
+    if (0 != state.write_stages && !visible) {
+      dep.needed = true;
+      dep.src_stages = state.write_stages;
+      dep.src_access = state.write_access;
+      state.visible_stages |= stage;
+      state.visible_access |= access;
+    }
+    state.read_stages |= stage;
+  }
+
+  if (dep.needed && 0 == dep.src_stages)
+    dep.src_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+  return dep;
+}
+
+struct image_state {
+  image_aspect aspect;
+  uint32_t mip_count;
+  uint32_t layer_count;
+  // Indexed by mip level * layer count + array layer.
+  std::vector<access_state> subresources;
+};
+
+// Everything one barrier has to cover.
+struct barrier_batch {
+  barrier_batch() : src_stages{0}, dst_stages{0}, src_access{0}, dst_access{0} {}
+
+  bool empty() const { return 0 == dst_stages; }
+  void clear() {
+    src_stages = dst_stages = 0;
+    src_access = dst_access = 0;
+    images.clear();
+  }
+
+  stage_flags src_stages;
+  stage_flags dst_stages;
+  // Accesses that don't change a layout share one global memory barrier.
+  access_flags src_access;
+  access_flags dst_access;
+  std::vector<image_memory_barrier> images;
+};
+
+// Merges runs of levels that cover the same layers in the same way.
+void merge_levels(std::vector<image_memory_barrier> &images) {
+  auto merged = 0ul;
+  for (auto i = 1ul; i < images.size(); ++i) {
+    auto &last = images[merged];
+    auto &next = images[i];
+    if (last.image == next.image && last.old_layout == next.old_layout &&
+        last.new_layout == next.new_layout && last.src_access == next.src_access &&
+        last.range.base_array_layer == next.range.base_array_layer &&
+        last.range.layer_count == next.range.layer_count &&
+        last.range.base_mip_level + last.range.mip_count == next.range.base_mip_level) {
+      last.range.mip_count += next.range.mip_count;
+      last.dst_access = last.dst_access | next.dst_access;
+    } else {
+      images[++merged] = next;
+    }
+  }
+  if (!images.empty())
+    images.resize(merged + 1);
+}
+
+}
+
+class resource_tracker::impl {
+public:
+  void add(const dependency &dep, stage_flags stage, access_flags access);
+  void add_image(VkImage image, image_aspect aspect, const dependency &dep,
+                 image_layout layout, access_flags access,
+                 uint32_t mip_level, uint32_t array_layer);
+  void record(command_builder &builder, barrier_batch &batch,
+              const event_ref *event);
+
+  std::unordered_map<VkBuffer, access_state> buffers_;
+  std::unordered_map<VkImage, image_state> images_;
+  barrier_batch pending_;
+  std::vector<std::pair<VkEvent, barrier_batch>> split_;
+};
+
+void resource_tracker::impl::add(const dependency &dep, stage_flags stage,
+                                 access_flags access) {
+  pending_.src_stages |= dep.src_stages;
+  pending_.dst_stages |= stage;
+  pending_.src_access |= dep.src_access;
+  pending_.dst_access |= access;
+}
+
+void resource_tracker::impl::add_image(VkImage image, image_aspect aspect,
+                                       const dependency &dep, image_layout layout,
+                                       access_flags access, uint32_t mip_level,
+                                       uint32_t array_layer) {
+  auto src_access = static_cast<access_mask>(dep.src_access);
+
+  // Subresources are visited in order, so a layer that continues the last
+  // barrier's run on the same level extends it. Levels are merged on flush.
+  if (!pending_.images.empty()) {
+    auto &last = pending_.images.back();
+    auto &range = last.range;
+    if (image == last.image && dep.old_layout == last.old_layout &&
+        layout == last.new_layout && src_access == last.src_access &&
+        mip_level == range.base_mip_level &&
+        array_layer == range.base_array_layer + range.layer_count) {
+      ++range.layer_count;
+      last.dst_access = last.dst_access | static_cast<access_mask>(access);
+      return;
+    }
+  }
+
+  image_memory_barrier barrier;
+  barrier.src_access = src_access;
+  barrier.dst_access = static_cast<access_mask>(access);
+  barrier.old_layout = dep.old_layout;
+  barrier.new_layout = layout;
+  barrier.src_family = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dst_family = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.range = subresource_range{aspect, mip_level, 1, array_layer, 1};
+  pending_.images.push_back(barrier);
+}
+
+void resource_tracker::impl::record(command_builder &builder,
+                                    barrier_batch &batch,
+                                    const event_ref *event) {
+  merge_levels(batch.images);
+
+  // A write already made available only needs an execution dependency.
+  memory_barrier global{static_cast<access_mask>(batch.src_access),
+                        static_cast<access_mask>(batch.dst_access)};
+  auto global_count = 0u == batch.src_access ? 0u : 1u;
+
+  auto src = static_cast<pipeline_stage>(batch.src_stages);
+  auto dst = static_cast<pipeline_stage>(batch.dst_stages);
+  if (nullptr == event)
+    builder.pipeline_barrier(src, dst, &global, global_count, nullptr, 0,
+                             batch.images.data(), batch.images.size());
+  else
+    builder.wait_events(event, 1, src, dst, &global, global_count, nullptr, 0,
+                        batch.images.data(), batch.images.size());
+  batch.clear();
+}
+
+resource_tracker::resource_tracker()
+: impl_{std::make_shared<impl>()} { }
+
+void resource_tracker::track(image_ref image, image_layout layout,
+                             image_aspect aspect, uint32_t mip_count,
+                             uint32_t layer_count, pipeline_stage ready_stage) {
+  auto &state = impl_->images_[image];
+  state.aspect = aspect;
+  state.mip_count = mip_count;
+  state.layer_count = layer_count;
+  state.subresources.assign(mip_count * layer_count,
+                            initial_state(layout, static_cast<stage_flags>(ready_stage)));
+}
+
+void resource_tracker::forget(image_ref image) {
+  impl_->images_.erase(image);
+}
+
+void resource_tracker::forget(buffer_ref buffer) {
+  impl_->buffers_.erase(buffer);
+}
+
+void resource_tracker::use(buffer_ref buffer, pipeline_stage stage,
+                           access_mask access) {
+  auto found = impl_->buffers_.find(buffer);
+  if (impl_->buffers_.end() == found)
+    found = impl_->buffers_.emplace(buffer, initial_state(image_layout::undefined, 0)).first;
+
+  auto stages = static_cast<stage_flags>(stage);
+  auto accesses = static_cast<access_flags>(access);
+  auto dep = advance(found->second, stages, accesses, image_layout::undefined);
+  if (dep.needed)
+    impl_->add(dep, stages, accesses);
+}
+
+void resource_tracker::use(image_ref image, const subresource_range &range,
+                           pipeline_stage stage, access_mask access,
+                           image_layout layout) {
+  auto found = impl_->images_.find(image);
+  assert(impl_->images_.end() != found && "Image is not tracked.");
+  auto &state = found->second;
+  assert(range.base_mip_level + range.mip_count <= state.mip_count &&
+         range.base_array_layer + range.layer_count <= state.layer_count &&
+         "Subresource range is outside the tracked image.");
+
+  auto stages = static_cast<stage_flags>(stage);
+  auto accesses = static_cast<access_flags>(access);
+  for (auto mip = range.base_mip_level;
+       mip < range.base_mip_level + range.mip_count; ++mip) {
+    for (auto layer = range.base_array_layer;
+         layer < range.base_array_layer + range.layer_count; ++layer) {
+      auto &subresource = state.subresources[mip * state.layer_count + layer];
+      auto dep = advance(subresource, stages, accesses, layout);
+      if (!dep.needed)
+        continue;
+
+      if (dep.old_layout == layout) {
+        impl_->add(dep, stages, accesses);
+      } else {
+        // The image barrier carries the accesses.
+        impl_->add(dependency{true, dep.src_stages, 0, layout}, stages, 0);
+        impl_->add_image(image, state.aspect, dep, layout, accesses, mip, layer);
+      }
+    }
+  }
+}
+
+image_layout resource_tracker::layout(image_ref image, uint32_t mip_level,
+                                      uint32_t array_layer) const {
+  auto found = impl_->images_.find(image);
+  assert(impl_->images_.end() != found && "Image is not tracked.");
+  auto &state = found->second;
+  return state.subresources[mip_level * state.layer_count + array_layer].layout;
+}
+
+bool resource_tracker::pending() const {
+  return !impl_->pending_.empty();
+}
+
+void resource_tracker::flush(command_builder &builder) {
+  if (!impl_->pending_.empty())
+    impl_->record(builder, impl_->pending_, nullptr);
+}
+
+void resource_tracker::flush(command_builder &builder, event_ref event) {
+  if (impl_->pending_.empty())
+    return;
+
+  builder.set_event(event, static_cast<pipeline_stage>(impl_->pending_.src_stages));
+  impl_->split_.emplace_back(event, std::move(impl_->pending_));
+  impl_->pending_.clear();
+}
+
+void resource_tracker::wait(command_builder &builder, event_ref event) {
+  auto &split = impl_->split_;
+  auto found = std::find_if(split.begin(), split.end(),
+      [&](const std::pair<VkEvent, barrier_batch> &entry) {
+        return entry.first == static_cast<VkEvent>(event);
+      });
+  // Nothing was pending when the event would have been set.
+  if (split.end() == found)
+    return;
+
+  impl_->record(builder, found->second, &event);
+  split.erase(found);
+}
+
+barrier_set resource_tracker::take() {
+  auto &pending = impl_->pending_;
+  merge_levels(pending.images);
+
+  barrier_set barriers;
+  barriers.src_stages = static_cast<pipeline_stage>(pending.src_stages);
+  barriers.dst_stages = static_cast<pipeline_stage>(pending.dst_stages);
+  if (0 != pending.src_access)
+    barriers.memory.push_back({static_cast<access_mask>(pending.src_access),
+                               static_cast<access_mask>(pending.dst_access)});
+  barriers.images = std::move(pending.images);
+  pending.clear();
+  return barriers;
+}
+
+void barrier_set::record(command_builder &builder) const {
+  if (!empty())
+    builder.pipeline_barrier(src_stages, dst_stages, memory.data(), memory.size(),
+                             nullptr, 0, images.data(), images.size());
+}
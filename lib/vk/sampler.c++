@@ -1,4 +1,5 @@
 #include <vk/vk.h>
+#include "dispatch.h"
 
 using namespace vk;
 
@@ -16,9 +17,13 @@ sampler::impl::impl(device device)
 
 sampler::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroySampler(device_, handle_, nullptr);
+    device_.dispatch().vkDestroySampler(device_, handle_, nullptr);
   }
 }
 
 sampler::sampler(device device)
 : impl_{std::make_shared<impl>(std::move(device))} { }
+
+sampler::operator VkSampler() {
+  return impl_->handle_;
+}
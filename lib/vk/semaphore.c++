@@ -1,5 +1,9 @@
 #include <vk/vk.h>
 #include <cassert>
+#include <cstdlib>
+#include "dispatch.h"
+#include "trace.h"
+#include "utility.h"
 
 using namespace vk;
 
@@ -17,7 +21,7 @@ semaphore::impl::impl(device device)
 
 semaphore::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroySemaphore(device_, handle_, nullptr);
+    device_.dispatch().vkDestroySemaphore(device_, handle_, nullptr);
   }
 }
 
@@ -28,7 +32,112 @@ semaphore::semaphore(device device)
   info.pNext = nullptr;
   info.flags = 0;
 
-  auto result = vkCreateSemaphore(impl_->device_, &info, nullptr, &impl_->handle_);
+  auto result = impl_->device_.dispatch().vkCreateSemaphore(impl_->device_, &info, nullptr, &impl_->handle_);
   assert(VK_SUCCESS == result && "Failed to create semaphore");
 }
 
+semaphore::operator VkSemaphore() {
+  return impl_->handle_;
+}
+
+class timeline_semaphore::impl {
+public:
+  impl(device device);
+  ~impl();
+
+  device device_;
+  VkSemaphore handle_;
+};
+
+timeline_semaphore::impl::impl(device device)
+: device_{std::move(device)}, handle_{VK_NULL_HANDLE} { }
+
+timeline_semaphore::impl::~impl() {
+  if (VK_NULL_HANDLE != handle_) {
+    device_.dispatch().vkDestroySemaphore(device_, handle_, nullptr);
+  }
+}
+
+timeline_semaphore::timeline_semaphore(device device, uint64_t initial_value)
+: impl_{std::make_shared<impl>(std::move(device))} {
+  assert(impl_->device_.supports_timeline_semaphores() &&
+         "Device doesn't support timeline semaphores.");
+
+  VkSemaphoreTypeCreateInfoKHR type_info;
+  type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+  type_info.pNext = nullptr;
+  type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+  type_info.initialValue = initial_value;
+
+  VkSemaphoreCreateInfo info;
+  info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  info.pNext = &type_info;
+  info.flags = 0;
+
+  auto result = impl_->device_.dispatch().vkCreateSemaphore(impl_->device_, &info, nullptr, &impl_->handle_);
+  assert(VK_SUCCESS == result && "Failed to create timeline semaphore");
+}
+
+uint64_t timeline_semaphore::current_value() const {
+  uint64_t value = 0;
+  auto result = impl_->device_.dispatch().vkGetSemaphoreCounterValueKHR(
+      impl_->device_, impl_->handle_, &value);
+  assert(VK_SUCCESS == result && "Failed to read timeline semaphore.");
+  return value;
+}
+
+wait_result timeline_semaphore::wait(uint64_t value, uint64_t timeout) {
+  return wait(this, &value, 1, true, timeout);
+}
+
+void timeline_semaphore::signal(uint64_t value) {
+  VkSemaphoreSignalInfoKHR info;
+  info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO_KHR;
+  info.pNext = nullptr;
+  info.semaphore = impl_->handle_;
+  info.value = value;
+
+  auto result = impl_->device_.dispatch().vkSignalSemaphoreKHR(impl_->device_, &info);
+  assert(VK_SUCCESS == result && "Failed to signal timeline semaphore.");
+}
+
+wait_result timeline_semaphore::wait(timeline_semaphore *semaphores,
+                                     const uint64_t *values,
+                                     uint32_t semaphore_count, bool wait_all,
+                                     uint64_t timeout) {
+  if (0 == semaphore_count)
+    return wait_result::SUCCESS;
+
+  VkDevice device = semaphores[0].impl_->device_;
+  auto &dispatch = semaphores[0].impl_->device_.dispatch();
+  scratch_buffer<VkSemaphore> handles(semaphore_count);
+  for (auto i = 0u; i < semaphore_count; ++i) {
+    handles[i] = semaphores[i];
+    assert(device == semaphores[i].impl_->device_ &&
+           "All semaphores in a wait must share a device.");
+  }
+
+  VkSemaphoreWaitInfoKHR info;
+  info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+  info.pNext = nullptr;
+  info.flags = wait_all ? 0 : VK_SEMAPHORE_WAIT_ANY_BIT_KHR;
+  info.semaphoreCount = semaphore_count;
+  info.pSemaphores = handles.data();
+  info.pValues = values;
+
+  VK_TRACE_SCOPE("vkWaitSemaphoresKHR");
+  auto result = dispatch.vkWaitSemaphoresKHR(device, &info, timeout);
+  switch (result) {
+  case VK_SUCCESS:
+    return wait_result::SUCCESS;
+  case VK_TIMEOUT:
+    return wait_result::TIMEOUT;
+  default:
+    assert(false && "Error waiting for timeline semaphores.");
+    abort();
+  }
+}
+
+timeline_semaphore::operator VkSemaphore() {
+  return impl_->handle_;
+}
@@ -1,5 +1,6 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
 
 using namespace vk;
 
@@ -19,7 +20,7 @@ shader_module::impl::impl(device device) : device_{device} {
 
 shader_module::impl::~impl() {
   if (VK_NULL_HANDLE != handle_) {
-    vkDestroyShaderModule(device_, handle_, nullptr);
+    device_.dispatch().vkDestroyShaderModule(device_, handle_, nullptr);
   }
 }
 
@@ -39,7 +40,7 @@ shader_module::shader_module(device device, const uint32_t* code,
   info.codeSize = size_in_bytes;
   info.pCode = code;
 
-  auto result = vkCreateShaderModule(impl_->device_, &info, nullptr,
+  auto result = impl_->device_.dispatch().vkCreateShaderModule(impl_->device_, &info, nullptr,
                                      &impl_->handle_);
   assert(VK_SUCCESS == result);
 }
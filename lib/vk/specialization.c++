@@ -0,0 +1,69 @@
+#include <vk/vk.h>
+#include <algorithm>
+#include <cstring>
+
+using namespace vk;
+
+void specialization::set(uint32_t constant_id, const void *value, size_t size) {
+  auto entry = std::lower_bound(entries_.begin(), entries_.end(), constant_id,
+      [](const VkSpecializationMapEntry &entry, uint32_t id) {
+        return entry.constantID < id;
+      });
+
+  // Values sit in ID order, so a new or resized value shifts the ones after.
+  uint32_t offset = data_.size();
+  if (entries_.end() != entry) {
+    offset = entry->offset;
+    if (constant_id == entry->constantID) {
+      data_.erase(data_.begin() + offset, data_.begin() + offset + entry->size);
+      for (auto next = entry + 1; next != entries_.end(); ++next)
+        next->offset -= entry->size;
+      entry = entries_.erase(entry);
+    }
+  }
+
+  auto bytes = static_cast<const uint8_t*>(value);
+  data_.insert(data_.begin() + offset, bytes, bytes + size);
+  for (auto next = entry; next != entries_.end(); ++next)
+    next->offset += size;
+  entries_.insert(entry, VkSpecializationMapEntry{constant_id, offset, size});
+}
+
+VkSpecializationInfo specialization::info() const {
+  VkSpecializationInfo info;
+  info.mapEntryCount = entries_.size();
+  info.pMapEntries = entries_.data();
+  info.dataSize = data_.size();
+  info.pData = data_.data();
+  return info;
+}
+
+size_t specialization::hash() const {
+  // FNV-1a over the IDs, sizes and packed values.
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](uint64_t word) {
+    hash ^= word;
+    hash *= 1099511628211ull;
+  };
+
+  for (auto &entry: entries_)
+    mix(uint64_t(entry.constantID) << 32 | entry.size);
+  for (auto byte: data_)
+    mix(byte);
+  return static_cast<size_t>(hash);
+}
+
+bool specialization::operator==(const specialization &other) const {
+  // Offsets follow from the IDs and sizes, so they needn't be compared.
+  return entries_.size() == other.entries_.size() &&
+         std::equal(entries_.begin(), entries_.end(), other.entries_.begin(),
+                    [](const VkSpecializationMapEntry &a,
+                       const VkSpecializationMapEntry &b) {
+                      return a.constantID == b.constantID && a.size == b.size;
+                    }) &&
+         data_ == other.data_;
+}
+
+bool specialization::operator!=(const specialization &other) const {
+  return !(*this == other);
+}
@@ -0,0 +1,203 @@
+#include <vk/vk.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+#include "trace.h"
+
+using namespace vk;
+
+namespace {
+
+struct destination {
+  VkBuffer buffer;
+  std::vector<buffer_copy> copies;
+};
+
+// A write small enough to go in the command buffer itself. Its bytes are
+// kept in update_data_ until it is recorded.
+struct small_update {
+  VkBuffer buffer;
+  size_t offset;
+  size_t data_offset;
+  size_t size;
+};
+
+struct batch {
+  fence guard;
+  // Ring position the batch's uploads end at.
+  uint64_t end;
+};
+
+}
+
+class staging_uploader::impl {
+public:
+  impl(device device, const physical_device::memory_type &memory_type,
+       size_t ring_size, size_t update_threshold);
+
+  void reclaim();
+  void add_copy(VkBuffer dst, size_t src_offset, size_t dst_offset, size_t size);
+  void flush(uint64_t begin, uint64_t end);
+
+  device device_;
+  size_t size_;
+  size_t update_threshold_;
+  buffer ring_;
+  device_memory memory_;
+  char *data_;
+
+  // Positions count every byte ever staged and only grow. Their ring offset
+  // is the position modulo size_. Bytes from tail_ to head_ are in use.
+  uint64_t head_;
+  uint64_t tail_;
+  uint64_t recorded_;
+
+  std::vector<destination> destinations_;
+  std::unordered_map<VkBuffer, size_t> destination_index_;
+  std::vector<small_update> updates_;
+  std::vector<char> update_data_;
+
+  std::deque<batch> in_flight_;
+  std::vector<fence> spare_fences_;
+};
+
+staging_uploader::impl::impl(device device,
+                             const physical_device::memory_type &memory_type,
+                             size_t ring_size, size_t update_threshold)
+: device_{std::move(device)}, size_{ring_size},
+  update_threshold_{std::min<size_t>(update_threshold, 65536)},
+  ring_{device_, ring_size, buffer_usage::transfer_source},
+  memory_{device_, memory_type, ring_.minimum_allocation_size(), true},
+  data_{static_cast<char*>(memory_.mapped_data())},
+  head_{0}, tail_{0}, recorded_{0} {
+  assert(0 < ring_size && "Staging ring needs room for uploads.");
+  assert((ring_.memory_type_bits() & (1u << memory_type.index)) &&
+         "Memory type is not suitable for the staging ring.");
+  ring_.bind(memory_, 0, ring_.minimum_allocation_size());
+}
+
+void staging_uploader::impl::reclaim() {
+  while (!in_flight_.empty() &&
+         signal_status::signaled == in_flight_.front().guard.status()) {
+    auto &front = in_flight_.front();
+    tail_ = front.end;
+    front.guard.reset();
+    spare_fences_.push_back(std::move(front.guard));
+    in_flight_.pop_front();
+  }
+}
+
+void staging_uploader::impl::add_copy(VkBuffer dst, size_t src_offset,
+                                      size_t dst_offset, size_t size) {
+  auto index = destination_index_.emplace(dst, destinations_.size());
+  if (index.second)
+    destinations_.push_back(destination{dst, {}});
+
+  // Uploads that follow on in both the ring and the destination become one
+  // region.
+  auto &copies = destinations_[index.first->second].copies;
+  if (!copies.empty()) {
+    auto &last = copies.back();
+    if (last.src_offset + last.size == src_offset &&
+        last.dst_offset + last.size == dst_offset) {
+      last.size += size;
+      return;
+    }
+  }
+  copies.push_back(buffer_copy{src_offset, dst_offset, size});
+}
+
+void staging_uploader::impl::flush(uint64_t begin, uint64_t end) {
+  if (begin == end)
+    return;
+
+  auto first = begin % size_;
+  auto last = (end - 1) % size_ + 1;
+  if (first < last) {
+    memory_.flush(first, last - first);
+  } else {
+    memory_.flush(first, size_ - first);
+    memory_.flush(0, last);
+  }
+}
+
+staging_uploader::staging_uploader(device device,
+                                   const physical_device::memory_type &memory_type,
+                                   size_t ring_size, size_t update_threshold)
+: impl_{std::make_shared<impl>(std::move(device), memory_type, ring_size,
+                               update_threshold)} { }
+
+size_t staging_uploader::upload(buffer_ref dst, size_t offset, const void *data,
+                                size_t size) {
+  if (0 == size)
+    return 0;
+
+  auto bytes = static_cast<const char*>(data);
+  if (size <= impl_->update_threshold_ && 0 == offset % 4 && 0 == size % 4) {
+    auto &update_data = impl_->update_data_;
+    impl_->updates_.push_back(small_update{dst, offset, update_data.size(), size});
+    update_data.insert(update_data.end(), bytes, bytes + size);
+    return size;
+  }
+
+  impl_->reclaim();
+  auto ring_size = impl_->size_;
+  size_t staged = 0;
+  while (staged < size) {
+    auto position = static_cast<size_t>(impl_->head_ % ring_size);
+    auto free = ring_size - static_cast<size_t>(impl_->head_ - impl_->tail_);
+    // Chunks stop at the end of the ring and carry on from its start.
+    auto chunk = std::min(std::min(size - staged, free), ring_size - position);
+    if (0 == chunk)
+      break;
+
+    std::memcpy(impl_->data_ + position, bytes + staged, chunk);
+    impl_->add_copy(dst, position, offset + staged, chunk);
+    impl_->head_ += chunk;
+    staged += chunk;
+  }
+  return staged;
+}
+
+fence staging_uploader::record(command_builder &builder,
+                               pipeline_stage dst_stages,
+                               access_mask dst_access) {
+  VK_TRACE_SCOPE("staging_uploader::record");
+  impl_->flush(impl_->recorded_, impl_->head_);
+  impl_->recorded_ = impl_->head_;
+
+  auto recorded = !impl_->destinations_.empty() || !impl_->updates_.empty();
+  for (auto &destination: impl_->destinations_) {
+    builder.copy_buffer(impl_->ring_, destination.buffer, destination.copies.data(),
+                        destination.copies.size());
+  }
+  for (auto &update: impl_->updates_) {
+    builder.update_buffer(update.buffer, update.offset,
+                          impl_->update_data_.data() + update.data_offset,
+                          update.size);
+  }
+  if (recorded) {
+    memory_barrier barrier{access_mask::transfer_write, dst_access};
+    builder.pipeline_barrier(pipeline_stage::transfer, dst_stages, &barrier, 1,
+                             nullptr, 0, nullptr, 0);
+  }
+
+  impl_->destinations_.clear();
+  impl_->destination_index_.clear();
+  impl_->updates_.clear();
+  impl_->update_data_.clear();
+
+  impl_->reclaim();
+  auto &spare = impl_->spare_fences_;
+  fence guard = spare.empty() ? fence{impl_->device_, false} : spare.back();
+  if (!spare.empty())
+    spare.pop_back();
+  impl_->in_flight_.push_back(batch{guard, impl_->head_});
+  return guard;
+}
+
+size_t staging_uploader::used() const {
+  return static_cast<size_t>(impl_->head_ - impl_->tail_);
+}
@@ -0,0 +1,97 @@
+#include <vk/vk.h>
+#include <cassert>
+
+using namespace vk;
+
+submission& submission::next_batch() {
+  batch b;
+  b.first_wait = waits_.size();
+  b.wait_count = 0;
+  b.first_buffer = buffers_.size();
+  b.buffer_count = 0;
+  b.first_signal = signals_.size();
+  b.signal_count = 0;
+  b.timeline = false;
+  batches_.push_back(b);
+  return *this;
+}
+
+submission::batch& submission::current() {
+  if (batches_.empty())
+    next_batch();
+  return batches_.back();
+}
+
+submission::batch& submission::add_wait(VkSemaphore semaphore, uint64_t value,
+                                        pipeline_stage stage) {
+  auto &b = current();
+  assert(b.first_wait + b.wait_count == waits_.size() &&
+         "Waits must be added before starting the next batch.");
+  waits_.push_back(semaphore);
+  wait_stages_.push_back(static_cast<VkPipelineStageFlags>(stage));
+  wait_values_.push_back(value);
+  ++b.wait_count;
+  return b;
+}
+
+submission::batch& submission::add_signal(VkSemaphore semaphore, uint64_t value) {
+  auto &b = current();
+  signals_.push_back(semaphore);
+  signal_values_.push_back(value);
+  ++b.signal_count;
+  return b;
+}
+
+submission& submission::wait(semaphore semaphore, pipeline_stage stage) {
+  add_wait(semaphore, 0, stage);
+  return *this;
+}
+
+submission& submission::wait(timeline_semaphore semaphore, uint64_t value,
+                             pipeline_stage stage) {
+  add_wait(semaphore, value, stage).timeline = true;
+  return *this;
+}
+
+submission& submission::execute(command_buffer buffer) {
+  auto &b = current();
+  buffers_.push_back(buffer);
+  ++b.buffer_count;
+  return *this;
+}
+
+submission& submission::execute(command_buffer *buffers, size_t buffer_count) {
+  auto &b = current();
+  for (auto i = 0ul; i < buffer_count; ++i)
+    buffers_.push_back(buffers[i]);
+  b.buffer_count += buffer_count;
+  return *this;
+}
+
+submission& submission::signal(semaphore semaphore) {
+  add_signal(semaphore, 0);
+  return *this;
+}
+
+submission& submission::signal(timeline_semaphore semaphore, uint64_t value) {
+  add_signal(semaphore, value).timeline = true;
+  return *this;
+}
+
+void submission::clear() {
+  batches_.clear();
+  waits_.clear();
+  wait_stages_.clear();
+  wait_values_.clear();
+  buffers_.clear();
+  signals_.clear();
+  signal_values_.clear();
+}
+
+bool submission::empty() const {
+  return batches_.empty();
+}
+
+size_t submission::batch_count() const {
+  return batches_.size();
+}
@@ -1,5 +1,7 @@
 #include <vk/vk.h>
 #include <cassert>
+#include "dispatch.h"
+#include "trace.h"
 
 using namespace vk;
 
@@ -20,7 +22,7 @@ swapchain::impl::impl(device device)
 
 swapchain::impl::~impl() {
   if (VK_NULL_HANDLE != handle_)
-    vkDestroySwapchainKHR(device_, handle_, nullptr);
+    device_.dispatch().vkDestroySwapchainKHR(device_, handle_, nullptr);
 }
 
 swapchain_image::swapchain_image(vk::device device, swapchain swapchain, VkImage handle, uint32_t index)
@@ -76,15 +78,15 @@ swapchain::swapchain(device device, surface surface, surface_format format)
   info.clipped = VK_TRUE;
   info.oldSwapchain = VK_NULL_HANDLE;
   
-  result = vkCreateSwapchainKHR(impl_->device_, &info, nullptr, &impl_->handle_);
+  result = impl_->device_.dispatch().vkCreateSwapchainKHR(impl_->device_, &info, nullptr, &impl_->handle_);
   assert(VK_SUCCESS == result && "Swap chain creation failed.");
 
   uint32_t image_count = 0;
   std::vector<VkImage> swapchain_images;
-  result = vkGetSwapchainImagesKHR(impl_->device_, impl_->handle_, &image_count, nullptr);
+  result = impl_->device_.dispatch().vkGetSwapchainImagesKHR(impl_->device_, impl_->handle_, &image_count, nullptr);
   if (VK_SUCCESS == result) {
     swapchain_images.resize(image_count);
-    result = vkGetSwapchainImagesKHR(impl_->device_, impl_->handle_, &image_count,
+    result = impl_->device_.dispatch().vkGetSwapchainImagesKHR(impl_->device_, impl_->handle_, &image_count,
                                      swapchain_images.data());
   }
 
@@ -128,12 +130,13 @@ swapchain::operator VkSwapchainKHR() {
 }
 
 swapchain_image swapchain::acquire_next_image() {
+  VK_TRACE_SCOPE("vkAcquireNextImageKHR");
   // Declare a fence so we can wait for the next available image. Initially unsignaled.
   fence fence{impl_->device_, false};
   
   // Acquire the index for the next image.
   uint32_t index = 0;
-  auto result = vkAcquireNextImageKHR(impl_->device_, impl_->handle_, UINT64_MAX,
+  auto result = impl_->device_.dispatch().vkAcquireNextImageKHR(impl_->device_, impl_->handle_, UINT64_MAX,
                                       VK_NULL_HANDLE, fence, &index);
   assert(VK_SUCCESS == result && "Failed to acquire swapchain image.");
 
@@ -143,6 +146,18 @@ swapchain_image swapchain::acquire_next_image() {
   return impl_->images_[index];
 }
 
+swapchain_image swapchain::acquire_next_image(semaphore signal) {
+  VK_TRACE_SCOPE("vkAcquireNextImageKHR");
+  // The image may still be read by the presentation engine, so rather than
+  // waiting here the semaphore is signaled once it is actually free.
+  uint32_t index = 0;
+  auto result = impl_->device_.dispatch().vkAcquireNextImageKHR(impl_->device_, impl_->handle_, UINT64_MAX,
+                                      signal, VK_NULL_HANDLE, &index);
+  assert((VK_SUCCESS == result || VK_SUBOPTIMAL_KHR == result) &&
+         "Failed to acquire swapchain image.");
+  return impl_->images_[index];
+}
+
 swapchain_image & swapchain::get_image(uint32_t index) {
   return impl_->images_[index];
 }
@@ -0,0 +1,185 @@
+#include <vk/vk.h>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace vk;
+
+namespace {
+
+// The pool whose worker is running on this thread, if any.
+thread_local const void *current_pool = nullptr;
+
+}
+
+class thread_pool::impl {
+public:
+  // Owns the function and counter for jobs nobody waits on.
+  struct async_batch {
+    std::function<void(uint32_t, uint32_t)> function_;
+    std::function<void()> on_complete_;
+    std::atomic<uint32_t> remaining_;
+  };
+
+  struct job {
+    const std::function<void(uint32_t, uint32_t)> *function_;
+    uint32_t index_;
+    std::atomic<uint32_t> *remaining_;
+    async_batch *batch_;
+  };
+
+  struct worker_queue {
+    std::mutex mutex_;
+    std::deque<job> jobs_;
+  };
+
+  impl(uint32_t thread_count);
+  ~impl();
+
+  void run(uint32_t worker);
+  bool pop(uint32_t worker, job &next);
+  void push(const std::function<void(uint32_t, uint32_t)> &function,
+            uint32_t count, std::atomic<uint32_t> &remaining,
+            async_batch *batch);
+
+  std::vector<std::unique_ptr<worker_queue>> queues_;
+  std::vector<std::thread> threads_;
+
+  // Guards stop_ and queued_ changes so sleeping workers never miss a wake up.
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  std::atomic<uint32_t> queued_;
+  bool stop_;
+};
+
+thread_pool::impl::impl(uint32_t thread_count)
+: queued_{0}, stop_{false} {
+  assert(0 < thread_count && "A thread pool needs at least one thread.");
+
+  for (auto i = 0u; i < thread_count; ++i)
+    queues_.push_back(std::make_unique<worker_queue>());
+
+  for (auto i = 0u; i < thread_count; ++i)
+    threads_.emplace_back([this, i]() { run(i); });
+}
+
+thread_pool::impl::~impl() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stop_ = true;
+  }
+  wake_.notify_all();
+
+  for (auto &thread: threads_)
+    thread.join();
+}
+
+bool thread_pool::impl::pop(uint32_t worker, job &next) {
+  // Own work comes off the front, stolen work off the back, so the owner and
+  // thieves rarely contend for the same end.
+  for (auto i = 0u; i < queues_.size(); ++i) {
+    auto &queue = *queues_[(worker + i) % queues_.size()];
+    std::lock_guard<std::mutex> lock{queue.mutex_};
+    if (queue.jobs_.empty())
+      continue;
+
+    if (0 == i) {
+      next = queue.jobs_.front();
+      queue.jobs_.pop_front();
+    } else {
+      next = queue.jobs_.back();
+      queue.jobs_.pop_back();
+    }
+
+    --queued_;
+    return true;
+  }
+
+  return false;
+}
+
+void thread_pool::impl::run(uint32_t worker) {
+  current_pool = this;
+  while (true) {
+    job next;
+    if (pop(worker, next)) {
+      (*next.function_)(next.index_, worker);
+      if (1 == next.remaining_->fetch_sub(1)) {
+        if (nullptr != next.batch_) {
+          if (next.batch_->on_complete_)
+            next.batch_->on_complete_();
+          delete next.batch_;
+          continue;
+        }
+
+        std::lock_guard<std::mutex> lock{mutex_};
+        done_.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock{mutex_};
+    wake_.wait(lock, [this]() { return stop_ || 0 < queued_; });
+    if (stop_ && 0 == queued_)
+      return;
+  }
+}
+
+void thread_pool::impl::push(const std::function<void(uint32_t, uint32_t)> &function,
+                             uint32_t count, std::atomic<uint32_t> &remaining,
+                             async_batch *batch) {
+  // Count the jobs in before they become visible, so workers popping them
+  // early never see queued_ go below zero.
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    queued_ += count;
+  }
+
+  auto queue_count = queues_.size();
+  for (auto i = 0u; i < queue_count; ++i) {
+    auto &queue = *queues_[i];
+    std::lock_guard<std::mutex> lock{queue.mutex_};
+    for (auto index = i; index < count; index += queue_count)
+      queue.jobs_.push_back(job{&function, index, &remaining, batch});
+  }
+  wake_.notify_all();
+}
+
+thread_pool::thread_pool(uint32_t thread_count)
+: impl_{std::make_shared<impl>(thread_count)} { }
+
+uint32_t thread_pool::size() const {
+  return impl_->threads_.size();
+}
+
+void thread_pool::parallel_for(uint32_t count,
+                               const std::function<void(uint32_t, uint32_t)> &job) {
+  assert(current_pool != impl_.get() &&
+         "parallel_for can't be called from one of the pool's own jobs.");
+  if (0 == count)
+    return;
+
+  std::atomic<uint32_t> remaining{count};
+  impl_->push(job, count, remaining, nullptr);
+
+  std::unique_lock<std::mutex> lock{impl_->mutex_};
+  impl_->done_.wait(lock, [&remaining]() { return 0 == remaining; });
+}
+
+void thread_pool::async_for(uint32_t count,
+                            std::function<void(uint32_t, uint32_t)> job,
+                            std::function<void()> on_complete) {
+  if (0 == count) {
+    if (on_complete)
+      on_complete();
+    return;
+  }
+
+  // Freed by whichever worker finishes the last index.
+  auto batch = new impl::async_batch{std::move(job), std::move(on_complete), {count}};
+  impl_->push(batch->function_, count, batch->remaining_, batch);
+}
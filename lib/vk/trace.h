@@ -0,0 +1,44 @@
+#ifndef VK_TRACE_H
+#define VK_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace vk {
+namespace trace {
+
+// Set while a trace_session runs.
+extern std::atomic<bool> enabled;
+
+uint64_t now();
+void record(const char *name, uint64_t begin, uint64_t end);
+
+// Times the enclosing scope as one event. Names have to outlive the session,
+// so they are string literals.
+class scope {
+public:
+  explicit scope(const char *name)
+  : name_{enabled.load(std::memory_order_relaxed) ? name : nullptr},
+    begin_{nullptr != name_ ? now() : 0} { }
+  scope(const scope&) = delete;
+  scope& operator=(const scope&) = delete;
+
+  ~scope() {
+    if (nullptr != name_)
+      record(name_, begin_, now());
+  }
+private:
+  const char *name_;
+  uint64_t begin_;
+};
+
+}
+}
+
+#ifdef ENABLE_TRACING
+#define VK_TRACE_SCOPE(name) vk::trace::scope trace_scope_{name}
+#else
+#define VK_TRACE_SCOPE(name) ((void)0)
+#endif
+
+#endif
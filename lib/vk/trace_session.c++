@@ -0,0 +1,179 @@
+#include <vk/vk.h>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include "trace.h"
+
+using namespace vk;
+
+namespace {
+
+const size_t ring_size = 16384;
+
+struct trace_event {
+  const char *name;
+  uint64_t begin;
+  uint64_t end;
+};
+
+// Written by its thread and read by the session's drain thread. The writer
+// owns head and the reader owns tail.
+struct thread_ring {
+  explicit thread_ring(uint32_t id)
+  : id{id}, head{0}, tail{0}, dropped{0}, events(ring_size) { }
+
+  const uint32_t id;
+  std::atomic<uint64_t> head;
+  std::atomic<uint64_t> tail;
+  std::atomic<uint64_t> dropped;
+  std::vector<trace_event> events;
+};
+
+// Rings are never freed, so a hook racing the end of a session, or a
+// thread outliving one, always has somewhere to write.
+struct ring_registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<thread_ring>> rings;
+};
+
+ring_registry& registry() {
+  static auto registry = new ring_registry;
+  return *registry;
+}
+
+thread_ring& local_ring() {
+  thread_local thread_ring *ring = nullptr;
+  if (nullptr == ring) {
+    auto &rings = registry();
+    std::lock_guard<std::mutex> lock{rings.mutex};
+    rings.rings.push_back(std::make_unique<thread_ring>(rings.rings.size()));
+    ring = rings.rings.back().get();
+  }
+  return *ring;
+}
+
+std::vector<thread_ring*> all_rings() {
+  auto &rings = registry();
+  std::lock_guard<std::mutex> lock{rings.mutex};
+  std::vector<thread_ring*> result;
+  for (auto &ring: rings.rings)
+    result.push_back(ring.get());
+  return result;
+}
+
+}
+
+std::atomic<bool> trace::enabled{false};
+
+uint64_t trace::now() {
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void trace::record(const char *name, uint64_t begin, uint64_t end) {
+  auto &ring = local_ring();
+  auto head = ring.head.load(std::memory_order_relaxed);
+  if (head - ring.tail.load(std::memory_order_acquire) == ring.events.size()) {
+    ring.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  ring.events[head % ring.events.size()] = trace_event{name, begin, end};
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+class trace_session::impl {
+public:
+  explicit impl(const char *path);
+  ~impl();
+
+  void run();
+  void drain();
+
+  std::ofstream out_;
+  uint64_t start_;
+  bool first_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stopping_;
+  std::thread thread_;
+};
+
+trace_session::impl::impl(const char *path)
+: out_{path}, start_{0}, first_{true}, stopping_{false} {
+  assert(out_.is_open() && "Failed to open trace file.");
+  assert(!trace::enabled && "A trace session is already running.");
+
+  // Whatever was left in the rings belongs to no session.
+  for (auto ring: all_rings()) {
+    ring->tail.store(ring->head.load(std::memory_order_acquire),
+                     std::memory_order_release);
+    ring->dropped = 0;
+  }
+
+  out_ << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+  start_ = trace::now();
+  trace::enabled = true;
+  thread_ = std::thread{[this] { run(); }};
+}
+
+trace_session::impl::~impl() {
+  trace::enabled = false;
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+
+  drain();
+  out_ << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void trace_session::impl::run() {
+  std::unique_lock<std::mutex> lock{mutex_};
+  while (!stopping_) {
+    wake_.wait_for(lock, std::chrono::milliseconds{10});
+    lock.unlock();
+    drain();
+    lock.lock();
+  }
+}
+
+void trace_session::impl::drain() {
+  for (auto ring: all_rings()) {
+    auto head = ring->head.load(std::memory_order_acquire);
+    auto tail = ring->tail.load(std::memory_order_relaxed);
+    for (; tail != head; ++tail) {
+      auto &event = ring->events[tail % ring->events.size()];
+      // Started before the session, by a hook that raced its start.
+      if (event.begin < start_)
+        continue;
+
+      // Complete events, timestamped in microseconds.
+      out_ << (first_ ? "\n" : ",\n")
+           << "{\"name\":\"" << event.name << "\",\"cat\":\"vk\",\"ph\":\"X\""
+           << ",\"pid\":1,\"tid\":" << ring->id
+           << ",\"ts\":" << (event.begin - start_) / 1000.0
+           << ",\"dur\":" << (event.end - event.begin) / 1000.0 << "}";
+      first_ = false;
+    }
+    ring->tail.store(head, std::memory_order_release);
+  }
+  out_.flush();
+}
+
+trace_session::trace_session(const char *path)
+: impl_{std::make_shared<impl>(path)} { }
+
+uint64_t trace_session::dropped() const {
+  uint64_t dropped = 0;
+  for (auto ring: all_rings())
+    dropped += ring->dropped.load(std::memory_order_relaxed);
+  return dropped;
+}
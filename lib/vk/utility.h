@@ -1,3 +1,8 @@
+#ifndef VK_UTILITY_H
+#define VK_UTILITY_H
+
+#include <vector>
+
 template<typename F, typename I>
 auto transform(I begin, I end, F f) {
   using result_type = decltype(f(*begin));
@@ -9,3 +14,62 @@ auto transform(I begin, I end, F f) {
   }
   return results;
 }
+
+// Scratch space for translating wrappers into raw Vulkan structs on hot
+// paths. Up to N elements live on the stack. Larger requests borrow a vector
+// kept per thread and per type that only ever grows, so steady state doesn't
+// touch the heap. Nested borrows of the same type fall back to allocating.
+template<typename T, size_t N = 16>
+class scratch_buffer {
+public:
+  explicit scratch_buffer(size_t size)
+  : data_{inline_}, size_{size}, spare_{nullptr} {
+    if (size <= N)
+      return;
+
+    auto &spare = spare_storage();
+    if (spare.in_use_) {
+      fallback_.resize(size);
+      data_ = fallback_.data();
+      return;
+    }
+
+    if (spare.data_.size() < size)
+      spare.data_.resize(size);
+
+    spare.in_use_ = true;
+    spare_ = &spare;
+    data_ = spare.data_.data();
+  }
+
+  ~scratch_buffer() {
+    if (nullptr != spare_)
+      spare_->in_use_ = false;
+  }
+
+  scratch_buffer(const scratch_buffer&) = delete;
+  scratch_buffer& operator=(const scratch_buffer&) = delete;
+
+  T* data() { return data_; }
+  size_t size() const { return size_; }
+  T& operator[](size_t index) { return data_[index]; }
+
+private:
+  struct spare {
+    std::vector<T> data_;
+    bool in_use_ = false;
+  };
+
+  static spare& spare_storage() {
+    thread_local spare storage;
+    return storage;
+  }
+
+  T inline_[N];
+  T *data_;
+  size_t size_;
+  spare *spare_;
+  std::vector<T> fallback_;
+};
+
+#endif // ifndef VK_UTILITY_H
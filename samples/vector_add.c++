@@ -52,29 +52,25 @@ int main(int argc, char **argv) {
   vk::buffer b{device, size_in_bytes};
   vk::buffer c{device, size_in_bytes};
 
-  // We should be calling get_memory_requirements for each buffer here.
-  vk::device_memory storage{device, *best_memory_type, 3 * size_in_bytes};
-  a.bind(storage, 0, size_in_bytes);
-  b.bind(storage, size_in_bytes, size_in_bytes);
-  c.bind(storage, 2 * size_in_bytes, size_in_bytes);
-
-  // Map the range of buffers a, b.
-  void *ptr = nullptr;
-  if (map_memory(storage, 0, size_in_bytes, &ptr)) {
-    uint32_t* as_uint32 = reinterpret_cast<uint32_t*>(ptr);
-    for (auto i = 0ul; i < ELEMENT_COUNT; ++i)
-      as_uint32[i] = i;
-
-   unmap_memory(storage);
+  // Sub-allocate each buffer from a shared block, honouring its requirements.
+  vk::memory_allocator allocator{device};
+  vk::memory_allocation a_memory = allocator.allocate(*best_memory_type, a);
+  vk::memory_allocation b_memory = allocator.allocate(*best_memory_type, b);
+  vk::memory_allocation c_memory = allocator.allocate(*best_memory_type, c);
+  a.bind(a_memory);
+  b.bind(b_memory);
+  c.bind(c_memory);
+
+  // Host visible blocks are persistently mapped, so fill a and b in place.
+  auto a_data = a_memory.mapped_span<uint32_t>(ELEMENT_COUNT);
+  auto b_data = b_memory.mapped_span<uint32_t>(ELEMENT_COUNT);
+  for (auto i = 0ul; i < ELEMENT_COUNT; ++i) {
+    a_data[i] = i;
+    b_data[i] = i;
   }
 
-  if (map_memory(storage, size_in_bytes, size_in_bytes, &ptr)) {
-    uint32_t* as_uint32 = reinterpret_cast<uint32_t*>(ptr);
-    for (auto i = 0ul; i < ELEMENT_COUNT; ++i)
-      as_uint32[i] = i;
-
-   unmap_memory(storage);
-  }
+  a_memory.flush();
+  b_memory.flush();
 
   // Load the shader module.
   auto spirv = load_shader("vector_add.spv");
@@ -87,10 +83,11 @@ int main(int argc, char **argv) {
   layout_bindings.emplace_back(2);
 
   vk::descriptor_set_layout layout{device, layout_bindings.data(), layout_bindings.size()};
-  vk::pipeline_layout pipeline_layout{device, &layout, 1}; 
 
-  // Now construct a pipeline.
-  vk::compute_pipeline pipeline{device, pipeline_layout, shader, "main"};
+  // Now construct a kernel, which owns the pipeline and its layout. The
+  // shader takes its workgroup size from specialization constants, so the
+  // kernel picks one to suit the device.
+  vk::compute_kernel kernel{device, &layout, 1, shader, "main", 1};
 
   // While we have defined the layout of our descriptor set, we haven't 
   // actually bound the buffers into a concrete descriptor. Now we create
@@ -106,12 +103,18 @@ int main(int argc, char **argv) {
 
   // Once all our bindings are set up we can build a command buffer.
   vk::command_pool command_pool{device, family->index};
+  // The launcher works out the workgroup count, and would split the launch
+  // if it exceeded the device's limits. The shader offsets each part by the
+  // workgroup it starts at and skips invocations past the end.
+  vk::compute_launcher launcher{device};
+  launcher.launch(kernel, vk::extent<3>{ELEMENT_COUNT, 1, 1})
+          .bind(descriptor)
+          .reads(a)
+          .reads(b)
+          .writes(c);
+
   vk::command_buffer cmd = command_pool.allocate();
-  cmd.begin();
-  cmd.bind_pipeline(pipeline);
-  cmd.bind_descriptor_sets(pipeline_layout, &descriptor, 1);
-  cmd.dispatch(ELEMENT_COUNT);
-  cmd.end();
+  cmd.record([&](vk::command_builder &builder) { launcher.record(builder); });
 
   // Submit and wait for the queue to be idle.
   queue.submit(&cmd, 1);
@@ -120,13 +123,11 @@ int main(int argc, char **argv) {
 
   // Validate results.
   uint32_t correct = 0;
-  if (map_memory(storage, 2* size_in_bytes, size_in_bytes, &ptr)) {
-    uint32_t* as_uint32 = reinterpret_cast<uint32_t*>(ptr);
-    for (auto i = 0ul; i < ELEMENT_COUNT; ++i) {
-      if (as_uint32[i] == 2 * i)
-        ++correct;
-    }
-    unmap_memory(storage);
+  c_memory.invalidate();
+  auto c_data = c_memory.mapped_span<uint32_t>(ELEMENT_COUNT);
+  for (auto i = 0ul; i < ELEMENT_COUNT; ++i) {
+    if (c_data[i] == 2 * i)
+      ++correct;
   }
 
   std::cout << correct << "/" << ELEMENT_COUNT << " results correct.\n";
@@ -1,10 +1,20 @@
 #version 450
 
+// Follows the compute_launcher contract: the workgroup size comes from
+// specialization constants 0 to 2, each dispatch of a split launch pushes the
+// workgroup it starts at, and invocations past the launch size do nothing.
+layout (local_size_x_id = 0, local_size_y_id = 1, local_size_z_id = 2) in;
+
+layout (push_constant) uniform launch { uint base[3]; uint size[3]; };
+
 layout (std430, set=0, binding=0) buffer inA { int a[]; };
 layout (std430, set=0, binding=1) buffer inB { int b[]; };
 layout (std430, set=0, binding=2) buffer outR { int result[]; };
 
 void main() {
-  const uint i = gl_GlobalInvocationID.x;
+  const uint i = (gl_WorkGroupID.x + base[0]) * gl_WorkGroupSize.x +
+                 gl_LocalInvocationID.x;
+  if (i >= size[0])
+    return;
   result[i] = a[i] + b[i];
 }
@@ -260,33 +260,40 @@ int main(int argc, char **argv) {
   clear_colour.float32[2] = 0.0f;
   clear_colour.float32[3] = 1.0f;
 
-  // Create the command buffer pool.
-  vk::command_pool command_pool{device, family->index};
-  vk::command_buffer command_buffer = command_pool.allocate();
- // command_buffer.record([](vk::command_builder& builder) {
-//    builder.pipeline_barrier(nullptr, 0, nullptr, 0, nullptr, 0);
-//  });
+  // Keep two frames in flight. The first use of the swapchain image is a
+  // transfer, so that's where submissions wait for the acquire.
+  vk::frame_pacer pacer{device, queue, family->index, swapchain, 2,
+                        vk::pipeline_stage::transfer};
+
+  // Works out the layout transitions around the clear.
+  vk::resource_tracker tracker;
 
   // Start the event loop.
   while (handle_events(connection, wm_delete_window->atom)) {
-    // Grab an image and immediately present it.
-    auto image = swapchain.acquire_next_image();
-    command_buffer.record([&](vk::command_builder& builder) {
-      builder.pipeline_barrier(nullptr, 0, nullptr, 0, nullptr, 0,
-                               image, vk::image_layout::transfer_destination);
+    // Grab an image, clear it and queue it for presentation.
+    auto frame = pacer.begin_frame();
+    auto &image = frame.image;
+    frame.commands.record([&](vk::command_builder& builder) {
+      // The old contents are cleared over, so each frame starts from
+      // undefined, once the acquire semaphore has been waited on.
+      tracker.track(image, vk::image_layout::undefined, vk::image_aspect::colour,
+                    1, 1, vk::pipeline_stage::transfer);
+      tracker.use(image, subresource_range, vk::pipeline_stage::transfer,
+                  vk::access_mask::transfer_write,
+                  vk::image_layout::transfer_destination);
+      tracker.flush(builder);
       builder.clear_colour_image(image, vk::image_layout::transfer_destination,
                                  clear_colour,
                                  &subresource_range, 1);
-      builder.pipeline_barrier(nullptr, 0, nullptr, 0, nullptr, 0,
-                               image, vk::image_layout::present_source);
+      tracker.use(image, subresource_range, vk::pipeline_stage::bottom_of_pipe,
+                  vk::access_mask::none, vk::image_layout::present_source);
+      tracker.flush(builder);
     });
 
-    queue.submit(&command_buffer, 1);
-    queue.wait_idle();
-    queue.present(image);
-    queue.wait_idle();
+    pacer.end_frame();
   }
 
+  pacer.wait_idle();
   queue.wait_idle();
 
   xcb_destroy_window(connection, window);
@@ -0,0 +1,61 @@
+#include "allocation_counter.h"
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local size_t allocation_count = 0;
+
+void* counted_allocate(size_t size) {
+  ++allocation_count;
+  if (0 == size)
+    size = 1;
+
+  auto ptr = std::malloc(size);
+  if (nullptr == ptr)
+    throw std::bad_alloc{};
+  return ptr;
+}
+
+}
+
+void* operator new(size_t size) {
+  return counted_allocate(size);
+}
+
+void* operator new[](size_t size) {
+  return counted_allocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  ++allocation_count;
+  return std::malloc(0 == size ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  ++allocation_count;
+  return std::malloc(0 == size ? 1 : size);
+}
+
+void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+  std::free(ptr);
+}
+
+allocation_scope::allocation_scope()
+: start_{allocation_count} { }
+
+size_t allocation_scope::allocations() const {
+  return allocation_count - start_;
+}
@@ -0,0 +1,19 @@
+#ifndef VK_TEST_ALLOCATION_COUNTER_H
+#define VK_TEST_ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+// Counts global operator new calls made by the current thread between
+// construction and allocations(). Linking allocation_counter.c++ replaces the
+// global allocation functions, so tests and benchmarks can check that a hot
+// path stays off the heap.
+class allocation_scope {
+public:
+  allocation_scope();
+
+  size_t allocations() const;
+private:
+  size_t start_;
+};
+
+#endif // ifndef VK_TEST_ALLOCATION_COUNTER_H
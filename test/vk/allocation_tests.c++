@@ -0,0 +1,83 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include "allocation_counter.h"
+#include "device_fixture.h"
+
+using namespace vk;
+
+class allocation_tests : public device_fixture {
+};
+
+TEST_F(allocation_tests, recorded_frame_does_not_allocate) {
+  auto queue = device_->get_queue(queue_role::graphics);
+  command_pool pool{*device_, queue.family()};
+  command_buffer buffers[2] = {pool.allocate(), pool.allocate()};
+  auto secondary = pool.allocate(command_buffer_level::secondary);
+  fence fences[2] = {fence{*device_, true}, fence{*device_, true}};
+  submission signal_only;
+
+  descriptor_set_layout_binding layout_bindings[] = {{0}, {1}, {2}};
+  descriptor_set_layout set_layout{*device_, layout_bindings, 3};
+  pipeline_layout layout{*device_, &set_layout, 1};
+  descriptor_pool descriptor_pool{*device_, 1};
+  auto set = descriptor_pool.allocate(set_layout);
+
+  memory_allocator allocator{*device_};
+  auto bind_memory = [&](auto &resource) {
+    for (auto &memory_type: device_->physical_device().memory_types()) {
+      if (resource.memory_type_bits() & (1u << memory_type.index)) {
+        resource.bind(allocator.allocate(memory_type, resource));
+        return;
+      }
+    }
+  };
+  buffer storage[3] = {buffer{*device_, 256}, buffer{*device_, 256},
+                       buffer{*device_, 256}};
+  for (auto &buffer: storage)
+    bind_memory(buffer);
+  image target{*device_, texel_format::r8g8b8a8_unorm, extent<3>{64, 64, 1}, 1, 1,
+               image_usage::transfer_destination};
+  bind_memory(target);
+
+  subresource_range range{image_aspect::colour, 0, 1, 0, 1};
+  image_memory_barrier to_general{access_mask::none, access_mask::transfer_write,
+                                  image_layout::undefined, image_layout::general,
+                                  VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                                  target, range};
+  clear_colour_value colour{{0.0f, 0.0f, 0.0f, 1.0f}};
+
+  auto frame = [&]() {
+    fence::wait_all(fences, 2, UINT64_MAX);
+    fence::reset(fences, 2);
+
+    descriptor_binding writes[] = {{0, storage[0]}, {1, storage[1]},
+                                   {2, storage[2]}};
+    set.update(writes, 3);
+
+    secondary.begin();
+    secondary.end();
+    buffers[0].record([&](command_builder &builder) {
+      buffers[0].bind_descriptor_sets(layout, &set, 1);
+      builder.pipeline_barrier(pipeline_stage::top_of_pipe, pipeline_stage::transfer,
+                               nullptr, 0, nullptr, 0, &to_general, 1);
+      builder.clear_colour_image(target, image_layout::general, colour, &range, 1);
+      builder.execute_commands(&secondary, 1);
+    });
+    buffers[1].record([](command_builder&) {});
+    queue.submit(buffers, 2);
+
+    // A fence submitted without batches signals once everything before it on
+    // the queue has completed.
+    queue.submit(signal_only, fences[0]);
+    queue.submit(signal_only, fences[1]);
+  };
+
+  // The first frame is allowed to warm up any per-thread scratch space.
+  frame();
+
+  allocation_scope scope;
+  frame();
+  EXPECT_EQ(0u, scope.allocations());
+
+  fence::wait_all(fences, 2, UINT64_MAX);
+}
@@ -0,0 +1,45 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class command_recycler_tests : public device_fixture {
+};
+
+TEST_F(command_recycler_tests, frame_slots_reuse_their_buffers) {
+  auto queue = device_->get_queue(queue_role::graphics);
+  command_recycler recycler{*device_, queue.family(), 2, 1, 4};
+  fence fences[2] = {fence{*device_, false}, fence{*device_, false}};
+  std::vector<VkCommandBuffer> first_handles[2];
+
+  for (auto frame = 0u; frame < 6; ++frame) {
+    auto slot = frame % 2;
+    if (2 <= frame) {
+      EXPECT_EQ(wait_result::SUCCESS, fences[slot].wait(UINT64_MAX));
+      fences[slot].reset();
+    }
+    recycler.begin_frame(slot);
+
+    // Buffers are begun without resetting them, so the pool must have been.
+    std::vector<command_buffer> buffers;
+    for (auto i = 0; i < 3; ++i) {
+      buffers.push_back(recycler.allocate(0));
+      buffers.back().record([](command_builder&) {});
+    }
+
+    std::vector<VkCommandBuffer> handles;
+    for (auto &buffer: buffers)
+      handles.push_back(buffer);
+    if (frame < 2)
+      first_handles[slot] = handles;
+    else
+      EXPECT_EQ(first_handles[slot], handles);
+
+    submission submission;
+    submission.execute(buffers.data(), buffers.size());
+    queue.submit(submission, fences[slot]);
+  }
+
+  fence::wait_all(fences, 2, UINT64_MAX);
+}
@@ -0,0 +1,246 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class compute_launcher_tests : public device_fixture {
+public:
+  void SetUp() override {
+    device_fixture::SetUp();
+    descriptor_set_layout_binding bindings[] = {{0}, {1}, {2}};
+    set_layout_ = std::make_unique<descriptor_set_layout>(*device_, bindings, 3);
+    kernel_ = std::make_unique<compute_kernel>(*device_, set_layout_.get(), 1,
+                                               sample_shader("vector_add.spv"),
+                                               "main", extent<3>{1, 1, 1});
+
+    allocator_ = std::make_unique<memory_allocator>(*device_);
+    for (auto i = 0; i < 3; ++i) {
+      buffers_.emplace_back(*device_, 1024);
+      auto &buffer = buffers_.back();
+      for (auto &memory_type: device_->physical_device().memory_types()) {
+        if (buffer.memory_type_bits() & (1u << memory_type.index)) {
+          buffer.bind(allocator_->allocate(memory_type, buffer));
+          break;
+        }
+      }
+    }
+
+    pool_ = std::make_unique<descriptor_pool>(*device_, 1);
+    set_ = std::make_unique<descriptor_set>(pool_->allocate(*set_layout_));
+    descriptor_binding writes[] = {{0, buffers_[0]}, {1, buffers_[1]},
+                                   {2, buffers_[2]}};
+    set_->update(writes, 3);
+  }
+
+  void TearDown() override {
+    set_.reset();
+    pool_.reset();
+    buffers_.clear();
+    host_memory_.clear();
+    allocator_.reset();
+    kernel_.reset();
+    set_layout_.reset();
+    device_fixture::TearDown();
+  }
+
+  void record(compute_launcher &launcher) {
+    auto queue = device_->get_queue(queue_role::graphics);
+    command_pool pool{*device_, queue.family()};
+    auto commands = pool.allocate();
+    commands.record([&](command_builder &builder) { launcher.record(builder); });
+  }
+
+  // A buffer of count elements in host coherent memory, which is kept in
+  // host_memory_ for the test to fill and check.
+  buffer host_buffer(uint32_t count) {
+    buffer result{*device_, count * sizeof(uint32_t)};
+    for (auto &memory_type: device_->physical_device().memory_types()) {
+      if ((result.memory_type_bits() & (1u << memory_type.index)) &&
+          memory_type.is_host_coherent()) {
+        host_memory_.push_back(allocator_->allocate(memory_type, result));
+        result.bind(host_memory_.back());
+        return result;
+      }
+    }
+    throw std::runtime_error{"No host coherent memory type."};
+  }
+
+  // Records, submits and waits for the launches, then makes their writes
+  // visible to the host.
+  void run(compute_launcher &launcher) {
+    auto queue = device_->get_queue(queue_role::graphics);
+    command_pool pool{*device_, queue.family()};
+    auto commands = pool.allocate();
+    memory_barrier to_host{access_mask::shader_write, access_mask::host_read};
+    commands.record([&](command_builder &builder) {
+      launcher.record(builder);
+      builder.pipeline_barrier(pipeline_stage::compute_shader, pipeline_stage::host,
+                               &to_host, 1, nullptr, 0, nullptr, 0);
+    });
+
+    fence done{*device_, false};
+    submission submission;
+    submission.execute(commands);
+    queue.submit(submission, done);
+    EXPECT_EQ(wait_result::SUCCESS, done.wait(UINT64_MAX));
+  }
+
+  // Launches the kernel over count elements of buffers holding buffer_count,
+  // and checks every result up to count and that none after it was written.
+  void add(compute_kernel &kernel, uint32_t count, uint32_t buffer_count,
+           uint32_t expected_dispatches) {
+    auto first = host_memory_.size();
+    auto a = host_buffer(buffer_count);
+    auto b = host_buffer(buffer_count);
+    auto result = host_buffer(buffer_count);
+    auto a_data = host_memory_[first].mapped_span<uint32_t>(buffer_count);
+    auto b_data = host_memory_[first + 1].mapped_span<uint32_t>(buffer_count);
+    auto results = host_memory_[first + 2].mapped_span<uint32_t>(buffer_count);
+    for (auto i = 0u; i < buffer_count; ++i) {
+      a_data[i] = i;
+      b_data[i] = 2 * i;
+      results[i] = ~0u;
+    }
+
+    descriptor_pool pool{*device_, 1};
+    auto set = pool.allocate(*set_layout_);
+    descriptor_binding writes[] = {{0, a}, {1, b}, {2, result}};
+    set.update(writes, 3);
+
+    compute_launcher launcher{*device_};
+    launcher.launch(kernel, extent<3>{count, 1, 1})
+            .bind(set)
+            .reads(a)
+            .reads(b)
+            .writes(result);
+    run(launcher);
+    EXPECT_EQ(expected_dispatches, launcher.dispatch_count());
+
+    auto wrong = 0u;
+    for (auto i = 0u; i < buffer_count; ++i) {
+      if ((i < count ? 3 * i : ~0u) != results[i])
+        ++wrong;
+    }
+    EXPECT_EQ(0u, wrong);
+  }
+
+  std::unique_ptr<descriptor_set_layout> set_layout_;
+  std::unique_ptr<compute_kernel> kernel_;
+  std::unique_ptr<memory_allocator> allocator_;
+  std::vector<memory_allocation> host_memory_;
+  std::vector<buffer> buffers_;
+  std::unique_ptr<descriptor_pool> pool_;
+  std::unique_ptr<descriptor_set> set_;
+};
+
+TEST_F(compute_launcher_tests, local_sizes_fit_the_device_limits) {
+  auto &physical_device = device_->physical_device();
+  auto &limits = physical_device.limits();
+  for (auto dimensions = 1u; dimensions <= 3; ++dimensions) {
+    auto size = compute_kernel::local_size_for(physical_device, dimensions);
+    EXPECT_LE(size.width, limits.maxComputeWorkGroupSize[0]);
+    EXPECT_LE(size.height, limits.maxComputeWorkGroupSize[1]);
+    EXPECT_LE(size.depth, limits.maxComputeWorkGroupSize[2]);
+    EXPECT_LE(size.width * size.height * size.depth,
+              limits.maxComputeWorkGroupInvocations);
+    if (dimensions < 3) {
+      EXPECT_EQ(1u, size.depth);
+    }
+    if (dimensions < 2) {
+      EXPECT_EQ(1u, size.height);
+    }
+  }
+}
+
+TEST_F(compute_launcher_tests, empty_launcher_records_nothing) {
+  auto queue = device_->get_queue(queue_role::graphics);
+  command_pool pool{*device_, queue.family()};
+  compute_launcher launcher{*device_};
+
+  auto commands = pool.allocate();
+  commands.record([&](command_builder &builder) { launcher.record(builder); });
+  EXPECT_EQ(0u, launcher.dispatch_count());
+  EXPECT_EQ(0u, launcher.barrier_count());
+}
+
+TEST_F(compute_launcher_tests, reader_waits_for_an_in_place_writer) {
+  compute_launcher launcher{*device_};
+  launcher.launch(*kernel_, extent<3>{256, 1, 1})
+          .bind(*set_)
+          .reads(buffers_[0])
+          .writes(buffers_[0]);
+  launcher.launch(*kernel_, extent<3>{256, 1, 1})
+          .bind(*set_)
+          .reads(buffers_[0])
+          .writes(buffers_[1]);
+  record(launcher);
+
+  EXPECT_EQ(2u, launcher.dispatch_count());
+  EXPECT_EQ(1u, launcher.barrier_count());
+}
+
+TEST_F(compute_launcher_tests, independent_launches_share_a_level) {
+  compute_launcher launcher{*device_};
+  launcher.launch(*kernel_, extent<3>{256, 1, 1})
+          .bind(*set_)
+          .reads(buffers_[0])
+          .writes(buffers_[1]);
+  launcher.launch(*kernel_, extent<3>{256, 1, 1})
+          .bind(*set_)
+          .reads(buffers_[0])
+          .writes(buffers_[2]);
+  record(launcher);
+
+  EXPECT_EQ(2u, launcher.dispatch_count());
+  EXPECT_EQ(0u, launcher.barrier_count());
+}
+
+TEST_F(compute_launcher_tests, oversized_launches_are_split) {
+  auto max_groups = device_->physical_device().limits().maxComputeWorkGroupCount[0];
+  // Nothing can be too big for this device.
+  if (UINT32_MAX == max_groups)
+    return;
+
+  compute_launcher launcher{*device_};
+  launcher.launch(*kernel_, extent<3>{max_groups + 1, 1, 1})
+          .bind(*set_)
+          .writes(buffers_[2]);
+  record(launcher);
+
+  EXPECT_EQ(2u, launcher.dispatch_count());
+}
+
+TEST_F(compute_launcher_tests, split_launches_cover_every_element) {
+  auto max_groups = device_->physical_device().limits().maxComputeWorkGroupCount[0];
+  // Buffers big enough to need a split would be too big to test with.
+  if (1u << 20 < max_groups)
+    return;
+
+  // One invocation per group, so the launch needs a second dispatch.
+  add(*kernel_, max_groups + 100, max_groups + 100, 2);
+}
+
+TEST_F(compute_launcher_tests, invocations_past_the_size_do_nothing) {
+  compute_kernel kernel{*device_, set_layout_.get(), 1,
+                        sample_shader("vector_add.spv"), "main", 1};
+  // The last group hangs over the end of the launch, into a tail of the
+  // buffers the shader mustn't touch.
+  auto local_size = kernel.local_size().width;
+  add(kernel, 1000, 1000 + local_size, 1);
+}
+
+TEST_F(compute_launcher_tests, redundant_binds_are_skipped) {
+  compute_launcher launcher{*device_};
+  for (auto i = 0; i < 4; ++i) {
+    launcher.launch(*kernel_, extent<3>{64, 1, 1})
+            .bind(*set_)
+            .reads(buffers_[0]);
+  }
+  record(launcher);
+
+  EXPECT_EQ(4u, launcher.dispatch_count());
+  // One pipeline bind and one descriptor set bind.
+  EXPECT_EQ(2u, launcher.bind_count());
+}
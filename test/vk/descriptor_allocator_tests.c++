@@ -0,0 +1,47 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class descriptor_allocator_tests : public device_fixture {
+public:
+  void SetUp() override {
+    device_fixture::SetUp();
+    descriptor_set_layout_binding bindings[] = {
+      {0, descriptor_type::uniform_buffer},
+      {1, descriptor_type::combined_image_sampler, 4},
+      {2, descriptor_type::storage_buffer},
+    };
+    layout_ = std::make_unique<descriptor_set_layout>(*device_, bindings, 3);
+  }
+
+  std::unique_ptr<descriptor_set_layout> layout_;
+};
+
+TEST_F(descriptor_allocator_tests, layout_counts_descriptors_by_type) {
+  auto &counts = layout_->descriptor_counts();
+  ASSERT_EQ(3u, counts.size());
+  EXPECT_EQ(descriptor_type::combined_image_sampler, counts[1].type);
+  EXPECT_EQ(4u, counts[1].count);
+}
+
+TEST_F(descriptor_allocator_tests, full_pool_chains_another) {
+  descriptor_allocator allocator{*device_, layout_.get(), 1, 4};
+
+  std::vector<descriptor_set> sets;
+  for (auto i = 0; i < 10; ++i)
+    sets.push_back(allocator.allocate(*layout_));
+  EXPECT_EQ(3u, allocator.pool_count());
+}
+
+TEST_F(descriptor_allocator_tests, begin_frame_reuses_pools) {
+  descriptor_allocator allocator{*device_, layout_.get(), 1, 4, 2};
+
+  for (auto frame = 0u; frame < 4; ++frame) {
+    allocator.begin_frame(frame % 2);
+    for (auto i = 0; i < 6; ++i)
+      allocator.allocate(*layout_);
+  }
+  EXPECT_EQ(4u, allocator.pool_count());
+}
@@ -0,0 +1,140 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <stdexcept>
+#include "device_fixture.h"
+
+using namespace vk;
+
+namespace {
+
+// vector_add's three buffers, the result one bound with a dynamic offset.
+struct vector_add_descriptors {
+  descriptor_buffer_info a;
+  descriptor_buffer_info b;
+  descriptor_buffer_info result;
+};
+
+const uint32_t element_count = 64;
+
+}
+
+class descriptor_update_tests : public device_fixture {
+public:
+  void SetUp() override {
+    device_fixture::SetUp();
+    descriptor_set_layout_binding bindings[] = {
+      {0, descriptor_type::storage_buffer},
+      {1, descriptor_type::storage_buffer},
+      {2, descriptor_type::storage_buffer_dynamic},
+    };
+    layout_ = std::make_unique<descriptor_set_layout>(*device_, bindings, 3);
+    allocator_ = std::make_unique<descriptor_allocator>(*device_, layout_.get(), 1, 8);
+
+    // Results go in the second of two aligned regions.
+    auto alignment = device_->physical_device().limits().minStorageBufferOffsetAlignment;
+    region_size_ = (element_count * sizeof(uint32_t) + alignment - 1) / alignment * alignment;
+
+    memory_ = std::make_unique<memory_allocator>(*device_);
+    a_ = make_buffer(element_count * sizeof(uint32_t));
+    b_ = make_buffer(element_count * sizeof(uint32_t));
+    result_ = make_buffer(2 * region_size_);
+  }
+
+  void TearDown() override {
+    a_.reset();
+    b_.reset();
+    result_.reset();
+    allocations_.clear();
+    memory_.reset();
+    allocator_.reset();
+    layout_.reset();
+    device_fixture::TearDown();
+  }
+
+  // A storage buffer in host coherent memory.
+  std::unique_ptr<buffer> make_buffer(size_t size) {
+    auto created = std::make_unique<buffer>(*device_, size);
+    for (auto &memory_type: device_->physical_device().memory_types()) {
+      if (memory_type.is_host_coherent() &&
+          (created->memory_type_bits() & (1u << memory_type.index))) {
+        allocations_.push_back(memory_->allocate(memory_type, *created));
+        created->bind(allocations_.back());
+        return created;
+      }
+    }
+    throw std::runtime_error{"No host coherent memory type."};
+  }
+
+  std::unique_ptr<descriptor_set_layout> layout_;
+  std::unique_ptr<descriptor_allocator> allocator_;
+  std::unique_ptr<memory_allocator> memory_;
+  std::vector<memory_allocation> allocations_;
+  std::unique_ptr<buffer> a_;
+  std::unique_ptr<buffer> b_;
+  std::unique_ptr<buffer> result_;
+  uint32_t region_size_;
+};
+
+TEST_F(descriptor_update_tests, template_writes_packed_struct) {
+  descriptor_update_entry entries[] = {
+    {0, 0, 1, descriptor_type::storage_buffer,
+     offsetof(vector_add_descriptors, a), sizeof(descriptor_buffer_info)},
+    {1, 0, 1, descriptor_type::storage_buffer,
+     offsetof(vector_add_descriptors, b), sizeof(descriptor_buffer_info)},
+    {2, 0, 1, descriptor_type::storage_buffer_dynamic,
+     offsetof(vector_add_descriptors, result), sizeof(descriptor_buffer_info)},
+  };
+  descriptor_update_template update_template{*device_, *layout_, entries, 3};
+
+  auto a = allocations_[0].mapped_span<uint32_t>(element_count);
+  auto b = allocations_[1].mapped_span<uint32_t>(element_count);
+  for (auto i = 0u; i < element_count; ++i) {
+    a[i] = i;
+    b[i] = 2 * i;
+  }
+
+  auto set = allocator_->allocate(*layout_);
+  VkDeviceSize size = element_count * sizeof(uint32_t);
+  set.update(update_template, vector_add_descriptors{{*a_, 0, size},
+                                                     {*b_, 0, size},
+                                                     {*result_, 0, size}});
+
+  compute_kernel kernel{*device_, layout_.get(), 1, sample_shader("vector_add.spv"),
+                        "main", extent<3>{1, 1, 1}};
+  auto queue = device_->get_queue(queue_role::graphics);
+  command_pool pool{*device_, queue.family()};
+  auto commands = pool.allocate();
+  commands.record([&](command_builder &builder) {
+    descriptor_set_ref sets[] = {set};
+    builder.bind_pipeline(kernel.pipeline());
+    builder.bind_descriptor_sets(kernel.layout(), sets, 1, &region_size_, 1);
+    builder.push_constants(kernel.layout(), shader_stage_mask::compute, 0,
+                           launch_params{{0, 0, 0}, {element_count, 1, 1}});
+    builder.dispatch(element_count);
+  });
+  queue.submit(&commands, 1);
+  queue.wait_idle();
+
+  auto results = allocations_[2].mapped_span<uint32_t>(2 * region_size_ / sizeof(uint32_t));
+  auto offset = region_size_ / sizeof(uint32_t);
+  for (auto i = 0u; i < element_count; ++i)
+    EXPECT_EQ(3 * i, results[offset + i]);
+}
+
+TEST_F(descriptor_update_tests, writer_batches_until_flushed) {
+  descriptor_writer writer{*device_};
+  std::vector<descriptor_set> sets;
+  for (auto i = 0; i < 4; ++i) {
+    sets.push_back(allocator_->allocate(*layout_));
+    auto &set = sets.back();
+    writer.write_buffer(set, 0, descriptor_type::storage_buffer, *a_);
+    writer.write_buffer(set, 1, descriptor_type::storage_buffer, *b_);
+    writer.write_buffer(set, 2, descriptor_type::storage_buffer_dynamic,
+                        *result_, 0, region_size_);
+  }
+  EXPECT_EQ(12u, writer.size());
+
+  writer.flush();
+  EXPECT_EQ(0u, writer.size());
+}
@@ -1,4 +1,7 @@
 #include "device_fixture.h"
+#include <fstream>
+#include <stdexcept>
+#include <string>
 
 void device_fixture::SetUp() {
   instance_ = std::make_unique<vk::instance>();
@@ -17,3 +20,15 @@ void device_fixture::TearDown() {
   instance_.reset(nullptr);
 }
 
+
+vk::shader_module device_fixture::sample_shader(const char *name) {
+  std::ifstream in{std::string{SHADER_DIR} + "/" + name,
+                   std::ios::binary | std::ios::ate};
+  if (!in)
+    throw std::runtime_error{std::string{"Failed to open "} + name + "."};
+
+  std::vector<uint32_t> code(in.tellg() / sizeof(uint32_t));
+  in.seekg(0);
+  in.read(reinterpret_cast<char*>(code.data()), code.size() * sizeof(uint32_t));
+  return vk::shader_module{*device_, code.data(), code.size() * sizeof(uint32_t)};
+}
@@ -7,6 +7,9 @@ public:
   void SetUp() override;
   void TearDown() override;
 
+  // One of the samples' compiled shaders, e.g. vector_add.spv.
+  vk::shader_module sample_shader(const char *name);
+
   std::unique_ptr<vk::instance> instance_;
   std::unique_ptr<vk::device> device_;
 };
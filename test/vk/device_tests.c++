@@ -0,0 +1,23 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class device_tests : public device_fixture {
+};
+
+TEST_F(device_tests, every_role_has_a_queue) {
+  for (auto role: {queue_role::graphics, queue_role::compute, queue_role::transfer}) {
+    auto queue = device_->get_queue(role);
+    EXPECT_EQ(device_->queue_family_index(role), queue.family());
+  }
+}
+
+TEST_F(device_tests, unrequested_roles_share_graphics_queue) {
+  queue_request request{queue_role::graphics, 0, 1.0f};
+  vk::device device{device_->physical_device(), &request, 1};
+
+  EXPECT_EQ(0u, device.queue_family_index(queue_role::compute));
+  EXPECT_EQ(0u, device.queue_family_index(queue_role::transfer));
+}
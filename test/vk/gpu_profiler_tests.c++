@@ -0,0 +1,42 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include <sstream>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class gpu_profiler_tests : public device_fixture {
+};
+
+TEST_F(gpu_profiler_tests, zones_are_collected_when_their_slice_is_reused) {
+  auto queue = device_->get_queue(queue_role::graphics);
+  gpu_profiler profiler{*device_, queue.family(), 1, 4};
+  command_pool pool{*device_, queue.family()};
+
+  auto commands = pool.allocate();
+  commands.record([&](command_builder &builder) {
+    profiler.begin_frame(builder);
+    auto frame = builder.profile(profiler, "frame");
+    auto fill = builder.profile(profiler, "fill \"a\"");
+  });
+  queue.submit(&commands, 1);
+  queue.wait_idle();
+  EXPECT_TRUE(profiler.zones().empty());
+
+  auto next = pool.allocate();
+  next.record([&](command_builder &builder) { profiler.begin_frame(builder); });
+
+  auto &zones = profiler.zones();
+  ASSERT_EQ(2u, zones.size());
+  EXPECT_EQ(0u, profiler.dropped_frames());
+  EXPECT_EQ("frame", zones[0].name);
+  EXPECT_EQ(0u, zones[0].depth);
+  EXPECT_EQ(1u, zones[1].depth);
+  EXPECT_LE(zones[0].begin, zones[1].begin);
+  EXPECT_LE(zones[1].end, zones[0].end);
+
+  std::ostringstream trace;
+  profiler.write_trace(trace);
+  EXPECT_NE(std::string::npos, trace.str().find("\"traceEvents\""));
+  EXPECT_NE(std::string::npos, trace.str().find("\"fill \\\"a\\\"\""));
+}
@@ -0,0 +1,90 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class memory_allocator_tests : public device_fixture {
+};
+
+TEST_F(memory_allocator_tests, allocations_are_aligned_and_released) {
+  auto &memory_type = *device_->physical_device().memory_types().begin();
+  memory_allocator allocator{*device_, 1024 * 1024};
+
+  {
+    auto a = allocator.allocate(memory_type, 100, 256, true);
+    auto b = allocator.allocate(memory_type, 100, 256, true);
+    EXPECT_EQ(0u, a.offset() % 256);
+    EXPECT_EQ(0u, b.offset() % 256);
+
+    auto stats = allocator.statistics(memory_type);
+    EXPECT_EQ(2u, stats.allocation_count);
+    EXPECT_EQ(200u, stats.bytes_allocated);
+  }
+
+  auto stats = allocator.statistics(memory_type);
+  EXPECT_EQ(0u, stats.allocation_count);
+  EXPECT_EQ(0u, stats.bytes_allocated);
+}
+
+TEST_F(memory_allocator_tests, dedicated_allocations_take_any_size) {
+  auto &memory_type = *device_->physical_device().memory_types().begin();
+  memory_allocator allocator{*device_, 1024 * 1024};
+
+  // Over half a block, and not on a size class boundary.
+  auto a = allocator.allocate(memory_type, 1000000, 256, true);
+  EXPECT_EQ(0u, a.offset());
+  EXPECT_EQ(1000000u, a.size());
+
+  buffer b{*device_, 40 * 1024 * 1024 + 4096};
+  b.bind(allocator.allocate(memory_type, b));
+
+  auto stats = allocator.statistics(memory_type);
+  EXPECT_EQ(2u, stats.allocation_count);
+  EXPECT_LE(1000000u + 40 * 1024 * 1024 + 4096, stats.bytes_allocated);
+}
+
+TEST_F(memory_allocator_tests, buffers_bind_to_sub_allocations) {
+  auto &memory_type = *device_->physical_device().memory_types().begin();
+  memory_allocator allocator{*device_};
+
+  buffer a{*device_, 4096};
+  buffer b{*device_, 4096};
+  a.bind(allocator.allocate(memory_type, a));
+  b.bind(allocator.allocate(memory_type, b));
+
+  EXPECT_EQ(2u, allocator.statistics().allocation_count);
+}
+
+TEST_F(memory_allocator_tests, host_visible_allocations_are_mapped) {
+  memory_allocator allocator{*device_};
+  for (auto &memory_type: device_->physical_device().memory_types()) {
+    if (!memory_type.is_host_visible())
+      continue;
+
+    auto allocation = allocator.allocate(memory_type, 64, 4, true);
+    EXPECT_TRUE(allocation.memory().is_persistently_mapped());
+
+    auto data = allocation.mapped_span<uint32_t>(16);
+    for (auto i = 0u; i < data.size(); ++i)
+      data[i] = i;
+    allocation.flush();
+    allocation.invalidate();
+    EXPECT_EQ(15u, data[15]);
+  }
+}
+
+TEST_F(memory_allocator_tests, non_coherent_allocations_do_not_share_atoms) {
+  auto atom = device_->physical_device().limits().nonCoherentAtomSize;
+  memory_allocator allocator{*device_};
+  for (auto &memory_type: device_->physical_device().memory_types()) {
+    if (!memory_type.is_host_visible() || memory_type.is_host_coherent())
+      continue;
+
+    auto a = allocator.allocate(memory_type, 4, 4, true);
+    auto b = allocator.allocate(memory_type, 4, 4, true);
+    EXPECT_EQ(0u, a.offset() % atom);
+    EXPECT_EQ(0u, b.offset() % atom);
+    EXPECT_EQ(0u, a.size() % atom);
+  }
+}
@@ -0,0 +1,112 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class parallel_recorder_tests : public device_fixture {
+public:
+  const physical_device::memory_type& memory_type(uint32_t type_bits,
+                                                  bool host_coherent) {
+    for (auto &memory_type: device_->physical_device().memory_types()) {
+      if ((type_bits & (1u << memory_type.index)) &&
+          (!host_coherent || memory_type.is_host_coherent()))
+        return memory_type;
+    }
+    throw std::runtime_error{"No suitable memory type."};
+  }
+};
+
+TEST_F(parallel_recorder_tests, secondaries_execute_in_batch_order) {
+  const uint32_t size = 16;
+  const uint32_t batch_count = 8;
+  auto queue = device_->get_queue(queue_role::graphics);
+
+  memory_allocator allocator{*device_};
+  image target{*device_, texel_format::r8g8b8a8_unorm, extent<3>{size, size, 1}, 1, 1,
+               image_usage::colour_attachment | image_usage::transfer_source};
+  target.bind(allocator.allocate(memory_type(target.memory_type_bits(), false),
+                                 target));
+  buffer readback{*device_, size * size * 4, buffer_usage::transfer_destination};
+  auto &readback_type = memory_type(readback.memory_type_bits(), true);
+  device_memory readback_memory{*device_, readback_type,
+                                readback.minimum_allocation_size(), true};
+  readback.bind(readback_memory, 0, readback.minimum_allocation_size());
+
+  attachment_reference colour_reference{0, image_layout::colour_attachment};
+  subpass_description subpass{nullptr, 0, &colour_reference, 1, nullptr, nullptr,
+                              nullptr, 0};
+  attachment_description attachment{
+    texel_format::r8g8b8a8_unorm,
+    attachment_description::load_operation::clear,
+    attachment_description::store_operation::store,
+    attachment_description::load_operation::dont_care,
+    attachment_description::store_operation::dont_care,
+    image_layout::undefined,
+    image_layout::colour_attachment
+  };
+  render_pass pass{*device_, &attachment, 1, &subpass, 1, nullptr, 0};
+  subresource_range range{image_aspect::colour, 0, 1, 0, 1};
+  image_view view{target, image_view::type::image_2d, texel_format::r8g8b8a8_unorm,
+                  component_mapping{}, range};
+  framebuffer framebuffer{*device_, pass, &view, 1, size, size, 1};
+
+  thread_pool threads{4};
+  parallel_recorder recorder{*device_, queue.family(), threads, 1};
+  recorder.begin_frame(0);
+
+  // Each batch clears the whole target, so only the last one executed shows.
+  std::vector<std::atomic<uint32_t>> recorded(batch_count);
+  for (auto &count: recorded)
+    count = 0;
+  rect<2> area{{0, 0}, {size, size}};
+  clear_colour_value black{{0.0f, 0.0f, 0.0f, 0.0f}};
+  image_memory_barrier to_transfer{access_mask::colour_attachment_write,
+                                   access_mask::transfer_read,
+                                   image_layout::colour_attachment,
+                                   image_layout::transfer_source,
+                                   VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                                   target, range};
+  buffer_image_copy copy{0, 0, 0, subresource{image_aspect::colour, 0, 0, 1},
+                         offset<3>{0, 0, 0}, extent<3>{size, size, 1}};
+  memory_barrier to_host{access_mask::transfer_write, access_mask::host_read};
+
+  command_pool pool{*device_, queue.family()};
+  auto primary = pool.allocate();
+  primary.record([&](command_builder &builder) {
+    builder.begin_render_pass(pass, framebuffer, area, &black, 1,
+                              subpass_contents::secondary_command_buffers);
+    recorder.record(builder, pass, 0, framebuffer, batch_count,
+                    [&](command_builder &batch_builder, uint32_t batch) {
+      ++recorded[batch];
+      clear_colour_value colour{{(batch + 1) * 16 / 255.0f, 0.0f, 0.0f, 1.0f}};
+      batch_builder.clear_colour_attachment(0, colour, area);
+    });
+    builder.end_render_pass();
+
+    builder.pipeline_barrier(pipeline_stage::colour_attachment_output,
+                             pipeline_stage::transfer, nullptr, 0, nullptr, 0,
+                             &to_transfer, 1);
+    builder.copy_image_to_buffer(target, image_layout::transfer_source, readback,
+                                 &copy, 1);
+    builder.pipeline_barrier(pipeline_stage::transfer, pipeline_stage::host,
+                             &to_host, 1, nullptr, 0, nullptr, 0);
+  });
+
+  for (auto &count: recorded)
+    EXPECT_EQ(1u, count);
+
+  fence done{*device_, false};
+  submission submission;
+  submission.execute(primary);
+  queue.submit(submission, done);
+  EXPECT_EQ(wait_result::SUCCESS, done.wait(UINT64_MAX));
+
+  auto texels = readback_memory.mapped_span<uint8_t>(0, size * size * 4);
+  for (auto i = 0u; i < size * size; ++i) {
+    EXPECT_EQ(batch_count * 16, texels[i * 4]);
+    EXPECT_EQ(255u, texels[i * 4 + 3]);
+  }
+}
@@ -0,0 +1,65 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class pipeline_cache_tests : public device_fixture {
+public:
+  void TearDown() override {
+    std::remove(path_);
+    device_fixture::TearDown();
+  }
+
+  const char *path_ = "pipeline_cache_tests.bin";
+};
+
+TEST_F(pipeline_cache_tests, missing_file_starts_empty) {
+  std::remove(path_);
+  pipeline_cache_store store{*device_, path_};
+  EXPECT_FALSE(store.loaded());
+}
+
+TEST_F(pipeline_cache_tests, saved_cache_is_reloaded) {
+  {
+    pipeline_cache_store store{*device_, path_};
+    pipeline_cache worker{*device_};
+    store.merge(&worker, 1);
+    ASSERT_TRUE(store.save());
+  }
+
+  pipeline_cache_store store{*device_, path_};
+  EXPECT_TRUE(store.loaded());
+}
+
+TEST_F(pipeline_cache_tests, concurrent_saves_each_succeed) {
+  {
+    pipeline_cache_store store{*device_, path_};
+    std::vector<std::thread> threads;
+    std::vector<char> saved(8, false);
+    for (auto i = 0u; i < saved.size(); ++i)
+      threads.emplace_back([&store, &saved, i]() { saved[i] = store.save(); });
+    for (auto &thread: threads)
+      thread.join();
+
+    for (auto result: saved)
+      EXPECT_TRUE(result);
+  }
+
+  pipeline_cache_store store{*device_, path_};
+  EXPECT_TRUE(store.loaded());
+}
+
+TEST_F(pipeline_cache_tests, foreign_header_is_rejected) {
+  {
+    std::ofstream file{path_, std::ios::binary};
+    std::vector<char> junk(64, 0x7f);
+    file.write(junk.data(), junk.size());
+  }
+
+  pipeline_cache_store store{*device_, path_};
+  EXPECT_FALSE(store.loaded());
+}
@@ -0,0 +1,42 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class pipeline_compiler_tests : public device_fixture {
+};
+
+TEST_F(pipeline_compiler_tests, batches_compile_and_merge_into_the_target) {
+  descriptor_set_layout_binding bindings[] = {{0}, {1}, {2}};
+  descriptor_set_layout set_layout{*device_, bindings, 3};
+  push_constant_range range{shader_stage_mask::compute, 0, sizeof(launch_params)};
+  pipeline_layout layout{*device_, &set_layout, 1, &range, 1};
+  auto module = sample_shader("vector_add.spv");
+
+  std::vector<compute_pipeline_info> infos;
+  for (auto i = 0; i < 6; ++i)
+    infos.push_back(compute_pipeline_info{layout, module, "main", specialization{}});
+
+  auto empty_size = pipeline_cache{*device_}.size();
+  pipeline_cache target{*device_};
+  {
+    pipeline_compiler compiler{*device_, thread_pool{3}, target};
+    auto first = compiler.compile(infos.data(), 4);
+    auto second = compiler.compile(infos.data() + 4, 2);
+    compiler.wait_idle();
+
+    // Every pipeline of a batch is compiled before the batch merges.
+    for (auto *batch: {&first, &second}) {
+      for (auto &future: *batch) {
+        ASSERT_EQ(std::future_status::ready,
+                  future.wait_for(std::chrono::seconds{0}));
+        EXPECT_NE(VkPipeline(VK_NULL_HANDLE), VkPipeline(future.get()));
+      }
+    }
+  }
+
+  EXPECT_LT(empty_size, target.size());
+  EXPECT_EQ(target.size(), target.data().size());
+}
@@ -0,0 +1,124 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include <thread>
+#include "device_fixture.h"
+
+using namespace vk;
+
+namespace {
+
+pipeline_state_key make_key(const rasterization_state &raster_state,
+                            float viewport_x) {
+  viewport viewports[1] = {{viewport_x, 0.0f, 64.0f, 64.0f, 0.0f, 1.0f}};
+  rect<2> scissors[1] = {{{0, 0}, {64, 64}}};
+  input_assembly_state assembly_state{
+    input_assembly_state::primitive_topology::triangle_list, false};
+
+  return pipeline_state_key{nullptr, 0, vertex_input_state{}, assembly_state,
+                            viewport_state{viewports, scissors, 1},
+                            raster_state, VK_NULL_HANDLE, VK_NULL_HANDLE};
+}
+
+}
+
+TEST(pipeline_state_key, equal_state_gives_equal_keys) {
+  rasterization_state raster_state;
+  auto a = make_key(raster_state, 0.0f);
+  auto b = make_key(raster_state, -0.0f);
+
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(a.hash(), b.hash());
+}
+
+TEST(pipeline_state_key, changed_state_gives_different_keys) {
+  rasterization_state raster_state;
+  auto a = make_key(raster_state, 0.0f);
+
+  raster_state.cull_mode = 0;
+  EXPECT_NE(a, make_key(raster_state, 0.0f));
+
+  raster_state = rasterization_state{};
+  EXPECT_NE(a, make_key(raster_state, 1.0f));
+}
+
+class pipeline_state_cache_tests : public device_fixture {
+public:
+  void SetUp() override {
+    device_fixture::SetUp();
+    vertex_ = std::make_unique<shader_module>(sample_shader("triangle.vert.spv"));
+    fragment_ = std::make_unique<shader_module>(sample_shader("triangle.frag.spv"));
+    layout_ = std::make_unique<pipeline_layout>(*device_, nullptr, 0);
+
+    attachment_reference colour_reference{0, image_layout::colour_attachment};
+    subpass_description subpass{nullptr, 0, &colour_reference, 1, nullptr, nullptr,
+                                nullptr, 0};
+    attachment_description attachment{
+      texel_format::r8g8b8a8_unorm,
+      attachment_description::load_operation::dont_care,
+      attachment_description::store_operation::store,
+      attachment_description::load_operation::dont_care,
+      attachment_description::store_operation::dont_care,
+      image_layout::undefined,
+      image_layout::colour_attachment
+    };
+    render_pass_ = std::make_unique<render_pass>(*device_, &attachment, 1, &subpass, 1,
+                                                 nullptr, 0);
+  }
+
+  void TearDown() override {
+    render_pass_.reset();
+    layout_.reset();
+    fragment_.reset();
+    vertex_.reset();
+    device_fixture::TearDown();
+  }
+
+  graphics_pipeline get(pipeline_state_cache &cache, float viewport_x) {
+    pipeline_shader stages[] = {
+      {pipeline_shader::shader_stage::vertex, *vertex_, "main"},
+      {pipeline_shader::shader_stage::fragment, *fragment_, "main"},
+    };
+    viewport viewports[1] = {{viewport_x, 0.0f, 64.0f, 64.0f, 0.0f, 1.0f}};
+    rect<2> scissors[1] = {{{0, 0}, {64, 64}}};
+    input_assembly_state assembly_state{
+      input_assembly_state::primitive_topology::triangle_list, false};
+
+    return cache.get(stages, 2, vertex_input_state{}, assembly_state,
+                     viewport_state{viewports, scissors, 1}, rasterization_state{},
+                     *layout_, *render_pass_);
+  }
+
+  std::unique_ptr<shader_module> vertex_;
+  std::unique_ptr<shader_module> fragment_;
+  std::unique_ptr<pipeline_layout> layout_;
+  std::unique_ptr<render_pass> render_pass_;
+};
+
+TEST_F(pipeline_state_cache_tests, hits_return_the_same_pipeline) {
+  pipeline_state_cache cache{*device_};
+  auto first = get(cache, 0.0f);
+  auto second = get(cache, 0.0f);
+  auto other = get(cache, 1.0f);
+
+  EXPECT_EQ(static_cast<VkPipeline>(first), static_cast<VkPipeline>(second));
+  EXPECT_NE(static_cast<VkPipeline>(first), static_cast<VkPipeline>(other));
+  EXPECT_EQ(1u, cache.hits());
+  EXPECT_EQ(2u, cache.misses());
+  EXPECT_EQ(2u, cache.size());
+}
+
+TEST_F(pipeline_state_cache_tests, concurrent_requests_share_one_compile) {
+  pipeline_state_cache cache{*device_};
+  const auto thread_count = 8u;
+  std::vector<VkPipeline> pipelines(thread_count);
+  std::vector<std::thread> threads;
+  for (auto i = 0u; i < thread_count; ++i)
+    threads.emplace_back([&, i]() { pipelines[i] = get(cache, 0.0f); });
+  for (auto &thread: threads)
+    thread.join();
+
+  for (auto pipeline: pipelines)
+    EXPECT_EQ(pipelines[0], pipeline);
+  EXPECT_EQ(1u, cache.misses());
+  EXPECT_EQ(thread_count - 1, cache.hits());
+}
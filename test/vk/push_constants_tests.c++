@@ -0,0 +1,45 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include "device_fixture.h"
+
+using namespace vk;
+
+namespace {
+
+struct dispatch_parameters {
+  uint32_t element_count;
+  float scale;
+};
+
+struct oversized_parameters {
+  float values[64];
+};
+
+}
+
+static_assert(is_push_constant_block<dispatch_parameters>(),
+              "Small blocks are accepted.");
+static_assert(!is_push_constant_block<oversized_parameters>(),
+              "Blocks over the guaranteed minimum are rejected.");
+static_assert(!is_push_constant_block<uint16_t>(),
+              "Blocks must be a multiple of 4 bytes.");
+
+class push_constants_tests : public device_fixture {
+};
+
+TEST_F(push_constants_tests, record_into_layout_range) {
+  push_constant_range range{shader_stage_mask::compute, 0,
+                            sizeof(dispatch_parameters)};
+  pipeline_layout layout{*device_, nullptr, 0, &range, 1};
+
+  auto queue = device_->get_queue(queue_role::graphics);
+  command_pool pool{*device_, queue.family()};
+  auto buffer = pool.allocate();
+  buffer.record([&](command_builder &builder) {
+    builder.push_constants(layout, shader_stage_mask::compute, 0,
+                           dispatch_parameters{1024, 0.5f});
+  });
+
+  queue.submit(&buffer, 1);
+  queue.wait_idle();
+}
@@ -0,0 +1,120 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class render_graph_tests : public device_fixture {
+public:
+  void SetUp() override {
+    device_fixture::SetUp();
+    output_ = std::make_unique<buffer>(*device_, 1024);
+  }
+
+  render_graph::resource_id create_target(render_graph &graph) {
+    return graph.create_image(texel_format::r8g8b8a8_unorm, {256, 256, 1},
+                              image_usage::storage | image_usage::transfer_source);
+  }
+
+  // Writes a target with a compute pass.
+  render_graph::pass_id produce(render_graph &graph, render_graph::resource_id target) {
+    auto pass = graph.add_pass("produce", [](command_builder &) {});
+    graph.write(pass, target, pipeline_stage::compute_shader,
+                access_mask::shader_write, image_layout::general);
+    return pass;
+  }
+
+  // Copies a target into the imported buffer.
+  render_graph::pass_id consume(render_graph &graph, render_graph::resource_id target,
+                                render_graph::resource_id output) {
+    auto pass = graph.add_pass("consume", [](command_builder &) {});
+    graph.read(pass, target, pipeline_stage::transfer,
+               access_mask::transfer_read, image_layout::transfer_source);
+    graph.write(pass, output, pipeline_stage::transfer, access_mask::transfer_write);
+    return pass;
+  }
+
+  std::unique_ptr<buffer> output_;
+};
+
+TEST_F(render_graph_tests, unread_passes_are_culled) {
+  render_graph graph{*device_};
+  auto output = graph.import_buffer(*output_);
+  auto used = create_target(graph);
+  auto unused = create_target(graph);
+
+  auto used_producer = produce(graph, used);
+  auto unused_producer = produce(graph, unused);
+  consume(graph, used, output);
+  graph.compile();
+
+  EXPECT_FALSE(graph.culled(used_producer));
+  EXPECT_TRUE(graph.culled(unused_producer));
+  EXPECT_EQ(2u, graph.level_count());
+}
+
+TEST_F(render_graph_tests, independent_passes_share_a_level) {
+  render_graph graph{*device_};
+  auto output = graph.import_buffer(*output_);
+  auto first = create_target(graph);
+  auto second = create_target(graph);
+
+  produce(graph, first);
+  produce(graph, second);
+  auto pass = graph.add_pass("combine", [](command_builder &) {});
+  graph.read(pass, first, pipeline_stage::compute_shader,
+             access_mask::shader_read, image_layout::general);
+  graph.read(pass, second, pipeline_stage::compute_shader,
+             access_mask::shader_read, image_layout::general);
+  graph.write(pass, output, pipeline_stage::compute_shader, access_mask::shader_write);
+  graph.compile();
+
+  EXPECT_EQ(2u, graph.level_count());
+}
+
+TEST_F(render_graph_tests, sequential_transients_alias) {
+  render_graph graph{*device_};
+  auto output = graph.import_buffer(*output_);
+  auto first = create_target(graph);
+  auto second = create_target(graph);
+
+  // The second producer reads what the first chain wrote, so it can't be
+  // hoisted alongside it.
+  produce(graph, first);
+  consume(graph, first, output);
+  auto pass = produce(graph, second);
+  graph.read(pass, output, pipeline_stage::compute_shader, access_mask::shader_read);
+  consume(graph, second, output);
+  graph.compile();
+
+  vk::image reference{*device_, texel_format::r8g8b8a8_unorm, {256, 256, 1},
+                      1, 1, image_usage::storage | image_usage::transfer_source};
+  EXPECT_EQ(reference.minimum_allocation_size(), graph.transient_memory_size());
+}
+
+TEST_F(render_graph_tests, records_passes_on_a_thread_pool) {
+  render_graph graph{*device_};
+  auto output = graph.import_buffer(*output_);
+  auto target = create_target(graph);
+  produce(graph, target);
+  consume(graph, target, output);
+  graph.compile();
+
+  auto queue = device_->get_queue(queue_role::graphics);
+  thread_pool pool{2};
+  command_recycler recycler{*device_, queue.family(), 1, pool.size()};
+  fence done{*device_, false};
+
+  // A compiled graph is recorded again every frame.
+  for (auto frame = 0; frame < 2; ++frame) {
+    recycler.begin_frame(0);
+    auto buffers = graph.record(pool, recycler);
+    EXPECT_EQ(2u, buffers.size());
+
+    submission submission;
+    submission.execute(buffers.data(), buffers.size());
+    queue.submit(submission, done);
+    EXPECT_EQ(wait_result::SUCCESS, done.wait(UINT64_MAX));
+    done.reset();
+  }
+}
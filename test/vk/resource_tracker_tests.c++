@@ -0,0 +1,162 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class resource_tracker_tests : public device_fixture {
+public:
+  void SetUp() override {
+    device_fixture::SetUp();
+    buffer_ = std::make_unique<buffer>(*device_, 1024);
+    image_ = std::make_unique<image>(*device_, texel_format::r8g8b8_srgb,
+                                     extent<3>{64, 64, 1}, 2, 1);
+    layered_ = std::make_unique<image>(*device_, texel_format::r8g8b8a8_unorm,
+                                       extent<3>{64, 64, 1}, 1, 2);
+  }
+
+  // Flushes whatever the tracker has pending into a throwaway buffer.
+  void flush(resource_tracker &tracker) {
+    auto queue = device_->get_queue(queue_role::graphics);
+    command_pool pool{*device_, queue.family()};
+    auto commands = pool.allocate();
+    commands.record([&](command_builder &builder) { tracker.flush(builder); });
+  }
+
+  std::unique_ptr<buffer> buffer_;
+  std::unique_ptr<image> image_;
+  std::unique_ptr<image> layered_;
+};
+
+TEST_F(resource_tracker_tests, reads_after_reads_need_no_barrier) {
+  resource_tracker tracker;
+  tracker.use(*buffer_, pipeline_stage::compute_shader, access_mask::shader_read);
+  tracker.use(*buffer_, pipeline_stage::transfer, access_mask::transfer_read);
+  EXPECT_FALSE(tracker.pending());
+}
+
+TEST_F(resource_tracker_tests, write_is_made_visible_once_per_stage) {
+  resource_tracker tracker;
+  tracker.use(*buffer_, pipeline_stage::transfer, access_mask::transfer_write);
+  EXPECT_FALSE(tracker.pending());
+
+  tracker.use(*buffer_, pipeline_stage::compute_shader, access_mask::shader_read);
+  ASSERT_TRUE(tracker.pending());
+  flush(tracker);
+  EXPECT_FALSE(tracker.pending());
+
+  tracker.use(*buffer_, pipeline_stage::compute_shader, access_mask::shader_read);
+  EXPECT_FALSE(tracker.pending());
+
+  // Overwriting has to wait for the reads.
+  tracker.use(*buffer_, pipeline_stage::transfer, access_mask::transfer_write);
+  EXPECT_TRUE(tracker.pending());
+}
+
+TEST_F(resource_tracker_tests, reads_after_a_read_write_need_a_barrier) {
+  resource_tracker tracker;
+  tracker.use(*buffer_, pipeline_stage::compute_shader,
+              access_mask::shader_read | access_mask::shader_write);
+  EXPECT_FALSE(tracker.pending());
+
+  tracker.use(*buffer_, pipeline_stage::compute_shader, access_mask::shader_read);
+  EXPECT_TRUE(tracker.pending());
+}
+
+TEST_F(resource_tracker_tests, layouts_are_tracked_per_level) {
+  resource_tracker tracker;
+  tracker.track(*image_, image_layout::undefined, image_aspect::colour, 2, 1);
+
+  subresource_range second_level{image_aspect::colour, 1, 1, 0, 1};
+  tracker.use(*image_, second_level, pipeline_stage::transfer,
+              access_mask::transfer_write, image_layout::transfer_destination);
+  EXPECT_TRUE(tracker.pending());
+  EXPECT_EQ(image_layout::undefined, tracker.layout(*image_, 0));
+  EXPECT_EQ(image_layout::transfer_destination, tracker.layout(*image_, 1));
+  flush(tracker);
+}
+
+TEST_F(resource_tracker_tests, take_hands_over_a_global_barrier) {
+  resource_tracker tracker;
+  tracker.use(*buffer_, pipeline_stage::transfer, access_mask::transfer_write);
+  tracker.use(*buffer_, pipeline_stage::compute_shader, access_mask::shader_read);
+
+  auto barriers = tracker.take();
+  EXPECT_FALSE(tracker.pending());
+  EXPECT_EQ(pipeline_stage::transfer, barriers.src_stages);
+  EXPECT_EQ(pipeline_stage::compute_shader, barriers.dst_stages);
+  ASSERT_EQ(1u, barriers.memory.size());
+  EXPECT_EQ(access_mask::transfer_write, barriers.memory[0].src_access);
+  EXPECT_EQ(access_mask::shader_read, barriers.memory[0].dst_access);
+  EXPECT_TRUE(barriers.images.empty());
+}
+
+TEST_F(resource_tracker_tests, transitions_merge_across_levels) {
+  resource_tracker tracker;
+  tracker.track(*image_, image_layout::undefined, image_aspect::colour, 2, 1);
+
+  subresource_range levels{image_aspect::colour, 0, 2, 0, 1};
+  tracker.use(*image_, levels, pipeline_stage::transfer,
+              access_mask::transfer_write, image_layout::transfer_destination);
+
+  auto barriers = tracker.take();
+  EXPECT_EQ(pipeline_stage::top_of_pipe, barriers.src_stages);
+  EXPECT_EQ(pipeline_stage::transfer, barriers.dst_stages);
+  EXPECT_TRUE(barriers.memory.empty());
+  ASSERT_EQ(1u, barriers.images.size());
+  auto &barrier = barriers.images[0];
+  EXPECT_EQ(access_mask::none, barrier.src_access);
+  EXPECT_EQ(access_mask::transfer_write, barrier.dst_access);
+  EXPECT_EQ(image_layout::undefined, barrier.old_layout);
+  EXPECT_EQ(image_layout::transfer_destination, barrier.new_layout);
+  EXPECT_EQ(0u, barrier.range.base_mip_level);
+  EXPECT_EQ(2u, barrier.range.mip_count);
+  EXPECT_EQ(1u, barrier.range.layer_count);
+}
+
+TEST_F(resource_tracker_tests, merged_layers_keep_every_access) {
+  resource_tracker tracker;
+  tracker.track(*layered_, image_layout::undefined, image_aspect::colour, 1, 2);
+
+  subresource_range first{image_aspect::colour, 0, 1, 0, 1};
+  subresource_range second{image_aspect::colour, 0, 1, 1, 1};
+  tracker.use(*layered_, first, pipeline_stage::transfer,
+              access_mask::transfer_write, image_layout::general);
+  tracker.use(*layered_, second, pipeline_stage::compute_shader,
+              access_mask::shader_read, image_layout::general);
+
+  auto barriers = tracker.take();
+  EXPECT_EQ(pipeline_stage::transfer | pipeline_stage::compute_shader,
+            barriers.dst_stages);
+  ASSERT_EQ(1u, barriers.images.size());
+  auto &barrier = barriers.images[0];
+  EXPECT_EQ(access_mask::transfer_write | access_mask::shader_read,
+            barrier.dst_access);
+  EXPECT_EQ(0u, barrier.range.base_array_layer);
+  EXPECT_EQ(2u, barrier.range.layer_count);
+}
+
+TEST_F(resource_tracker_tests, split_barriers_wait_on_their_event) {
+  auto queue = device_->get_queue(queue_role::graphics);
+  command_pool pool{*device_, queue.family()};
+  auto commands = pool.allocate();
+  event event{*device_};
+
+  resource_tracker tracker;
+  tracker.use(*buffer_, pipeline_stage::transfer, access_mask::transfer_write);
+  tracker.use(*buffer_, pipeline_stage::compute_shader, access_mask::shader_read);
+  commands.record([&](command_builder &builder) {
+    tracker.flush(builder, event);
+    EXPECT_FALSE(tracker.pending());
+    tracker.wait(builder, event);
+    // The barriers were handed to the first wait.
+    tracker.wait(builder, event);
+  });
+
+  fence done{*device_, false};
+  submission submission;
+  submission.execute(commands);
+  queue.submit(submission, done);
+  EXPECT_EQ(wait_result::SUCCESS, done.wait(UINT64_MAX));
+  EXPECT_EQ(signal_status::signaled, event.status());
+}
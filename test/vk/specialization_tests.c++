@@ -0,0 +1,42 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+
+using namespace vk;
+
+namespace {
+
+struct tuning {
+  uint32_t local_size;
+  float scale;
+  VkBool32 unrolled;
+};
+
+}
+
+TEST(specialization, struct_members_take_consecutive_ids) {
+  tuning values{64, 0.5f, VK_TRUE};
+  auto constants = specialization::from(values, &tuning::local_size,
+                                        &tuning::scale, &tuning::unrolled);
+
+  auto info = constants.info();
+  ASSERT_EQ(3u, info.mapEntryCount);
+  EXPECT_EQ(12u, info.dataSize);
+  for (auto i = 0u; i < info.mapEntryCount; ++i) {
+    EXPECT_EQ(i, info.pMapEntries[i].constantID);
+    EXPECT_EQ(4 * i, info.pMapEntries[i].offset);
+  }
+}
+
+TEST(specialization, equal_constants_compare_equal_in_any_order) {
+  specialization a;
+  a.set(2, 1.0f).set(0, 128u);
+
+  specialization b;
+  b.set(0, 64u).set(2, 1.0f).set(0, 128u);
+
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(a.hash(), b.hash());
+
+  b.set(1, 7);
+  EXPECT_NE(a, b);
+}
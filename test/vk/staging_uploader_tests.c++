@@ -0,0 +1,75 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <stdexcept>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class staging_uploader_tests : public device_fixture {
+public:
+  const physical_device::memory_type& host_coherent_type() {
+    for (auto &memory_type: device_->physical_device().memory_types()) {
+      if (memory_type.is_host_coherent())
+        return memory_type;
+    }
+    throw std::runtime_error{"No host coherent memory type."};
+  }
+
+  // Records the pending uploads and waits for them to complete.
+  void submit(staging_uploader &uploader) {
+    auto queue = device_->get_queue(0, 0);
+    command_pool pool{*device_, queue.family()};
+    auto commands = pool.allocate();
+    std::unique_ptr<fence> done;
+    commands.record([&](command_builder &builder) {
+      done = std::make_unique<fence>(uploader.record(builder, pipeline_stage::host,
+                                                     access_mask::host_read));
+    });
+
+    submission submission;
+    submission.execute(commands);
+    queue.submit(submission, *done);
+    EXPECT_EQ(wait_result::SUCCESS, done->wait(UINT64_MAX));
+  }
+};
+
+TEST_F(staging_uploader_tests, uploads_reach_the_destination) {
+  auto &memory_type = host_coherent_type();
+  buffer destination{*device_, 4096, buffer_usage::transfer_destination};
+  device_memory memory{*device_, memory_type, destination.minimum_allocation_size(), true};
+  destination.bind(memory, 0, destination.minimum_allocation_size());
+
+  std::vector<uint8_t> data(2048);
+  for (auto i = 0u; i < data.size(); ++i)
+    data[i] = i % 251;
+
+  staging_uploader uploader{*device_, memory_type, 4096, 16};
+  // Small enough for update_buffer, then two uploads that merge into one copy.
+  EXPECT_EQ(8u, uploader.upload(destination, 0, data.data(), 8));
+  EXPECT_EQ(1000u, uploader.upload(destination, 8, data.data() + 8, 1000));
+  EXPECT_EQ(1040u, uploader.upload(destination, 1008, data.data() + 1008, 1040));
+  submit(uploader);
+
+  auto result = memory.mapped_span<uint8_t>(0, data.size());
+  EXPECT_TRUE(std::equal(data.begin(), data.end(), result.begin()));
+}
+
+TEST_F(staging_uploader_tests, ring_space_is_reused_once_copied) {
+  auto &memory_type = host_coherent_type();
+  buffer destination{*device_, 8192, buffer_usage::transfer_destination};
+  device_memory memory{*device_, memory_type, destination.minimum_allocation_size(), true};
+  destination.bind(memory, 0, destination.minimum_allocation_size());
+
+  std::vector<uint8_t> data(6000, 7);
+  staging_uploader uploader{*device_, memory_type, 4096};
+  auto staged = uploader.upload(destination, 0, data.data(), data.size());
+  EXPECT_EQ(4096u, staged);
+  EXPECT_EQ(4096u, uploader.used());
+
+  submit(uploader);
+  EXPECT_EQ(data.size() - staged,
+            uploader.upload(destination, staged, data.data() + staged,
+                            data.size() - staged));
+  EXPECT_EQ(data.size() - staged, uploader.used());
+}
@@ -0,0 +1,39 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class submission_tests : public device_fixture {
+};
+
+TEST_F(submission_tests, batches_are_started_on_demand) {
+  semaphore a{*device_};
+  semaphore b{*device_};
+
+  submission submission;
+  EXPECT_TRUE(submission.empty());
+
+  submission.signal(a)
+            .next_batch()
+            .wait(a, pipeline_stage::top_of_pipe)
+            .signal(b);
+  EXPECT_EQ(2u, submission.batch_count());
+
+  submission.clear();
+  EXPECT_TRUE(submission.empty());
+}
+
+TEST_F(submission_tests, chained_batches_signal_fence) {
+  auto queue = device_->get_queue(0, 0);
+  semaphore a{*device_};
+  fence done{*device_, false};
+
+  submission submission;
+  submission.signal(a)
+            .next_batch()
+            .wait(a, pipeline_stage::top_of_pipe);
+  queue.submit(submission, done);
+
+  EXPECT_EQ(wait_result::SUCCESS, done.wait(UINT64_MAX));
+}
@@ -0,0 +1,40 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <future>
+
+using namespace vk;
+
+TEST(thread_pool, parallel_for_runs_every_index_once) {
+  thread_pool pool{4};
+  std::vector<std::atomic<uint32_t>> counts(1000);
+  for (auto &count: counts)
+    count = 0;
+
+  pool.parallel_for(counts.size(), [&](uint32_t index, uint32_t worker) {
+    EXPECT_LT(worker, pool.size());
+    ++counts[index];
+  });
+
+  for (auto &count: counts)
+    EXPECT_EQ(1u, count);
+}
+
+TEST(thread_pool, async_for_completes_once_after_every_index) {
+  thread_pool pool{4};
+  std::vector<std::atomic<uint32_t>> counts(1000);
+  for (auto &count: counts)
+    count = 0;
+
+  std::promise<uint32_t> done;
+  pool.async_for(counts.size(), [&](uint32_t index, uint32_t) {
+    ++counts[index];
+  }, [&]() {
+    uint32_t total = 0;
+    for (auto &count: counts)
+      total += count;
+    done.set_value(total);
+  });
+
+  EXPECT_EQ(counts.size(), done.get_future().get());
+}
@@ -0,0 +1,53 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class timeline_semaphore_tests : public device_fixture {
+};
+
+TEST_F(timeline_semaphore_tests, host_signals_and_waits) {
+  if (!device_->supports_timeline_semaphores())
+    return;
+
+  timeline_semaphore semaphore{*device_, 1};
+  EXPECT_EQ(1u, semaphore.current_value());
+
+  semaphore.signal(5);
+  EXPECT_EQ(5u, semaphore.current_value());
+  EXPECT_EQ(wait_result::SUCCESS, semaphore.wait(5, 0));
+  EXPECT_EQ(wait_result::TIMEOUT, semaphore.wait(6, 0));
+}
+
+TEST_F(timeline_semaphore_tests, submits_wait_on_and_signal_values) {
+  if (!device_->supports_timeline_semaphores())
+    return;
+
+  auto queue = device_->get_queue(queue_role::graphics);
+  timeline_semaphore semaphore{*device_};
+  submission submission;
+  submission.wait(semaphore, 1, pipeline_stage::top_of_pipe)
+            .signal(semaphore, 2);
+  queue.submit(submission);
+
+  semaphore.signal(1);
+  EXPECT_EQ(wait_result::SUCCESS, semaphore.wait(2, UINT64_MAX));
+}
+
+TEST_F(timeline_semaphore_tests, queue_timeline_counts_submits) {
+  if (!device_->supports_timeline_semaphores())
+    return;
+
+  queue_timeline timeline{*device_, device_->get_queue(queue_role::graphics)};
+  submission empty;
+  auto first = timeline.submit(empty);
+  auto second = timeline.submit(empty);
+  EXPECT_EQ(1u, first);
+  EXPECT_EQ(2u, second);
+  EXPECT_EQ(second, timeline.last_submitted());
+
+  EXPECT_EQ(wait_result::SUCCESS, timeline.wait(second, UINT64_MAX));
+  EXPECT_TRUE(timeline.is_complete(first));
+  EXPECT_EQ(2u, timeline.completed_value());
+}
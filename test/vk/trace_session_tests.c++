@@ -0,0 +1,35 @@
+#include <vk/vk.h>
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "device_fixture.h"
+
+using namespace vk;
+
+class trace_session_tests : public device_fixture {
+};
+
+#ifdef ENABLE_TRACING
+TEST_F(trace_session_tests, calls_made_during_session_are_written) {
+  auto path = "trace_session_tests.json";
+  device_->wait_idle();
+  {
+    trace_session session{path};
+    device_->wait_idle();
+    EXPECT_EQ(0u, session.dropped());
+  }
+  device_->wait_idle();
+
+  std::ifstream file{path};
+  std::stringstream trace;
+  trace << file.rdbuf();
+  std::remove(path);
+
+  auto text = trace.str();
+  auto first = text.find("\"vkDeviceWaitIdle\"");
+  ASSERT_NE(std::string::npos, first);
+  EXPECT_EQ(std::string::npos, text.find("\"vkDeviceWaitIdle\"", first + 1));
+  EXPECT_EQ(0u, text.find("{\"traceEvents\":["));
+}
+#endif